@@ -0,0 +1,843 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @class ArtIndex
+ * @brief Ordered key index implemented as an adaptive radix tree (ART)
+ *
+ * @details Keeps the set of stored keys in byte-wise lexicographic order so that
+ *          prefix iteration and range scans touch only the matching keys. Inner
+ *          nodes grow and shrink between four layouts (4, 16, 48 and 256 children)
+ *          and use path compression, so every update costs O(key length)
+ *          regardless of the number of keys. Leaves hold the full key (lazy
+ *          expansion), and a key that ends exactly at an inner node is kept in
+ *          that node's terminal slot.
+ *
+ *          The index is not thread-safe; the owner serialises access.
+ */
+class ArtIndex
+{
+private:
+    enum class NodeType : uint8_t
+    {
+        LEAF,
+        NODE4,
+        NODE16,
+        NODE48,
+        NODE256
+    };
+
+    /**
+     * @struct Node
+     * @brief Common header of every tree node
+     */
+    struct Node
+    {
+        NodeType type; ///< Concrete layout of this node
+
+        explicit Node(NodeType t) : type(t) {}
+    };
+
+    /**
+     * @struct Leaf
+     * @brief Leaf holding one complete key
+     */
+    struct Leaf : Node
+    {
+        std::string key; ///< Full key stored in this leaf
+
+        explicit Leaf(const std::string &k) : Node(NodeType::LEAF), key(k) {}
+    };
+
+    /**
+     * @struct Inner
+     * @brief Fields shared by all inner node layouts
+     */
+    struct Inner : Node
+    {
+        uint16_t count = 0;       ///< Number of children in use
+        std::string prefix;       ///< Compressed path below the parent's edge byte
+        Leaf *terminal = nullptr; ///< Key ending exactly at this node, if any
+
+        explicit Inner(NodeType t) : Node(t) {}
+    };
+
+    struct Node4 : Inner
+    {
+        uint8_t keys[4];     ///< Sorted edge bytes
+        Node *children[4];   ///< Children matching keys[]
+
+        Node4() : Inner(NodeType::NODE4) {}
+    };
+
+    struct Node16 : Inner
+    {
+        uint8_t keys[16];    ///< Sorted edge bytes
+        Node *children[16];  ///< Children matching keys[]
+
+        Node16() : Inner(NodeType::NODE16) {}
+    };
+
+    struct Node48 : Inner
+    {
+        uint8_t index[256];  ///< Edge byte -> slot + 1 (0 means empty)
+        Node *children[48];  ///< Child slots
+
+        Node48() : Inner(NodeType::NODE48)
+        {
+            std::memset(index, 0, sizeof(index));
+            std::memset(children, 0, sizeof(children));
+        }
+    };
+
+    struct Node256 : Inner
+    {
+        Node *children[256]; ///< Children indexed directly by edge byte
+
+        Node256() : Inner(NodeType::NODE256)
+        {
+            std::memset(children, 0, sizeof(children));
+        }
+    };
+
+    Node *root = nullptr; ///< Root of the tree
+    size_t count = 0;     ///< Number of keys in the index
+
+    static uint8_t byte_at(const std::string &s, size_t i)
+    {
+        return static_cast<uint8_t>(s[i]);
+    }
+
+    /**
+     * @brief Locate the child slot for an edge byte
+     * @return Node** Pointer to the slot, or nullptr if there is no such child
+     */
+    static Node **find_child(Inner *n, uint8_t b)
+    {
+        switch (n->type)
+        {
+        case NodeType::NODE4:
+        {
+            auto *n4 = static_cast<Node4 *>(n);
+            for (uint16_t i = 0; i < n4->count; ++i)
+                if (n4->keys[i] == b)
+                    return &n4->children[i];
+            return nullptr;
+        }
+        case NodeType::NODE16:
+        {
+            auto *n16 = static_cast<Node16 *>(n);
+#if defined(__SSE2__)
+            __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(b)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(n16->keys)));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(cmp)) & ((1u << n16->count) - 1);
+            return mask ? &n16->children[__builtin_ctz(mask)] : nullptr;
+#else
+            for (uint16_t i = 0; i < n16->count; ++i)
+                if (n16->keys[i] == b)
+                    return &n16->children[i];
+            return nullptr;
+#endif
+        }
+        case NodeType::NODE48:
+        {
+            auto *n48 = static_cast<Node48 *>(n);
+            return n48->index[b] ? &n48->children[n48->index[b] - 1] : nullptr;
+        }
+        case NodeType::NODE256:
+        {
+            auto *n256 = static_cast<Node256 *>(n);
+            return n256->children[b] ? &n256->children[b] : nullptr;
+        }
+        default:
+            return nullptr;
+        }
+    }
+
+    /**
+     * @brief Move the shared inner-node fields into a differently sized node
+     */
+    static void copy_header(Inner *to, Inner *from)
+    {
+        to->count = from->count;
+        to->prefix = std::move(from->prefix);
+        to->terminal = from->terminal;
+    }
+
+    /**
+     * @brief Insert a child into a sorted-key node (Node4 / Node16)
+     */
+    template <typename N>
+    static void insert_sorted(N *n, uint8_t b, Node *child)
+    {
+        uint16_t pos = 0;
+        while (pos < n->count && n->keys[pos] < b)
+            ++pos;
+        std::memmove(n->keys + pos + 1, n->keys + pos, n->count - pos);
+        std::memmove(n->children + pos + 1, n->children + pos, (n->count - pos) * sizeof(Node *));
+        n->keys[pos] = b;
+        n->children[pos] = child;
+        n->count++;
+    }
+
+    /**
+     * @brief Add a child to an inner node, growing it when full
+     * @param ref Parent slot pointing at n (updated if the node is replaced)
+     */
+    static void add_child(Node *&ref, Inner *n, uint8_t b, Node *child)
+    {
+        switch (n->type)
+        {
+        case NodeType::NODE4:
+        {
+            auto *n4 = static_cast<Node4 *>(n);
+            if (n4->count < 4)
+            {
+                insert_sorted(n4, b, child);
+                return;
+            }
+            auto *n16 = new Node16();
+            copy_header(n16, n4);
+            std::memcpy(n16->keys, n4->keys, 4);
+            std::memcpy(n16->children, n4->children, 4 * sizeof(Node *));
+            delete n4;
+            ref = n16;
+            insert_sorted(n16, b, child);
+            return;
+        }
+        case NodeType::NODE16:
+        {
+            auto *n16 = static_cast<Node16 *>(n);
+            if (n16->count < 16)
+            {
+                insert_sorted(n16, b, child);
+                return;
+            }
+            auto *n48 = new Node48();
+            copy_header(n48, n16);
+            for (uint16_t i = 0; i < 16; ++i)
+            {
+                n48->children[i] = n16->children[i];
+                n48->index[n16->keys[i]] = static_cast<uint8_t>(i + 1);
+            }
+            delete n16;
+            ref = n48;
+            add_child(ref, n48, b, child);
+            return;
+        }
+        case NodeType::NODE48:
+        {
+            auto *n48 = static_cast<Node48 *>(n);
+            if (n48->count < 48)
+            {
+                uint8_t slot = 0;
+                while (n48->children[slot])
+                    ++slot;
+                n48->children[slot] = child;
+                n48->index[b] = static_cast<uint8_t>(slot + 1);
+                n48->count++;
+                return;
+            }
+            auto *n256 = new Node256();
+            copy_header(n256, n48);
+            for (int i = 0; i < 256; ++i)
+                if (n48->index[i])
+                    n256->children[i] = n48->children[n48->index[i] - 1];
+            delete n48;
+            ref = n256;
+            add_child(ref, n256, b, child);
+            return;
+        }
+        case NodeType::NODE256:
+        {
+            auto *n256 = static_cast<Node256 *>(n);
+            n256->children[b] = child;
+            n256->count++;
+            return;
+        }
+        default:
+            return;
+        }
+    }
+
+    /**
+     * @brief Remove a (now empty) child slot, shrinking the node when sparse
+     * @param ref Parent slot pointing at n (updated if the node is replaced)
+     */
+    static void remove_child(Node *&ref, Inner *n, uint8_t b)
+    {
+        switch (n->type)
+        {
+        case NodeType::NODE4:
+        case NodeType::NODE16:
+        {
+            uint8_t *keys = n->type == NodeType::NODE4 ? static_cast<Node4 *>(n)->keys
+                                                       : static_cast<Node16 *>(n)->keys;
+            Node **children = n->type == NodeType::NODE4 ? static_cast<Node4 *>(n)->children
+                                                         : static_cast<Node16 *>(n)->children;
+            uint16_t pos = 0;
+            while (pos < n->count && keys[pos] != b)
+                ++pos;
+            if (pos == n->count)
+                return;
+            std::memmove(keys + pos, keys + pos + 1, n->count - pos - 1);
+            std::memmove(children + pos, children + pos + 1, (n->count - pos - 1) * sizeof(Node *));
+            n->count--;
+
+            if (n->type == NodeType::NODE16 && n->count <= 3)
+            {
+                auto *n16 = static_cast<Node16 *>(n);
+                auto *n4 = new Node4();
+                copy_header(n4, n16);
+                std::memcpy(n4->keys, n16->keys, n16->count);
+                std::memcpy(n4->children, n16->children, n16->count * sizeof(Node *));
+                delete n16;
+                ref = n4;
+            }
+            return;
+        }
+        case NodeType::NODE48:
+        {
+            auto *n48 = static_cast<Node48 *>(n);
+            if (!n48->index[b])
+                return;
+            n48->children[n48->index[b] - 1] = nullptr;
+            n48->index[b] = 0;
+            n48->count--;
+
+            if (n48->count <= 12)
+            {
+                auto *n16 = new Node16();
+                copy_header(n16, n48);
+                uint16_t pos = 0;
+                for (int i = 0; i < 256; ++i)
+                {
+                    if (n48->index[i])
+                    {
+                        n16->keys[pos] = static_cast<uint8_t>(i);
+                        n16->children[pos++] = n48->children[n48->index[i] - 1];
+                    }
+                }
+                delete n48;
+                ref = n16;
+            }
+            return;
+        }
+        case NodeType::NODE256:
+        {
+            auto *n256 = static_cast<Node256 *>(n);
+            if (!n256->children[b])
+                return;
+            n256->children[b] = nullptr;
+            n256->count--;
+
+            if (n256->count <= 37)
+            {
+                auto *n48 = new Node48();
+                copy_header(n48, n256);
+                uint8_t slot = 0;
+                for (int i = 0; i < 256; ++i)
+                {
+                    if (n256->children[i])
+                    {
+                        n48->children[slot] = n256->children[i];
+                        n48->index[i] = ++slot;
+                    }
+                }
+                delete n256;
+                ref = n48;
+            }
+            return;
+        }
+        default:
+            return;
+        }
+    }
+
+    /**
+     * @brief Return the only child of a single-child inner node
+     */
+    static Node *only_child(Inner *n, uint8_t &edge)
+    {
+        Node *found = nullptr;
+        for_each_child(n, [&](uint8_t b, Node *child) {
+            edge = b;
+            found = child;
+            return false;
+        });
+        return found;
+    }
+
+    /**
+     * @brief Restore the path-compression invariants after a removal
+     * @details Empty nodes are dropped, nodes left with only a terminal key
+     *          collapse into that leaf, and single-child nodes are merged with
+     *          their child by concatenating the compressed paths.
+     */
+    static void compact(Node *&ref)
+    {
+        auto *n = static_cast<Inner *>(ref);
+        if (n->count == 0)
+        {
+            ref = n->terminal;
+            n->terminal = nullptr;
+            destroy_inner(n);
+            return;
+        }
+        if (n->count == 1 && !n->terminal)
+        {
+            uint8_t edge = 0;
+            Node *child = only_child(n, edge);
+            if (child->type != NodeType::LEAF)
+            {
+                auto *c = static_cast<Inner *>(child);
+                std::string merged = std::move(n->prefix);
+                merged.push_back(static_cast<char>(edge));
+                merged += c->prefix;
+                c->prefix = std::move(merged);
+            }
+            n->count = 0;
+            destroy_inner(n);
+            ref = child;
+        }
+    }
+
+    /**
+     * @brief Visit the children of an inner node in ascending edge order
+     * @param fn Callback (edge byte, child) returning false to stop
+     * @return false if the callback stopped the iteration
+     */
+    template <typename Fn>
+    static bool for_each_child(const Inner *n, Fn &&fn)
+    {
+        switch (n->type)
+        {
+        case NodeType::NODE4:
+        {
+            auto *n4 = static_cast<const Node4 *>(n);
+            for (uint16_t i = 0; i < n4->count; ++i)
+                if (!fn(n4->keys[i], n4->children[i]))
+                    return false;
+            return true;
+        }
+        case NodeType::NODE16:
+        {
+            auto *n16 = static_cast<const Node16 *>(n);
+            for (uint16_t i = 0; i < n16->count; ++i)
+                if (!fn(n16->keys[i], n16->children[i]))
+                    return false;
+            return true;
+        }
+        case NodeType::NODE48:
+        {
+            auto *n48 = static_cast<const Node48 *>(n);
+            for (int i = 0; i < 256; ++i)
+                if (n48->index[i] && !fn(static_cast<uint8_t>(i), n48->children[n48->index[i] - 1]))
+                    return false;
+            return true;
+        }
+        case NodeType::NODE256:
+        {
+            auto *n256 = static_cast<const Node256 *>(n);
+            for (int i = 0; i < 256; ++i)
+                if (n256->children[i] && !fn(static_cast<uint8_t>(i), n256->children[i]))
+                    return false;
+            return true;
+        }
+        default:
+            return true;
+        }
+    }
+
+    static void destroy_inner(Inner *n)
+    {
+        switch (n->type)
+        {
+        case NodeType::NODE4:
+            delete static_cast<Node4 *>(n);
+            break;
+        case NodeType::NODE16:
+            delete static_cast<Node16 *>(n);
+            break;
+        case NodeType::NODE48:
+            delete static_cast<Node48 *>(n);
+            break;
+        case NodeType::NODE256:
+            delete static_cast<Node256 *>(n);
+            break;
+        default:
+            break;
+        }
+    }
+
+    /**
+     * @brief Recursively free a subtree
+     */
+    static void destroy(Node *node)
+    {
+        if (!node)
+            return;
+        if (node->type == NodeType::LEAF)
+        {
+            delete static_cast<Leaf *>(node);
+            return;
+        }
+        auto *n = static_cast<Inner *>(node);
+        for_each_child(n, [](uint8_t, Node *child) {
+            destroy(child);
+            return true;
+        });
+        delete n->terminal;
+        destroy_inner(n);
+    }
+
+    /**
+     * @brief Length of the common run of a and b starting at offset depth
+     */
+    static size_t common_length(const std::string &a, const std::string &b, size_t depth)
+    {
+        size_t limit = std::min(a.size(), b.size());
+        size_t i = depth;
+        while (i < limit && a[i] == b[i])
+            ++i;
+        return i - depth;
+    }
+
+    bool insert_at(Node *&ref, const std::string &key, size_t depth)
+    {
+        if (!ref)
+        {
+            ref = new Leaf(key);
+            return true;
+        }
+
+        if (ref->type == NodeType::LEAF)
+        {
+            auto *leaf = static_cast<Leaf *>(ref);
+            if (leaf->key == key)
+                return false;
+
+            // Split the leaf into an inner node holding both keys
+            size_t common = common_length(leaf->key, key, depth);
+            auto *n = new Node4();
+            n->prefix = key.substr(depth, common);
+            size_t next = depth + common;
+            Node *as_node = n;
+            for (Leaf *l : {leaf, new Leaf(key)})
+            {
+                if (l->key.size() == next)
+                    n->terminal = l;
+                else
+                    add_child(as_node, n, byte_at(l->key, next), l);
+            }
+            ref = n;
+            return true;
+        }
+
+        auto *n = static_cast<Inner *>(ref);
+        size_t plen = n->prefix.size();
+        size_t match = 0;
+        while (match < plen && depth + match < key.size() && n->prefix[match] == key[depth + match])
+            ++match;
+
+        if (match < plen)
+        {
+            // Key diverges inside the compressed path: split the path
+            auto *parent = new Node4();
+            parent->prefix = n->prefix.substr(0, match);
+            uint8_t old_edge = static_cast<uint8_t>(n->prefix[match]);
+            n->prefix.erase(0, match + 1);
+
+            Node *as_node = parent;
+            add_child(as_node, parent, old_edge, n);
+            size_t next = depth + match;
+            if (next == key.size())
+                parent->terminal = new Leaf(key);
+            else
+                add_child(as_node, parent, byte_at(key, next), new Leaf(key));
+            ref = parent;
+            return true;
+        }
+
+        depth += plen;
+        if (depth == key.size())
+        {
+            if (n->terminal)
+                return false;
+            n->terminal = new Leaf(key);
+            return true;
+        }
+
+        Node **child = find_child(n, byte_at(key, depth));
+        if (child)
+            return insert_at(*child, key, depth + 1);
+
+        add_child(ref, n, byte_at(key, depth), new Leaf(key));
+        return true;
+    }
+
+    bool erase_at(Node *&ref, const std::string &key, size_t depth)
+    {
+        if (!ref)
+            return false;
+
+        if (ref->type == NodeType::LEAF)
+        {
+            if (static_cast<Leaf *>(ref)->key != key)
+                return false;
+            delete static_cast<Leaf *>(ref);
+            ref = nullptr;
+            return true;
+        }
+
+        auto *n = static_cast<Inner *>(ref);
+        size_t plen = n->prefix.size();
+        if (key.size() < depth + plen || key.compare(depth, plen, n->prefix) != 0)
+            return false;
+        depth += plen;
+
+        if (depth == key.size())
+        {
+            if (!n->terminal)
+                return false;
+            delete n->terminal;
+            n->terminal = nullptr;
+            compact(ref);
+            return true;
+        }
+
+        uint8_t b = byte_at(key, depth);
+        Node **child = find_child(n, b);
+        if (!child || !erase_at(*child, key, depth + 1))
+            return false;
+
+        if (!*child)
+            remove_child(ref, n, b);
+        compact(ref);
+        return true;
+    }
+
+    /**
+     * @brief In-order traversal of a whole subtree
+     * @return false if the callback stopped the iteration
+     */
+    template <typename Fn>
+    static bool visit_all(const Node *node, Fn &fn)
+    {
+        if (!node)
+            return true;
+        if (node->type == NodeType::LEAF)
+            return fn(static_cast<const Leaf *>(node)->key);
+
+        auto *n = static_cast<const Inner *>(node);
+        if (n->terminal && !fn(n->terminal->key))
+            return false;
+        return for_each_child(n, [&fn](uint8_t, const Node *child) { return visit_all(child, fn); });
+    }
+
+    /**
+     * @brief In-order traversal of the keys >= start in a subtree
+     * @param depth Number of key bytes consumed by the path to this node
+     * @return false if the callback stopped the iteration
+     */
+    template <typename Fn>
+    static bool visit_from(const Node *node, const std::string &start, size_t depth, Fn &fn)
+    {
+        if (!node)
+            return true;
+        if (node->type == NodeType::LEAF)
+        {
+            const auto &key = static_cast<const Leaf *>(node)->key;
+            return key < start ? true : fn(key);
+        }
+
+        auto *n = static_cast<const Inner *>(node);
+        for (size_t i = 0; i < n->prefix.size(); ++i)
+        {
+            if (depth + i >= start.size())
+                return visit_all(node, fn); // path already extends past start
+            uint8_t p = static_cast<uint8_t>(n->prefix[i]);
+            uint8_t s = byte_at(start, depth + i);
+            if (p < s)
+                return true;
+            if (p > s)
+                return visit_all(node, fn);
+        }
+        depth += n->prefix.size();
+        if (depth >= start.size())
+            return visit_all(node, fn); // path == start, everything here is >= start
+
+        uint8_t s = byte_at(start, depth);
+        return for_each_child(n, [&](uint8_t b, const Node *child) {
+            if (b < s)
+                return true;
+            if (b == s)
+                return visit_from(child, start, depth + 1, fn);
+            return visit_all(child, fn);
+        });
+    }
+
+public:
+    /**
+     * @brief Construct an empty index
+     */
+    ArtIndex() = default;
+
+    /**
+     * @brief Destroy the index and free every node
+     */
+    ~ArtIndex()
+    {
+        clear();
+    }
+
+    /**
+     * @brief Add a key to the index
+     * @param key Key to insert
+     * @return true If the key was not already present
+     *
+     * @details Time complexity: O(key length)
+     */
+    bool insert(const std::string &key)
+    {
+        bool inserted = insert_at(root, key, 0);
+        if (inserted)
+            count++;
+        return inserted;
+    }
+
+    /**
+     * @brief Remove a key from the index
+     * @param key Key to remove
+     * @return true If the key was present
+     *
+     * @details Shrinks and re-compresses nodes on the way back up.
+     *          Time complexity: O(key length)
+     */
+    bool erase(const std::string &key)
+    {
+        bool erased = erase_at(root, key, 0);
+        if (erased)
+            count--;
+        return erased;
+    }
+
+    /**
+     * @brief Check whether a key is indexed
+     * @param key Key to look up
+     * @return true If the key is present
+     */
+    bool contains(const std::string &key) const
+    {
+        const Node *node = root;
+        size_t depth = 0;
+        while (node)
+        {
+            if (node->type == NodeType::LEAF)
+                return static_cast<const Leaf *>(node)->key == key;
+
+            auto *n = static_cast<const Inner *>(node);
+            if (key.size() < depth + n->prefix.size() ||
+                key.compare(depth, n->prefix.size(), n->prefix) != 0)
+                return false;
+            depth += n->prefix.size();
+            if (depth == key.size())
+                return n->terminal != nullptr;
+
+            Node **child = find_child(const_cast<Inner *>(n), byte_at(key, depth));
+            node = child ? *child : nullptr;
+            depth++;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Visit every key starting with prefix, in ascending order
+     * @param prefix Key prefix to match (empty matches all keys)
+     * @param fn Callback taking const std::string& and returning false to stop
+     *
+     * @details Descends to the subtree owning the prefix in O(prefix length),
+     *          then walks only the matching keys.
+     */
+    template <typename Fn>
+    void for_each_prefix(const std::string &prefix, Fn fn) const
+    {
+        const Node *node = root;
+        size_t depth = 0;
+        while (node)
+        {
+            if (node->type == NodeType::LEAF)
+            {
+                const auto &key = static_cast<const Leaf *>(node)->key;
+                if (key.compare(0, prefix.size(), prefix) == 0)
+                    fn(key);
+                return;
+            }
+
+            auto *n = static_cast<const Inner *>(node);
+            for (size_t i = 0; i < n->prefix.size(); ++i)
+            {
+                if (depth + i >= prefix.size())
+                {
+                    visit_all(node, fn);
+                    return;
+                }
+                if (n->prefix[i] != prefix[depth + i])
+                    return;
+            }
+            depth += n->prefix.size();
+            if (depth >= prefix.size())
+            {
+                visit_all(node, fn);
+                return;
+            }
+
+            Node **child = find_child(const_cast<Inner *>(n), byte_at(prefix, depth));
+            node = child ? *child : nullptr;
+            depth++;
+        }
+    }
+
+    /**
+     * @brief Visit every key in [start, end), in ascending order
+     * @param start Inclusive lower bound
+     * @param end Exclusive upper bound (empty means unbounded)
+     * @param fn Callback taking const std::string& and returning false to stop
+     */
+    template <typename Fn>
+    void for_each_range(const std::string &start, const std::string &end, Fn fn) const
+    {
+        auto bounded = [&](const std::string &key) {
+            if (!end.empty() && key >= end)
+                return false;
+            return fn(key);
+        };
+        visit_from(root, start, 0, bounded);
+    }
+
+    /**
+     * @brief Get the number of indexed keys
+     * @return size_t Key count
+     */
+    size_t size() const { return count; }
+
+    /**
+     * @brief Remove every key from the index
+     */
+    void clear()
+    {
+        destroy(root);
+        root = nullptr;
+        count = 0;
+    }
+
+    // Disable copy operations
+    ArtIndex(const ArtIndex &) = delete;            ///< Disabled copy constructor
+    ArtIndex &operator=(const ArtIndex &) = delete; ///< Disabled assignment operator
+};
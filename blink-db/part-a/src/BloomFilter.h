@@ -0,0 +1,277 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "HyperLogLog.h"
+
+/**
+ * @namespace BloomFilter
+ * @brief Cache-line-blocked Bloom filters stored as string values (BF.*)
+ *
+ * @details A filter is an ordinary string value:
+ *
+ *              "BBLF" | hashes | offset | 2 reserved | [offset bytes] blocks | slack
+ *
+ *          Every element maps to one 64-byte block, chosen by the upper half
+ *          of its 64-bit hash, and sets `hashes` bits inside that block only
+ *          (a blocked Bloom filter). A lookup therefore reads one cache line
+ *          instead of `hashes` scattered ones, for a slightly higher false
+ *          positive rate that plan() pays for with a few more bits.
+ *
+ *          The blocks start `offset` bytes after the header, and the value
+ *          carries one block of slack so that offset can be chosen to put
+ *          every block on a cache-line boundary of wherever the value lives.
+ *          The engine aligns a filter when BF.RESERVE, BF.ADD or RESTORE
+ *          creates it; if the value moves later (copied, thawed) the next
+ *          BF.ADD realigns it. Lookups never write: they follow the stored
+ *          offset, so a moved filter reads the same, one or two lines per
+ *          element.
+ *
+ *          Elements are hashed with HyperLogLog::hash(). The multi-element
+ *          kernels hash a batch first and prefetch every block before
+ *          probing any, so the cache misses of a BF.MEXISTS overlap rather
+ *          than queue. A block is tested and updated against its 512-bit
+ *          mask 16 bytes at a time with SSE2, 64-bit words elsewhere.
+ */
+namespace BloomFilter
+{
+    constexpr size_t HEADER = 8;                  ///< Magic, hashes, offset, reserved
+    constexpr size_t BLOCK = 64;                  ///< Bytes per block, one cache line
+    constexpr size_t BLOCK_BITS = BLOCK * 8;      ///< Bits per block
+    constexpr unsigned MAX_HASHES = 16;           ///< Bits set per element, at most
+    constexpr size_t MAX_BYTES = size_t(1) << 29; ///< Longest filter value (a string's 512MB)
+    constexpr size_t BATCH = 16;                  ///< Elements hashed and prefetched together
+    constexpr double DEFAULT_ERROR_RATE = 0.01;   ///< Filter created by BF.ADD on a missing key
+    constexpr uint64_t DEFAULT_CAPACITY = 100;    ///< Capacity of that filter
+
+    /**
+     * @brief Size a filter for a capacity and a false positive rate
+     * @param error_rate Target false positive rate, in (0, 1)
+     * @param capacity Number of elements the rate is met up to
+     * @param[out] blocks Number of 64-byte blocks
+     * @param[out] hashes Bits set per element
+     * @return false If the filter would exceed MAX_BYTES
+     *
+     * @details The classic optimum, -n ln p / ln^2 2 bits with -log2 p
+     *          hashes, plus 1/8 more bits: blocks fill unevenly (their load
+     *          is Poisson distributed), which raises the rate of a blocked
+     *          filter over an unblocked one of the same size.
+     */
+    inline bool plan(double error_rate, uint64_t capacity, size_t &blocks, unsigned &hashes)
+    {
+        const double ln2 = std::log(2.0);
+        double bits = 1.125 * static_cast<double>(capacity) * -std::log(error_rate) / (ln2 * ln2);
+        double count = std::ceil(bits / BLOCK_BITS);
+        if (count > static_cast<double>((MAX_BYTES - HEADER) / BLOCK - 1))
+            return false;
+        blocks = count < 1 ? 1 : static_cast<size_t>(count);
+        double k = std::round(-std::log2(error_rate));
+        hashes = k < 1 ? 1 : k > MAX_HASHES ? MAX_HASHES : static_cast<unsigned>(k);
+        return true;
+    }
+
+    /**
+     * @brief An empty filter
+     * @param blocks Number of blocks, from plan()
+     * @param hashes Bits set per element, from plan()
+     */
+    inline std::string create(size_t blocks, unsigned hashes)
+    {
+        std::string value(HEADER + (blocks + 1) * BLOCK, '\0');
+        std::memcpy(&value[0], "BBLF", 4);
+        value[4] = static_cast<char>(hashes);
+        return value;
+    }
+
+    /**
+     * @brief Check whether a value is a filter
+     */
+    inline bool valid(std::string_view value)
+    {
+        return value.size() >= HEADER + 2 * BLOCK && (value.size() - HEADER) % BLOCK == 0 &&
+               std::memcmp(value.data(), "BBLF", 4) == 0 && value[4] >= 1 &&
+               static_cast<unsigned char>(value[4]) <= MAX_HASHES && static_cast<unsigned char>(value[5]) < BLOCK;
+    }
+
+    /**
+     * @brief Number of blocks of a valid filter
+     */
+    inline size_t block_count(size_t size) { return (size - HEADER) / BLOCK - 1; }
+
+    /**
+     * @brief Move the blocks of a valid filter onto cache-line boundaries
+     * @param data Filter bytes, at the address they will be used from
+     * @param size Filter length
+     * @return true If the blocks moved (O(size), once after the value moved)
+     */
+    inline bool align(unsigned char *data, size_t size)
+    {
+        size_t offset = data[5];
+        size_t wanted = (BLOCK - (reinterpret_cast<uintptr_t>(data) + HEADER) % BLOCK) % BLOCK;
+        if (offset == wanted)
+            return false;
+        size_t bytes = block_count(size) * BLOCK;
+        std::memmove(data + HEADER + wanted, data + HEADER + offset, bytes);
+        // Clear the slack so that equal filters stay byte-equal
+        std::memset(data + HEADER, 0, wanted);
+        std::memset(data + HEADER + wanted + bytes, 0, BLOCK - wanted);
+        data[5] = static_cast<unsigned char>(wanted);
+        return true;
+    }
+
+    /**
+     * @brief Block of an element and the bits it sets there
+     * @param h Element hash
+     * @param hashes Bits set per element
+     * @param blocks Number of blocks
+     * @param[out] mask 512-bit mask as eight 64-bit words
+     * @return size_t Block index
+     *
+     * @details The block comes from the upper 32 bits by multiply-shift
+     *          (blocks stay below 2^23); the bit positions are the top 9
+     *          bits of successive multiples of the hash, which mix all 64.
+     */
+    inline size_t locate(uint64_t h, unsigned hashes, size_t blocks, uint64_t mask[8])
+    {
+        std::memset(mask, 0, 8 * sizeof(uint64_t));
+        uint64_t x = h;
+        for (unsigned i = 0; i < hashes; i++)
+        {
+            x *= 0x9e3779b97f4a7c15ULL;
+            unsigned bit = static_cast<unsigned>(x >> 55);
+            mask[bit >> 6] |= uint64_t(1) << (bit & 63);
+        }
+        return static_cast<size_t>(((h >> 32) * blocks) >> 32);
+    }
+
+    /**
+     * @brief Check whether every bit of a mask is set in a block
+     */
+    inline bool test(const unsigned char *block, const uint64_t mask[8])
+    {
+#if defined(__SSE2__)
+        __m128i missing = _mm_setzero_si128();
+        for (size_t i = 0; i < BLOCK; i += 16)
+        {
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+            __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + i / 8));
+            missing = _mm_or_si128(missing, _mm_andnot_si128(b, m));
+        }
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xffff;
+#else
+        uint64_t missing = 0;
+        for (size_t i = 0; i < 8; i++)
+        {
+            uint64_t word;
+            std::memcpy(&word, block + i * 8, sizeof(word));
+            missing |= mask[i] & ~word;
+        }
+        return missing == 0;
+#endif
+    }
+
+    /**
+     * @brief Set the bits of a mask in a block
+     * @return true If at least one bit was clear
+     */
+    inline bool insert(unsigned char *block, const uint64_t mask[8])
+    {
+#if defined(__SSE2__)
+        __m128i missing = _mm_setzero_si128();
+        for (size_t i = 0; i < BLOCK; i += 16)
+        {
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+            __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + i / 8));
+            missing = _mm_or_si128(missing, _mm_andnot_si128(b, m));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(block + i), _mm_or_si128(b, m));
+        }
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) != 0xffff;
+#else
+        uint64_t missing = 0;
+        for (size_t i = 0; i < 8; i++)
+        {
+            uint64_t word;
+            std::memcpy(&word, block + i * 8, sizeof(word));
+            missing |= mask[i] & ~word;
+            word |= mask[i];
+            std::memcpy(block + i * 8, &word, sizeof(word));
+        }
+        return missing != 0;
+#endif
+    }
+
+    /**
+     * @brief Run a probe on every element, a batch at a time
+     * @param data Filter bytes
+     * @param size Filter length
+     * @param elements Elements to probe
+     * @param probe Called as probe(block, mask, index) in element order
+     *
+     * @details A batch is hashed and its blocks prefetched before the first
+     *          probe, so up to BATCH cache misses are in flight at once.
+     */
+    template <typename Data, typename Probe>
+    inline void for_each(Data *data, size_t size, const std::vector<std::string> &elements, Probe &&probe)
+    {
+        unsigned hashes = static_cast<unsigned char>(data[4]);
+        size_t blocks = block_count(size);
+        Data *base = data + HEADER + static_cast<unsigned char>(data[5]);
+        uint64_t masks[BATCH][8];
+        Data *targets[BATCH];
+        for (size_t start = 0; start < elements.size(); start += BATCH)
+        {
+            size_t n = std::min(BATCH, elements.size() - start);
+            for (size_t i = 0; i < n; i++)
+            {
+                targets[i] = base + locate(HyperLogLog::hash(elements[start + i]), hashes, blocks, masks[i]) * BLOCK;
+                __builtin_prefetch(targets[i]);
+            }
+            for (size_t i = 0; i < n; i++)
+                probe(targets[i], masks[i], start + i);
+        }
+    }
+
+    /**
+     * @brief Add elements to a filter
+     * @param data Filter bytes
+     * @param size Filter length
+     * @param elements Elements to add
+     * @param[out] added Per element, whether it set a new bit (was not
+     *             already reported present)
+     * @return true If any bit changed
+     */
+    inline bool add(unsigned char *data, size_t size, const std::vector<std::string> &elements,
+                    std::vector<bool> &added)
+    {
+        bool changed = false;
+        added.assign(elements.size(), false);
+        for_each(data, size, elements, [&](unsigned char *block, const uint64_t *mask, size_t i)
+                 {
+            added[i] = insert(block, mask);
+            changed |= added[i]; });
+        return changed;
+    }
+
+    /**
+     * @brief Look elements up in a filter
+     * @param value Filter value
+     * @param elements Elements to look up
+     * @param[out] found Per element, whether it may have been added (false
+     *             means certainly not)
+     */
+    inline void contains(std::string_view value, const std::vector<std::string> &elements, std::vector<bool> &found)
+    {
+        found.assign(elements.size(), false);
+        const unsigned char *data = reinterpret_cast<const unsigned char *>(value.data());
+        for_each(data, value.size(), elements, [&](const unsigned char *block, const uint64_t *mask, size_t i)
+                 { found[i] = test(block, mask); });
+    }
+}
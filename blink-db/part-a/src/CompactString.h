@@ -0,0 +1,507 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <string_view>
+
+/**
+ * @class CompactString
+ * @brief 16-byte byte string that stores integers and short strings inline
+ *
+ * @details Replaces std::string (32 bytes, plus a heap buffer above 15 bytes)
+ *          for keys and values in the storage engine. The last byte is a tag
+ *          that selects one of three encodings:
+ *          - INTEGER: the text is the canonical decimal form of an int64_t
+ *            ("0", "42", "-7", but not "007", "+7" or "-0"); the number itself
+ *            is stored in the first 8 bytes
+ *          - inline: up to 15 bytes stored in place, tag = length
+ *          - heap: pointer and 48-bit length of a separately allocated buffer
+ *          - shared: like heap, but the buffer is reference-counted and
+ *            copying the string only bumps the count (see share())
+ *          Apart from shared, which callers opt into, the encoding is a
+ *          function of the content alone, so two strings are
+ *          equal exactly when their encodings are, and integer keys compare
+ *          and hash as one 64-bit word. Text is only materialised at the
+ *          protocol boundary (str(), append_to()).
+ *
+ *          borrow() builds a non-owning lookup key over caller memory so that
+ *          probing the table with a long key does not allocate; copying a
+ *          borrowed string always produces an owning one, moving it does not.
+ */
+class CompactString
+{
+private:
+    static constexpr size_t INLINE_MAX = 15;       ///< Longest string stored in place
+    static constexpr uint8_t TAG_INTEGER = 0x40;   ///< raw[0..7] holds an int64_t
+    static constexpr uint8_t TAG_HEAP = 0x80;      ///< raw[0..7] owns a heap buffer
+    static constexpr uint8_t TAG_BORROWED = 0x81;  ///< raw[0..7] points at caller memory
+    static constexpr uint8_t TAG_SHARED = 0x82;    ///< raw[0..7] holds a reference to a SharedHeader buffer
+    static constexpr int64_t SHARED_INTEGERS = 10000; ///< Pool covers [0, SHARED_INTEGERS)
+    static constexpr size_t INTEGER_TEXT_MAX = 20;     ///< Longest canonical integer ("-9223372036854775808")
+
+    /**
+     * @struct SharedHeader
+     * @brief Reference count placed in front of the bytes of a shared buffer
+     */
+    struct SharedHeader
+    {
+        std::atomic<size_t> refs; ///< Strings referring to the buffer
+    };
+
+    alignas(8) unsigned char raw[16]; ///< Payload; raw[15] is the tag
+
+    uint8_t tag() const { return raw[15]; }
+    bool on_heap() const { return tag() >= TAG_HEAP; }
+
+    const char *heap_data() const
+    {
+        const char *p;
+        std::memcpy(&p, raw, sizeof(p));
+        return p;
+    }
+
+    size_t heap_size() const
+    {
+        uint32_t lo;
+        uint16_t hi;
+        std::memcpy(&lo, raw + 8, sizeof(lo));
+        std::memcpy(&hi, raw + 12, sizeof(hi));
+        return static_cast<size_t>(lo) | (static_cast<size_t>(hi) << 32);
+    }
+
+    void set_heap(const char *p, size_t n, uint8_t t)
+    {
+        std::memset(raw, 0, sizeof(raw));
+        std::memcpy(raw, &p, sizeof(p));
+        uint32_t lo = static_cast<uint32_t>(n);
+        uint16_t hi = static_cast<uint16_t>(n >> 32);
+        std::memcpy(raw + 8, &lo, sizeof(lo));
+        std::memcpy(raw + 12, &hi, sizeof(hi));
+        raw[15] = t;
+    }
+
+    void set_integer(int64_t v)
+    {
+        std::memset(raw, 0, sizeof(raw));
+        std::memcpy(raw, &v, sizeof(v));
+        raw[15] = TAG_INTEGER;
+    }
+
+    /**
+     * @brief Encode text, copying it to the heap only if it must own it
+     * @param s Text to encode
+     * @param own Whether a heap-sized string is copied (true) or referenced
+     */
+    void assign(std::string_view s, bool own)
+    {
+        int64_t v;
+        if (parse_canonical(s, v))
+        {
+            set_integer(v);
+        }
+        else if (s.size() <= INLINE_MAX)
+        {
+            std::memset(raw, 0, sizeof(raw));
+            std::memcpy(raw, s.data(), s.size());
+            raw[15] = static_cast<uint8_t>(s.size());
+        }
+        else if (own)
+        {
+            char *p = static_cast<char *>(std::malloc(s.size()));
+            if (!p)
+                throw std::bad_alloc();
+            std::memcpy(p, s.data(), s.size());
+            set_heap(p, s.size(), TAG_HEAP);
+        }
+        else
+        {
+            set_heap(s.data(), s.size(), TAG_BORROWED);
+        }
+    }
+
+    SharedHeader *shared_header() const
+    {
+        return reinterpret_cast<SharedHeader *>(const_cast<char *>(heap_data()) - sizeof(SharedHeader));
+    }
+
+    void release()
+    {
+        if (tag() == TAG_HEAP)
+        {
+            std::free(const_cast<char *>(heap_data()));
+        }
+        else if (tag() == TAG_SHARED)
+        {
+            // Strings sharing a buffer may be destroyed on different threads
+            SharedHeader *header = shared_header();
+            if (header->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                header->~SharedHeader();
+                std::free(header);
+            }
+        }
+    }
+
+    /**
+     * @brief Format an integer into buf
+     * @return size_t Number of characters written (at most 20)
+     */
+    static size_t format(int64_t v, char *buf)
+    {
+        return static_cast<size_t>(std::to_chars(buf, buf + 20, v).ptr - buf);
+    }
+
+public:
+    /**
+     * @brief Construct an empty string
+     */
+    CompactString()
+    {
+        std::memset(raw, 0, sizeof(raw));
+    }
+
+    /**
+     * @brief Construct from text, choosing the most compact encoding
+     * @param s Text to store (copied if it does not fit inline)
+     * @note Explicit so that probing the table with a std::string cannot
+     *       silently allocate; use borrow() for lookups
+     */
+    explicit CompactString(std::string_view s) { assign(s, true); }
+
+    /**
+     * @brief Construct from a std::string
+     * @param s Text to store
+     */
+    explicit CompactString(const std::string &s) : CompactString(std::string_view(s)) {}
+
+    /**
+     * @brief Construct from a NUL-terminated string
+     * @param s Text to store
+     */
+    explicit CompactString(const char *s) : CompactString(std::string_view(s)) {}
+
+    /**
+     * @brief Construct the canonical encoding of an integer
+     * @param v Integer value
+     * @return CompactString Integer-encoded string
+     */
+    static CompactString from_integer(int64_t v)
+    {
+        CompactString s;
+        s.set_integer(v);
+        return s;
+    }
+
+    /**
+     * @brief Build a non-owning lookup key over caller memory
+     * @param s Text that must outlive the returned object and every copy made
+     *          of it before it is destroyed
+     * @return CompactString Borrowed (heap-sized) or self-contained string
+     */
+    static CompactString borrow(std::string_view s)
+    {
+        CompactString out;
+        out.assign(s, false);
+        return out;
+    }
+
+    /**
+     * @brief Build a string whose buffer can be shared by copies
+     * @param s Text to store
+     * @return CompactString Shared string if s would live on the heap,
+     *         otherwise the usual inline or integer encoding
+     *
+     * @details Copies of a shared string reference the same buffer; the last
+     *          one to be destroyed frees it. Contents are never modified in
+     *          place, so sharing is safe across keys.
+     */
+    static CompactString share(std::string_view s)
+    {
+        CompactString out = borrow(s);
+        if (out.tag() != TAG_BORROWED)
+            return out;
+        void *block = std::malloc(sizeof(SharedHeader) + s.size());
+        if (!block)
+            throw std::bad_alloc();
+        new (block) SharedHeader{{1}};
+        char *data = static_cast<char *>(block) + sizeof(SharedHeader);
+        std::memcpy(data, s.data(), s.size());
+        out.set_heap(data, s.size(), TAG_SHARED);
+        return out;
+    }
+
+    CompactString(const CompactString &other)
+    {
+        if (other.tag() == TAG_SHARED)
+        {
+            other.shared_header()->refs.fetch_add(1, std::memory_order_relaxed);
+            std::memcpy(raw, other.raw, sizeof(raw));
+        }
+        else if (other.on_heap())
+            assign(std::string_view(other.heap_data(), other.heap_size()), true);
+        else
+            std::memcpy(raw, other.raw, sizeof(raw));
+    }
+
+    CompactString(CompactString &&other) noexcept
+    {
+        std::memcpy(raw, other.raw, sizeof(raw));
+        std::memset(other.raw, 0, sizeof(other.raw));
+    }
+
+    CompactString &operator=(const CompactString &other)
+    {
+        if (this != &other)
+        {
+            CompactString copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    CompactString &operator=(CompactString &&other) noexcept
+    {
+        if (this != &other)
+        {
+            CompactString moved(std::move(other));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    ~CompactString() { release(); }
+
+    /**
+     * @brief Exchange contents with another string
+     */
+    void swap(CompactString &other) noexcept
+    {
+        unsigned char tmp[sizeof(raw)];
+        std::memcpy(tmp, raw, sizeof(raw));
+        std::memcpy(raw, other.raw, sizeof(raw));
+        std::memcpy(other.raw, tmp, sizeof(raw));
+    }
+
+    /**
+     * @brief Check whether the string is integer-encoded
+     * @return true If the text is the canonical decimal form of an int64_t
+     */
+    bool is_integer() const { return tag() == TAG_INTEGER; }
+
+    /**
+     * @brief Integer value of an integer-encoded string
+     * @return int64_t The number (only meaningful when is_integer())
+     */
+    int64_t integer() const
+    {
+        int64_t v;
+        std::memcpy(&v, raw, sizeof(v));
+        return v;
+    }
+
+    /**
+     * @brief Check whether the string owns a heap buffer
+     * @return true For owned strings longer than 15 bytes that are not integers
+     */
+    bool has_heap_buffer() const { return tag() == TAG_HEAP; }
+
+    /**
+     * @brief Check whether the string references a shared buffer
+     * @return true For strings built by share() and their copies
+     */
+    bool is_shared() const { return tag() == TAG_SHARED; }
+
+    /**
+     * @brief Number of strings referencing the same shared buffer
+     * @return size_t Reference count (only meaningful when is_shared())
+     */
+    size_t share_count() const { return shared_header()->refs.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief View the bytes of a heap, borrowed or shared string
+     * @return std::string_view The text (only meaningful for strings longer
+     *         than 15 bytes that are not integers)
+     */
+    std::string_view heap_view() const { return std::string_view(heap_data(), heap_size()); }
+
+    /**
+     * @brief View the text without copying bytes that are already stored
+     * @param scratch Buffer that receives the text of inline and integer strings
+     * @return std::string_view The text, valid while both strings are unchanged
+     */
+    std::string_view view(std::string &scratch) const
+    {
+        if (on_heap())
+            return heap_view();
+        scratch.clear();
+        append_to(scratch);
+        return scratch;
+    }
+
+    /**
+     * @brief Check whether the bytes may be modified in place
+     * @return true For owned heap strings longer than any integer's text
+     *
+     * @details Past 20 bytes no text is a canonical integer, so editing the
+     *          bytes (or growing them with grow()) cannot make the encoding
+     *          disagree with the content. Shared buffers are never writable.
+     */
+    bool is_writable() const { return tag() == TAG_HEAP && heap_size() > INTEGER_TEXT_MAX; }
+
+    /**
+     * @brief Writable bytes of a string for which is_writable() holds
+     */
+    char *mutable_data() { return const_cast<char *>(heap_data()); }
+
+    /**
+     * @brief Extend a writable string with zero bytes
+     * @param n New length, not below the current one
+     */
+    void grow(size_t n)
+    {
+        size_t old_size = heap_size();
+        char *p = static_cast<char *>(std::realloc(mutable_data(), n));
+        if (!p)
+            throw std::bad_alloc();
+        std::memset(p + old_size, 0, n - old_size);
+        set_heap(p, n, TAG_HEAP);
+    }
+
+    /**
+     * @brief Length of the text in bytes
+     * @return size_t Byte length (number of digits and sign for integers)
+     */
+    size_t size() const
+    {
+        if (on_heap())
+            return heap_size();
+        if (is_integer())
+        {
+            char buf[20];
+            return format(integer(), buf);
+        }
+        return tag();
+    }
+
+    /**
+     * @brief Append the text to a string
+     * @param out Destination
+     */
+    void append_to(std::string &out) const
+    {
+        if (on_heap())
+        {
+            out.append(heap_data(), heap_size());
+        }
+        else if (is_integer())
+        {
+            char buf[20];
+            out.append(buf, format(integer(), buf));
+        }
+        else
+        {
+            out.append(reinterpret_cast<const char *>(raw), tag());
+        }
+    }
+
+    /**
+     * @brief Materialise the text
+     * @return std::string Copy of the text; integers in the shared pool range
+     *         are copied from pre-formatted strings instead of being formatted
+     */
+    std::string str() const
+    {
+        if (is_integer() && integer() >= 0 && integer() < SHARED_INTEGERS)
+            return shared_integer(integer());
+        std::string out;
+        append_to(out);
+        return out;
+    }
+
+    /**
+     * @brief Shared immutable decimal text of a small non-negative integer
+     * @param v Integer in [0, 10000)
+     * @return const std::string& Pre-formatted text, built once per process
+     */
+    static const std::string &shared_integer(int64_t v)
+    {
+        static const std::array<std::string, SHARED_INTEGERS> pool = [] {
+            std::array<std::string, SHARED_INTEGERS> p;
+            for (int64_t i = 0; i < SHARED_INTEGERS; ++i)
+                p[i] = std::to_string(i);
+            return p;
+        }();
+        return pool[v];
+    }
+
+    /**
+     * @brief Parse the canonical decimal form of an int64_t
+     * @param s Text to parse
+     * @param[out] v Parsed number
+     * @return true If s is exactly what std::to_string(v) would print
+     */
+    static bool parse_canonical(std::string_view s, int64_t &v)
+    {
+        if (s.empty() || s.size() > 20)
+            return false;
+        size_t digits = s[0] == '-' ? 1 : 0;
+        if (digits == s.size() || s[digits] < '0' || s[digits] > '9')
+            return false;
+        // Leading zeros and "-0" have no canonical integer form
+        if (s[digits] == '0' && (s.size() > digits + 1 || digits == 1))
+            return false;
+        auto res = std::from_chars(s.data(), s.data() + s.size(), v);
+        return res.ec == std::errc() && res.ptr == s.data() + s.size();
+    }
+
+    /**
+     * @brief Hash consistent with operator==
+     * @return size_t Hash of the text, or a mix of the number for integers
+     */
+    size_t hash() const
+    {
+        if (is_integer())
+        {
+            uint64_t x = static_cast<uint64_t>(integer());
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ULL;
+            x ^= x >> 33;
+            return static_cast<size_t>(x);
+        }
+        if (on_heap())
+            return std::hash<std::string_view>{}(std::string_view(heap_data(), heap_size()));
+        return std::hash<std::string_view>{}(
+            std::string_view(reinterpret_cast<const char *>(raw), tag()));
+    }
+
+    /**
+     * @brief Compare two strings
+     * @details Integers and inline strings compare as two 64-bit words
+     */
+    bool operator==(const CompactString &other) const
+    {
+        if (on_heap() && other.on_heap())
+            return heap_size() == other.heap_size() && (heap_data() == other.heap_data() ||
+                   std::memcmp(heap_data(), other.heap_data(), heap_size()) == 0);
+        return std::memcmp(raw, other.raw, sizeof(raw)) == 0;
+    }
+
+    bool operator!=(const CompactString &other) const { return !(*this == other); }
+};
+
+namespace std
+{
+template <>
+struct hash<CompactString>
+{
+    size_t operator()(const CompactString &s) const { return s.hash(); }
+};
+}
@@ -0,0 +1,217 @@
+/**
+ * @file DumpPayload.h
+ * @brief Serialized key format of DUMP/RESTORE for BLINK DB
+ */
+
+ #pragma once
+ #include <array>
+ #include <chrono>
+ #include <cstdint>
+ #include <cstring>
+ #include <string>
+ #include <string_view>
+ #include "CompactString.h"
+
+ /**
+  * @class DumpPayload
+  * @brief Encoder and decoder of DUMP blobs
+  *
+  * @details Layout (integers little-endian, lengths as LEB128 varints):
+  *
+  *     "BDMP" | format version (1 byte) | kind (1 byte) | records... | CRC-32
+  *
+  * kind is SINGLE for DUMP (one record, key given to RESTORE) or KEYED for
+  * MDUMP (any number of records, each carrying its key). A record is
+  *
+  *     type (1 byte) | TTL (varint, remaining seconds + 1, 0 = none) |
+  *     [key length, key] | value
+  *
+  * where the value is a length and raw bytes for STRING, or 8 bytes for
+  * INTEGER, mirroring CompactString so that neither side re-parses numbers.
+  * The CRC-32 covers everything before it. Readers reject a newer format
+  * version, an unknown kind or type, and any checksum mismatch.
+  */
+ class DumpPayload {
+ public:
+     static constexpr uint8_t FORMAT_VERSION = 1; ///< Version written by this build
+
+     /**
+      * @enum Kind
+      * @brief Whether records carry their key
+      */
+     enum Kind : uint8_t {
+         SINGLE = 0, ///< One record, keyed by the RESTORE argument
+         KEYED = 1   ///< Records carry their own key
+     };
+
+     /**
+      * @struct Record
+      * @brief One decoded key
+      */
+     struct Record {
+         std::string_view key; ///< Key (KEYED payloads only), view into the blob
+         std::string value;    ///< Value text
+         std::chrono::seconds ttl = std::chrono::seconds::max(); ///< Remaining time to live (max = none)
+     };
+
+ private:
+     enum Type : uint8_t { STRING = 0, INTEGER = 1 };
+     static constexpr char MAGIC[4] = {'B', 'D', 'M', 'P'};
+     static constexpr size_t HEADER = 6;  ///< Magic, version, kind
+     static constexpr size_t TRAILER = 4; ///< CRC-32
+
+     std::string_view body; ///< Records of the payload being read
+     size_t pos = 0;        ///< Read position in body
+     Kind kind = SINGLE;    ///< Kind of the payload being read
+
+     static void put_varint(std::string& out, uint64_t v) {
+         while (v >= 0x80) {
+             out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+             v >>= 7;
+         }
+         out.push_back(static_cast<char>(v));
+     }
+
+     bool get_varint(uint64_t& v) {
+         v = 0;
+         for (int shift = 0; shift < 64 && pos < body.size(); shift += 7) {
+             unsigned char byte = static_cast<unsigned char>(body[pos++]);
+             v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+             if (!(byte & 0x80)) return true;
+         }
+         return false;
+     }
+
+     bool get_bytes(size_t n, std::string_view& out) {
+         if (body.size() - pos < n) return false;
+         out = body.substr(pos, n);
+         pos += n;
+         return true;
+     }
+
+ public:
+     /**
+      * @brief CRC-32 (IEEE 802.3, reflected) of a byte range
+      * @param data Bytes to checksum
+      * @return uint32_t Checksum
+      */
+     static uint32_t crc32(std::string_view data) {
+         static const std::array<uint32_t, 256> table = [] {
+             std::array<uint32_t, 256> t{};
+             for (uint32_t i = 0; i < 256; i++) {
+                 uint32_t c = i;
+                 for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+                 t[i] = c;
+             }
+             return t;
+         }();
+         uint32_t crc = 0xffffffffu;
+         for (unsigned char byte : data) crc = table[(crc ^ byte) & 0xff] ^ (crc >> 8);
+         return crc ^ 0xffffffffu;
+     }
+
+     /**
+      * @brief Start a payload
+      * @param out Buffer to append to
+      * @param kind SINGLE or KEYED
+      */
+     static void begin(std::string& out, Kind kind) {
+         out.append(MAGIC, sizeof(MAGIC));
+         out.push_back(static_cast<char>(FORMAT_VERSION));
+         out.push_back(static_cast<char>(kind));
+     }
+
+     /**
+      * @brief Append one record
+      * @param out Buffer passed to begin()
+      * @param key Key to embed (ignored for SINGLE payloads, pass an empty view)
+      * @param keyed Whether the payload is KEYED
+      * @param value Stored value
+      * @param ttl Remaining time to live, seconds::max() for none
+      */
+     static void add(std::string& out, bool keyed, std::string_view key,
+                     const CompactString& value, std::chrono::seconds ttl) {
+         out.push_back(static_cast<char>(value.is_integer() ? INTEGER : STRING));
+         put_varint(out, ttl == std::chrono::seconds::max() ? 0 : static_cast<uint64_t>(ttl.count()) + 1);
+         if (keyed) {
+             put_varint(out, key.size());
+             out.append(key);
+         }
+         if (value.is_integer()) {
+             uint64_t v = static_cast<uint64_t>(value.integer());
+             for (int i = 0; i < 8; i++) out.push_back(static_cast<char>(v >> (8 * i)));
+         } else {
+             put_varint(out, value.size());
+             value.append_to(out);
+         }
+     }
+
+     /**
+      * @brief Seal a payload with its checksum
+      * @param out Buffer passed to begin()
+      */
+     static void finish(std::string& out) {
+         uint32_t crc = crc32(out);
+         for (int i = 0; i < 4; i++) out.push_back(static_cast<char>(crc >> (8 * i)));
+     }
+
+     /**
+      * @brief Validate a payload and prepare to read its records
+      * @param blob Payload; must outlive the reader
+      * @return true If magic, version, kind and checksum are valid
+      */
+     bool open(std::string_view blob) {
+         if (blob.size() < HEADER + TRAILER || blob.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0)
+             return false;
+         uint8_t version = static_cast<uint8_t>(blob[4]);
+         uint8_t k = static_cast<uint8_t>(blob[5]);
+         if (version == 0 || version > FORMAT_VERSION || k > KEYED) return false;
+
+         uint32_t stored = 0;
+         for (int i = 0; i < 4; i++)
+             stored |= static_cast<uint32_t>(static_cast<unsigned char>(blob[blob.size() - 4 + i])) << (8 * i);
+         if (crc32(blob.substr(0, blob.size() - TRAILER)) != stored) return false;
+
+         kind = static_cast<Kind>(k);
+         body = blob.substr(HEADER, blob.size() - HEADER - TRAILER);
+         pos = 0;
+         return true;
+     }
+
+     /**
+      * @brief Kind of the opened payload
+      */
+     Kind payload_kind() const { return kind; }
+
+     /**
+      * @brief Check whether every record has been read
+      */
+     bool at_end() const { return pos == body.size(); }
+
+     /**
+      * @brief Decode the next record
+      * @param[out] record Decoded record
+      * @return true If a well-formed record was read
+      */
+     bool next(Record& record) {
+         std::string_view bytes;
+         uint64_t ttl, len;
+         if (!get_bytes(1, bytes) || !get_varint(ttl) || ttl > static_cast<uint64_t>(UINT32_MAX) + 1)
+             return false;
+         uint8_t type = static_cast<uint8_t>(bytes[0]);
+         record.ttl = ttl == 0 ? std::chrono::seconds::max() : std::chrono::seconds(ttl - 1);
+         record.key = std::string_view();
+         if (kind == KEYED && (!get_varint(len) || !get_bytes(len, record.key))) return false;
+
+         if (type == INTEGER) {
+             if (!get_bytes(8, bytes)) return false;
+             uint64_t v = 0;
+             for (int i = 0; i < 8; i++) v |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+             record.value = std::to_string(static_cast<int64_t>(v));
+             return true;
+         }
+         if (type != STRING || !get_varint(len) || !get_bytes(len, bytes)) return false;
+         record.value.assign(bytes);
+         return true;
+     }
+ };
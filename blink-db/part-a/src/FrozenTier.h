@@ -0,0 +1,334 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @class FrozenTier
+ * @brief Immutable key-value table addressed by a minimal perfect hash
+ *
+ * @details Holds read-only keys moved out of the mutable HashTable by FREEZE.
+ *          The n keys map onto slots 0..n-1 through a hash-and-displace
+ *          minimal perfect hash (PTHash style): every key hashes into one of
+ *          about n/4 buckets, and each bucket stores a 32-bit pilot chosen at
+ *          build time so that its keys land on distinct free slots. Records
+ *          (varint key length, key, value) are packed back to back in slot
+ *          order in one heap and located through an offset array, so there are
+ *          no nodes and no per-entry pointers: about 9 bytes of metadata per
+ *          key plus the payload. A lookup reads one pilot, one offset pair and
+ *          the record, and compares the key to reject keys that were never
+ *          frozen.
+ *
+ *          The only mutable state is a tombstone bit per slot. erase() hides a
+ *          key once the mutable tier takes it over (overwrite or delete); the
+ *          record itself stays until the tier is rebuilt.
+ */
+class FrozenTier
+{
+private:
+    static constexpr size_t KEYS_PER_BUCKET = 4; ///< Average bucket size
+    static constexpr int MAX_SEEDS = 16;         ///< Build attempts before giving up
+
+    std::vector<uint32_t> pilots;  ///< Displacement of each bucket
+    std::vector<uint64_t> offsets; ///< Start of each slot's record in heap, plus the end
+    std::string heap;              ///< Records in slot order
+    std::vector<uint64_t> dead;    ///< Tombstone bit per slot
+    uint64_t seed = 0;             ///< Hash seed of this build
+    size_t live = 0;               ///< Slots not tombstoned
+
+    /**
+     * @brief 64-bit finalizer (MurmurHash3 fmix64)
+     */
+    static uint64_t mix(uint64_t x)
+    {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    /**
+     * @brief Map a 64-bit hash uniformly onto [0, n) without a division
+     */
+    static size_t reduce(uint64_t h, size_t n)
+    {
+        return static_cast<size_t>((static_cast<unsigned __int128>(h) * n) >> 64);
+    }
+
+    uint64_t key_hash(std::string_view key) const
+    {
+        return mix(std::hash<std::string_view>{}(key) ^ seed);
+    }
+
+    size_t bucket_of(uint64_t h) const { return reduce(h, pilots.size()); }
+
+    size_t slot_of(uint64_t h, uint32_t pilot) const
+    {
+        // Mixed after combining: keys whose hashes share their high bits must
+        // still move independently as the pilot changes
+        return reduce(mix(h ^ (pilot * 0x9e3779b97f4a7c15ULL + seed)), offsets.size() - 1);
+    }
+
+    size_t slot_for(std::string_view key) const
+    {
+        uint64_t h = key_hash(key);
+        return slot_of(h, pilots[bucket_of(h)]);
+    }
+
+    bool is_dead(size_t slot) const { return (dead[slot >> 6] >> (slot & 63)) & 1; }
+
+    /**
+     * @brief Decode the record stored in a slot
+     */
+    void record(size_t slot, std::string_view &key, std::string_view &value) const
+    {
+        const char *p = heap.data() + offsets[slot];
+        const char *end = heap.data() + offsets[slot + 1];
+        size_t key_len = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            unsigned char byte = static_cast<unsigned char>(*p++);
+            key_len |= static_cast<size_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                break;
+        }
+        key = std::string_view(p, key_len);
+        value = std::string_view(p + key_len, end - p - key_len);
+    }
+
+    /**
+     * @brief Choose a pilot for every bucket under the current seed
+     * @param hashes Key hash of each record
+     * @param[out] slot_of_record Slot assigned to each record
+     * @return true If every bucket found a pilot within the search limit
+     *
+     * @details Buckets are placed largest first, while most slots are free.
+     *          The last single-key buckets need about n / free tries each, so
+     *          the limit scales with n.
+     */
+    bool place(const std::vector<uint64_t> &hashes, std::vector<uint32_t> &slot_of_record)
+    {
+        size_t n = hashes.size();
+        size_t buckets = pilots.size();
+
+        // Group records by bucket (counting sort)
+        std::vector<uint32_t> start(buckets + 1, 0);
+        for (uint64_t h : hashes)
+            start[bucket_of(h) + 1]++;
+        std::partial_sum(start.begin(), start.end(), start.begin());
+        std::vector<uint32_t> members(n);
+        std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+        for (uint32_t i = 0; i < n; i++)
+            members[fill[bucket_of(hashes[i])]++] = i;
+
+        std::vector<uint32_t> order(buckets);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+                         { return start[a + 1] - start[a] > start[b + 1] - start[b]; });
+
+        const uint64_t limit = std::min<uint64_t>(UINT32_MAX, std::max<uint64_t>(1u << 20, 8 * n));
+        std::vector<bool> taken(n, false);
+        std::vector<size_t> positions;
+        for (uint32_t b : order)
+        {
+            if (start[b + 1] == start[b])
+                break;
+            bool placed = false;
+            for (uint64_t pilot = 0; pilot < limit && !placed; pilot++)
+            {
+                positions.clear();
+                placed = true;
+                for (uint32_t m = start[b]; m < start[b + 1]; m++)
+                {
+                    size_t p = slot_of(hashes[members[m]], static_cast<uint32_t>(pilot));
+                    if (taken[p] || std::find(positions.begin(), positions.end(), p) != positions.end())
+                    {
+                        placed = false;
+                        break;
+                    }
+                    positions.push_back(p);
+                }
+                if (placed)
+                    pilots[b] = static_cast<uint32_t>(pilot);
+            }
+            if (!placed)
+                return false;
+            for (uint32_t m = start[b]; m < start[b + 1]; m++)
+            {
+                size_t p = positions[m - start[b]];
+                taken[p] = true;
+                slot_of_record[members[m]] = static_cast<uint32_t>(p);
+            }
+        }
+        return true;
+    }
+
+public:
+    /**
+     * @brief Construct an empty tier
+     */
+    FrozenTier() = default;
+
+    /**
+     * @brief Build a tier from key-value records
+     * @param records Records to freeze; keys must be distinct
+     * @throws std::runtime_error If no perfect hash is found (only possible
+     *         with duplicate keys)
+     */
+    explicit FrozenTier(const std::vector<std::pair<std::string, std::string>> &records)
+    {
+        size_t n = records.size();
+        if (n == 0)
+            return;
+        if (n > UINT32_MAX)
+            throw std::length_error("FrozenTier: too many keys");
+
+        pilots.assign(n / KEYS_PER_BUCKET + 1, 0);
+        offsets.assign(n + 1, 0);
+        std::vector<uint64_t> hashes(n);
+        std::vector<uint32_t> slot_of_record(n);
+        for (int attempt = 0;; attempt++)
+        {
+            if (attempt == MAX_SEEDS)
+                throw std::runtime_error("FrozenTier: no perfect hash found (duplicate keys?)");
+            seed = mix(0x9e3779b97f4a7c15ULL * (attempt + 1));
+            for (size_t i = 0; i < n; i++)
+                hashes[i] = key_hash(records[i].first);
+            std::fill(pilots.begin(), pilots.end(), 0);
+            if (place(hashes, slot_of_record))
+                break;
+        }
+
+        std::vector<uint32_t> record_at(n);
+        size_t total = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            record_at[slot_of_record[i]] = static_cast<uint32_t>(i);
+            total += 10 + records[i].first.size() + records[i].second.size();
+        }
+        heap.reserve(total);
+        for (size_t slot = 0; slot < n; slot++)
+        {
+            const auto &rec = records[record_at[slot]];
+            offsets[slot] = heap.size();
+            for (size_t len = rec.first.size(); ; len >>= 7)
+            {
+                unsigned char byte = len & 0x7f;
+                if (len >= 0x80)
+                    byte |= 0x80;
+                heap.push_back(static_cast<char>(byte));
+                if (len < 0x80)
+                    break;
+            }
+            heap.append(rec.first);
+            heap.append(rec.second);
+        }
+        offsets[n] = heap.size();
+        heap.shrink_to_fit();
+        dead.assign((n + 63) / 64, 0);
+        live = n;
+    }
+
+    /**
+     * @brief Look up a key
+     * @param key Key to find
+     * @param[out] value View of the value, valid until the tier is replaced
+     * @return true If the key is frozen and not erased
+     */
+    bool find(std::string_view key, std::string_view &value) const
+    {
+        if (live == 0)
+            return false;
+        size_t slot = slot_for(key);
+        if (is_dead(slot))
+            return false;
+        std::string_view stored;
+        record(slot, stored, value);
+        return stored == key;
+    }
+
+    /**
+     * @brief Hide a key from lookups
+     * @param key Key to erase
+     * @return true If the key was frozen and not yet erased
+     */
+    bool erase(std::string_view key)
+    {
+        if (live == 0)
+            return false;
+        size_t slot = slot_for(key);
+        if (is_dead(slot))
+            return false;
+        std::string_view stored, value;
+        record(slot, stored, value);
+        if (stored != key)
+            return false;
+        dead[slot >> 6] |= uint64_t(1) << (slot & 63);
+        live--;
+        return true;
+    }
+
+    /**
+     * @brief Visit slots in order, reporting live records
+     * @param slot First slot to visit (0 to start)
+     * @param count Slots to visit
+     * @param fn Callback invoked as fn(std::string_view key, std::string_view value)
+     * @return size_t Next slot, or 0 once every slot has been visited
+     */
+    template <typename Fn>
+    size_t scan(size_t slot, size_t count, Fn &&fn) const
+    {
+        size_t n = slots();
+        for (; slot < n && count > 0; slot++, count--)
+        {
+            if (is_dead(slot))
+                continue;
+            std::string_view key, value;
+            record(slot, key, value);
+            fn(key, value);
+        }
+        return slot >= n ? 0 : slot;
+    }
+
+    /**
+     * @brief Visit every live record
+     * @param fn Callback invoked as fn(std::string_view key, std::string_view value)
+     */
+    template <typename Fn>
+    void for_each(Fn &&fn) const
+    {
+        scan(0, slots(), fn);
+    }
+
+    /**
+     * @brief Number of live keys
+     */
+    size_t size() const { return live; }
+
+    /**
+     * @brief Check whether no live key is left
+     */
+    bool empty() const { return live == 0; }
+
+    /**
+     * @brief Number of slots, including erased ones
+     */
+    size_t slots() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+    /**
+     * @brief Bytes held by the tier (pilots, offsets, heap and tombstones)
+     */
+    size_t memory_bytes() const
+    {
+        return pilots.capacity() * sizeof(uint32_t) + offsets.capacity() * sizeof(uint64_t) +
+               heap.capacity() + dead.capacity() * sizeof(uint64_t);
+    }
+};
@@ -0,0 +1,238 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <bitset>
+#include <cstring>
+
+/**
+ * @class GlobPattern
+ * @brief Compiled glob pattern used by SCAN ... MATCH
+ *
+ * @details Supports the Redis glob syntax: '*' (any run), '?' (any byte),
+ *          '[abc]', '[a-z]', '[^abc]' classes and '\' escapes. The pattern is
+ *          compiled once per call into fixed-width segments separated by '*'.
+ *          The first and last segments are anchored, and the middle segments
+ *          are matched leftmost-first, so matching is linear with no
+ *          backtracking. Literal runs are located with memchr/memmem, which
+ *          libc implements with SIMD, and the common shapes ("*", "prefix*",
+ *          "*suffix", "*infix*", exact) reduce to a single memcmp/memmem.
+ */
+class GlobPattern
+{
+private:
+    /**
+     * @struct Atom
+     * @brief One single-byte matcher inside a segment
+     */
+    struct Atom
+    {
+        bool literal = true;      ///< True for a plain byte, false for '?' or a class
+        unsigned char c = 0;      ///< Byte to match when literal
+        std::bitset<256> allowed; ///< Accepted bytes when not literal
+    };
+
+    /**
+     * @struct Segment
+     * @brief Fixed-width run of atoms between two '*'
+     */
+    struct Segment
+    {
+        std::vector<Atom> atoms; ///< Matchers, one per byte
+        std::string literal;     ///< Literal bytes when every atom is literal
+        bool all_literal = true; ///< Whether memcmp/memmem can be used directly
+    };
+
+    std::vector<Segment> segments; ///< Segments in pattern order
+    bool has_star = false;         ///< Whether the pattern contains any '*'
+    bool match_all = false;        ///< Pattern consists only of '*'
+
+    /**
+     * @brief Parse a bracket class starting after '['
+     * @return size_t Index just past the closing ']'
+     */
+    static size_t parse_class(const std::string &p, size_t i, Atom &atom)
+    {
+        bool negate = false;
+        if (i < p.size() && (p[i] == '^' || p[i] == '!'))
+        {
+            negate = true;
+            ++i;
+        }
+        while (i < p.size() && p[i] != ']')
+        {
+            if (p[i] == '\\' && i + 1 < p.size())
+                ++i;
+            unsigned char lo = static_cast<unsigned char>(p[i]);
+            if (i + 2 < p.size() && p[i + 1] == '-' && p[i + 2] != ']')
+            {
+                unsigned char hi = static_cast<unsigned char>(p[i + 2]);
+                if (lo > hi)
+                    std::swap(lo, hi);
+                for (unsigned c = lo; c <= hi; ++c)
+                    atom.allowed.set(c);
+                i += 3;
+            }
+            else
+            {
+                atom.allowed.set(lo);
+                ++i;
+            }
+        }
+        if (negate)
+            atom.allowed.flip();
+        return i < p.size() ? i + 1 : i;
+    }
+
+    /**
+     * @brief Check whether a segment matches s at offset pos
+     */
+    static bool match_at(const Segment &seg, const char *s, size_t pos)
+    {
+        if (seg.all_literal)
+            return std::memcmp(s + pos, seg.literal.data(), seg.literal.size()) == 0;
+
+        for (size_t i = 0; i < seg.atoms.size(); ++i)
+        {
+            const Atom &a = seg.atoms[i];
+            unsigned char c = static_cast<unsigned char>(s[pos + i]);
+            if (a.literal ? c != a.c : !a.allowed.test(c))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Find the leftmost match of a segment within s[from, limit]
+     * @param limit Last admissible start offset
+     * @return size_t Start offset, or std::string::npos if there is none
+     */
+    static size_t find(const Segment &seg, const char *s, size_t from, size_t limit)
+    {
+        if (from > limit)
+            return std::string::npos;
+        if (seg.atoms.empty())
+            return from;
+
+        size_t len = seg.atoms.size();
+        if (seg.all_literal)
+        {
+            const void *hit = memmem(s + from, limit - from + len, seg.literal.data(), len);
+            return hit ? static_cast<size_t>(static_cast<const char *>(hit) - s) : std::string::npos;
+        }
+
+        const Atom &first = seg.atoms[0];
+        size_t pos = from;
+        while (pos <= limit)
+        {
+            if (first.literal)
+            {
+                const void *hit = std::memchr(s + pos, first.c, limit - pos + 1);
+                if (!hit)
+                    return std::string::npos;
+                pos = static_cast<size_t>(static_cast<const char *>(hit) - s);
+            }
+            if (match_at(seg, s, pos))
+                return pos;
+            ++pos;
+        }
+        return std::string::npos;
+    }
+
+public:
+    /**
+     * @brief Compile a glob pattern
+     * @param pattern Pattern text (e.g. "session:*:cart", "user:[0-9]?")
+     */
+    explicit GlobPattern(const std::string &pattern)
+    {
+        segments.emplace_back();
+        for (size_t i = 0; i < pattern.size();)
+        {
+            char ch = pattern[i];
+            if (ch == '*')
+            {
+                has_star = true;
+                while (i < pattern.size() && pattern[i] == '*')
+                    ++i;
+                segments.emplace_back();
+                continue;
+            }
+
+            Atom atom;
+            if (ch == '?')
+            {
+                atom.literal = false;
+                atom.allowed.set();
+                ++i;
+            }
+            else if (ch == '[')
+            {
+                atom.literal = false;
+                i = parse_class(pattern, i + 1, atom);
+            }
+            else
+            {
+                if (ch == '\\' && i + 1 < pattern.size())
+                    ++i;
+                atom.c = static_cast<unsigned char>(pattern[i]);
+                ++i;
+            }
+
+            Segment &seg = segments.back();
+            seg.atoms.push_back(atom);
+            if (atom.literal)
+                seg.literal.push_back(static_cast<char>(atom.c));
+            else
+                seg.all_literal = false;
+        }
+
+        match_all = has_star && segments.size() == 2 &&
+                    segments[0].atoms.empty() && segments[1].atoms.empty();
+    }
+
+    /**
+     * @brief Test a key against the pattern
+     * @param key Key to test
+     * @return true If the whole key matches
+     */
+    bool matches(const std::string &key) const
+    {
+        if (match_all)
+            return true;
+
+        const char *s = key.data();
+        size_t n = key.size();
+
+        if (!has_star)
+            return segments[0].atoms.size() == n && match_at(segments[0], s, 0);
+
+        const Segment &head = segments.front();
+        const Segment &tail = segments.back();
+        if (n < head.atoms.size() + tail.atoms.size())
+            return false;
+        if (!match_at(head, s, 0))
+            return false;
+        size_t tail_pos = n - tail.atoms.size();
+        if (!match_at(tail, s, tail_pos))
+            return false;
+
+        size_t pos = head.atoms.size();
+        for (size_t i = 1; i + 1 < segments.size(); ++i)
+        {
+            const Segment &seg = segments[i];
+            if (pos + seg.atoms.size() > tail_pos)
+                return false;
+            size_t hit = find(seg, s, pos, tail_pos - seg.atoms.size());
+            if (hit == std::string::npos)
+                return false;
+            pos = hit + seg.atoms.size();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Check whether the pattern accepts every key
+     * @return true For "*" (and runs of '*')
+     */
+    bool matches_everything() const { return match_all; }
+};
@@ -1,9 +1,12 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include <list>
 #include <string>
+#include "HugePages.h"
 #include <functional>
 #include <stdexcept>
+#include <utility>
 
 /**
  * @class HashTable
@@ -14,6 +17,10 @@
  * @details Implements a hash table with dynamic resizing and LRU-friendly structure.
  *          Uses separate chaining for collision resolution. Automatically resizes
  *          when load factor exceeds 0.7 or falls below 0.2 (for capacities > 8).
+ *          The bucket array is mapped directly with mmap (optionally on 2MB
+ *          pages) and resized in place with mremap. Resizing is incremental:
+ *          buckets are split or merged a few at a time by later operations
+ *          and by rehash_step().
  */
 template <typename K, typename V>
 class HashTable
@@ -37,86 +44,312 @@ private:
          */
         Node(const K &k, const V &v, Node *n = nullptr)
             : key(k), value(v), next(n) {}
+
+        /**
+         * @brief Construct a Node that takes over an existing value
+         * @param k Key for the node (copied into a fresh allocation)
+         * @param v Value to move in
+         * @param n Pointer to next node in chain
+         */
+        Node(const K &k, V &&v, Node *n)
+            : key(k), value(std::move(v)), next(n) {}
     };
 
-    std::vector<Node *> table;    ///< The hash table buckets
-    size_t capacity;              ///< Current number of buckets
+    /**
+     * @enum Rehash
+     * @brief Direction of an in-progress incremental resize
+     */
+    enum class Rehash
+    {
+        NONE,     ///< Table is stable
+        GROWING,  ///< Splitting buckets [0, capacity/2) into their upper twins
+        SHRINKING ///< Merging buckets [capacity/2, capacity) into their lower twins
+    };
+
+    Node **table;                 ///< The hash table buckets (mmap'ed)
+    size_t capacity;              ///< Current number of buckets (the larger size while rehashing)
+    HugePageMode page_mode;       ///< Page backing of the bucket array
     size_t size;                  ///< Number of elements in the table
+    Rehash rehash = Rehash::NONE; ///< Resize in progress, if any
+    size_t rehash_pos = 0;        ///< Lower buckets below this index are already split/merged
     const double LOAD_FACTOR = 0.7; ///< Load factor threshold for resizing
+    static constexpr size_t STEPS_PER_OP = 2; ///< Buckets rehashed by every insert/remove
 
     /**
      * @brief Hash function for key distribution
      * @param key The key to hash
      * @return size_t Bucket index
+     *
+     * @details Capacity is always a power of two, so the index is a mask of the
+     *          hash. This keeps a key's bucket in a table of size 2N either equal
+     *          to its bucket in a table of size N or that plus N, which scan()
+     *          and incremental rehashing rely on. While a resize is in
+     *          progress, keys whose lower bucket has not been processed yet
+     *          are still found where the old size put them.
      */
     size_t hash(const K &key) const
     {
-        return std::hash<K>{}(key) % capacity;
+        size_t h = std::hash<K>{}(key);
+        if (rehash == Rehash::NONE)
+            return h & (capacity - 1);
+
+        size_t half = capacity / 2;
+        size_t lower = h & (half - 1);
+        bool done = lower < rehash_pos;
+        if (rehash == Rehash::GROWING)
+            return done ? h & (capacity - 1) : lower;
+        return done ? lower : h & (capacity - 1);
     }
 
     /**
-     * @brief Resize the hash table to new capacity
-     * @param new_capacity New number of buckets
-     * 
-     * @details Rehashes all existing entries into new table. Complexity O(n)
+     * @brief Reverse the bit order of a word
+     * @param v Word to reverse
+     * @return size_t v with bit i moved to bit (width - 1 - i)
      */
-    void resize(size_t new_capacity)
+    static size_t reverse_bits(size_t v)
     {
-        std::vector<Node *> new_table(new_capacity, nullptr);
+        size_t r = 0;
+        for (size_t i = 0; i < sizeof(size_t) * 8; ++i)
+        {
+            r = (r << 1) | (v & 1);
+            v >>= 1;
+        }
+        return r;
+    }
 
-        // Rehash all entries
-        for (size_t i = 0; i < capacity; ++i)
+    /**
+     * @brief Advance a cursor to the next bucket in reverse-binary order
+     * @param cursor Current cursor
+     * @return size_t Next cursor, 0 after the last bucket
+     */
+    size_t next_cursor(size_t cursor) const
+    {
+        cursor |= ~(capacity - 1);
+        cursor = reverse_bits(cursor);
+        cursor++;
+        return reverse_bits(cursor);
+    }
+
+    /**
+     * @brief Begin doubling the table
+     *
+     * @details The bucket array is grown with mremap, so its contents are
+     *          never copied and the new upper half reads as empty. Buckets are
+     *          then split one at a time by rehash_step(). If the array cannot
+     *          grow at all, the table keeps its capacity (chains get longer)
+     *          and the next insert tries again.
+     */
+    void start_grow()
+    {
+        void *grown = HugePages::remap_pages(
+            table, capacity * sizeof(Node *), 2 * capacity * sizeof(Node *), page_mode);
+        if (!grown)
+            return;
+        table = static_cast<Node **>(grown);
+        capacity *= 2;
+        rehash = Rehash::GROWING;
+        rehash_pos = 0;
+    }
+
+    /**
+     * @brief Begin halving the table
+     *
+     * @details Upper buckets are merged into their lower twins by
+     *          rehash_step(); the array is shrunk once all are merged.
+     */
+    void start_shrink()
+    {
+        rehash = Rehash::SHRINKING;
+        rehash_pos = 0;
+    }
+
+    /**
+     * @brief Split or merge the next bucket pair of an in-progress resize
+     *
+     * @details Growing moves the entries of bucket i whose hash has the old
+     *          capacity bit set to bucket i + capacity/2. Shrinking appends
+     *          bucket i + capacity/2 to bucket i. Complexity O(chain length)
+     */
+    void rehash_bucket()
+    {
+        size_t half = capacity / 2;
+        size_t i = rehash_pos;
+
+        if (rehash == Rehash::GROWING)
         {
+            Node **stay = &table[i];
+            Node **move = &table[i + half];
             Node *current = table[i];
             while (current)
             {
                 Node *next = current->next;
-                size_t new_index = std::hash<K>{}(current->key) % new_capacity;
-
-                current->next = new_table[new_index];
-                new_table[new_index] = current;
-
+                if (std::hash<K>{}(current->key) & half)
+                {
+                    *move = current;
+                    move = &current->next;
+                }
+                else
+                {
+                    *stay = current;
+                    stay = &current->next;
+                }
                 current = next;
             }
+            *stay = nullptr;
+            *move = nullptr;
+        }
+        else
+        {
+            Node *upper = table[i + half];
+            if (upper)
+            {
+                Node **tail = &table[i];
+                while (*tail)
+                    tail = &(*tail)->next;
+                *tail = upper;
+                table[i + half] = nullptr;
+            }
         }
 
-        table = std::move(new_table);
-        capacity = new_capacity;
+        if (++rehash_pos < half)
+            return;
+
+        if (rehash == Rehash::SHRINKING)
+        {
+            table = static_cast<Node **>(HugePages::remap_pages(
+                table, capacity * sizeof(Node *), half * sizeof(Node *), page_mode));
+            capacity = half;
+        }
+        rehash = Rehash::NONE;
+        rehash_pos = 0;
     }
 
 public:
     /**
      * @brief Get the internal table structure
-     * @return std::vector<Node*>& Reference to the bucket array
+     * @return Node** The bucket array (get_capacity() entries)
+     */
+    Node **get_table() { return table; }
+
+    /**
+     * @brief Get the page backing actually used for the bucket array
+     * @return HugePageMode OFF, THP, or HUGETLB if explicit huge pages were available
      */
-    std::vector<Node *> &get_table() { return table; }
+    HugePageMode get_page_mode() const { return page_mode; }
 
     /**
      * @brief Get current table capacity
-     * @return size_t Number of buckets
+     * @return size_t Number of buckets (the larger of the two sizes while rehashing)
      */
     size_t get_capacity() const { return capacity; }
 
+    /**
+     * @brief Check whether an incremental resize is in progress
+     * @return true While buckets remain to be split or merged
+     */
+    bool is_rehashing() const { return rehash != Rehash::NONE; }
+
+    /**
+     * @brief Begin halving the table if it is sparse
+     * @return true If a shrink was started
+     *
+     * @details Applies the same rule as remove(): load factor below 0.2 for
+     *          capacities > 8. Lets a background task keep shrinking a table
+     *          that stopped receiving removes.
+     */
+    bool shrink_if_sparse()
+    {
+        if (rehash != Rehash::NONE || capacity <= 8 || size >= 0.2 * capacity)
+            return false;
+        start_shrink();
+        return true;
+    }
+
+    /**
+     * @brief Advance an in-progress resize
+     * @param buckets Maximum number of bucket pairs to process
+     * @return true If the resize is still incomplete afterwards
+     *
+     * @details Every insert and remove already does a couple of steps, which
+     *          guarantees a resize finishes before the next one is needed;
+     *          calling this from a background task finishes it sooner.
+     */
+    bool rehash_step(size_t buckets)
+    {
+        while (rehash != Rehash::NONE && buckets-- > 0)
+            rehash_bucket();
+        return rehash != Rehash::NONE;
+    }
+
+    /**
+     * @brief Pre-size the table for an expected number of elements
+     * @param expected Element count to hold without growing
+     *
+     * @details Finishes any in-progress resize, then grows the bucket array
+     *          to its final size in one mremap and redistributes every chain
+     *          in a single pass, instead of doubling repeatedly during a bulk
+     *          insert. Never shrinks. Time complexity: O(size + new capacity)
+     */
+    void reserve(size_t expected)
+    {
+        rehash_step(SIZE_MAX);
+        size_t target = capacity;
+        while (expected >= LOAD_FACTOR * target)
+            target <<= 1;
+        if (target == capacity)
+            return;
+
+        size_t old_capacity = capacity;
+        void *grown = HugePages::remap_pages(
+            table, old_capacity * sizeof(Node *), target * sizeof(Node *), page_mode);
+        if (!grown)
+            return; // Inserts grow the table step by step instead
+        table = static_cast<Node **>(grown);
+        capacity = target;
+
+        // A key in old bucket i moves to i + k * old_capacity, so chains only
+        // ever move into buckets that have not been visited yet (or stay put)
+        for (size_t i = 0; i < old_capacity; ++i)
+        {
+            Node *current = table[i];
+            table[i] = nullptr;
+            while (current)
+            {
+                Node *next = current->next;
+                size_t index = std::hash<K>{}(current->key) & (capacity - 1);
+                current->next = table[index];
+                table[index] = current;
+                current = next;
+            }
+        }
+    }
+
     /**
      * @brief Construct a new Hash Table object
-     * @param initial_capacity Starting number of buckets (default: 8)
+     * @param initial_capacity Starting number of buckets (default: 8),
+     *        rounded up to a power of two
+     * @param pages Page backing for the bucket array (default: regular pages)
      * @throws std::invalid_argument If initial_capacity < 1
+     * @throws std::bad_alloc If the bucket array cannot be mapped
      */
-    explicit HashTable(size_t initial_capacity = 8)
-        : capacity(initial_capacity), size(0)
+    explicit HashTable(size_t initial_capacity = 8, HugePageMode pages = HugePageMode::OFF)
+        : table(nullptr), capacity(1), page_mode(pages), size(0)
     {
         if (initial_capacity < 1)
             throw std::invalid_argument("Invalid capacity");
-        table.resize(capacity, nullptr);
+        while (capacity < initial_capacity)
+            capacity <<= 1;
+        table = static_cast<Node **>(HugePages::map_pages(capacity * sizeof(Node *), page_mode));
     }
 
     /**
      * @brief Destroy the Hash Table object
-     * @details Clears all nodes and deallocates memory
+     * @details Clears all nodes and unmaps the bucket array
      */
     ~HashTable()
     {
         clear();
+        HugePages::unmap_pages(table, capacity * sizeof(Node *), page_mode);
     }
 
     /**
@@ -124,14 +357,27 @@ public:
      * @param key The key to insert/update
      * @param value The value to associate with the key
      * 
-     * @details Automatically resizes table if load factor exceeds threshold.
+     * @details Starts doubling the table when the load factor exceeds the
+     *          threshold and advances any in-progress resize by a couple of
+     *          buckets, so no single insert pays for a whole rehash.
      *          Time complexity: O(1) average case, O(n) worst case
      */
     void insert(const K &key, const V &value)
     {
-        if (size >= LOAD_FACTOR * capacity)
+        insert(key, V(value));
+    }
+
+    /**
+     * @brief Insert or update a key-value pair, moving the value in
+     * @param key The key to insert/update (copied on insert)
+     * @param value The value to move into the table
+     */
+    void insert(const K &key, V &&value)
+    {
+        rehash_step(STEPS_PER_OP);
+        if (rehash == Rehash::NONE && size >= LOAD_FACTOR * capacity)
         {
-            resize(2 * capacity);
+            start_grow();
         }
 
         size_t index = hash(key);
@@ -142,14 +388,14 @@ public:
         {
             if (current->key == key)
             {
-                current->value = value;
+                current->value = std::move(value);
                 return;
             }
             current = current->next;
         }
 
         // Insert new node at head of chain
-        table[index] = new Node(key, value, table[index]);
+        table[index] = new Node(key, std::move(value), table[index]);
         size++;
     }
 
@@ -177,17 +423,47 @@ public:
         return false;
     }
 
+    /**
+     * @brief Look up the stored value for a key without copying it
+     * @param key The key to search for
+     * @return V* Pointer to the value in place, or nullptr if not found
+     *
+     * @details The pointer stays valid until the key is removed or the table
+     *          is cleared (resizing relinks nodes without moving them).
+     */
+    V *find(const K &key)
+    {
+        size_t index = hash(key);
+        Node *current = table[index];
+
+        while (current)
+        {
+            if (current->key == key)
+                return &current->value;
+            current = current->next;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Get the number of stored elements
+     * @return size_t Element count
+     */
+    size_t get_size() const { return size; }
+
     /**
      * @brief Remove a key-value pair
      * @param key The key to remove
      * @return true If key was found and removed
      * @return false If key was not found
      * 
-     * @details Automatically shrinks table if load factor falls below 0.2
-     *          (for capacities > 8)
+     * @details Starts halving the table if load factor falls below 0.2
+     *          (for capacities > 8) and advances any in-progress resize by a
+     *          couple of buckets
      */
     bool remove(const K &key)
     {
+        rehash_step(STEPS_PER_OP);
         size_t index = hash(key);
         Node *prev = nullptr;
         Node *current = table[index];
@@ -208,10 +484,7 @@ public:
                 delete current;
                 size--;
 
-                if (capacity > 8 && size < 0.2 * capacity)
-                {
-                    resize(capacity / 2);
-                }
+                shrink_if_sparse();
                 return true;
             }
 
@@ -221,6 +494,64 @@ public:
         return false;
     }
 
+    /**
+     * @brief Visit one bucket and advance a SCAN cursor
+     * @param cursor Cursor returned by the previous call (0 to start)
+     * @param fn Callback invoked as fn(const K&, V&) for each entry in the bucket
+     * @return size_t Next cursor, or 0 once the whole table has been covered
+     *
+     * @details The cursor is incremented in reverse-binary order (high bits
+     *          first). Because growing or shrinking by a factor of two only
+     *          splits or merges buckets that share their low bits, every
+     *          element present for the whole iteration is reported at least
+     *          once even if the table is resized between calls. Elements may
+     *          be reported more than once after a shrink. While a resize is
+     *          in progress, visiting a lower bucket also reports its upper
+     *          twin, so entries moved between the two are never missed.
+     */
+    template <typename Fn>
+    size_t scan(size_t cursor, Fn &&fn)
+    {
+        size_t index = cursor & (capacity - 1);
+        for (Node *current = table[index]; current; current = current->next)
+            fn(current->key, current->value);
+        if (rehash != Rehash::NONE && index < capacity / 2)
+        {
+            for (Node *current = table[index + capacity / 2]; current; current = current->next)
+                fn(current->key, current->value);
+        }
+        return next_cursor(cursor);
+    }
+
+    /**
+     * @brief Reallocate the nodes of one bucket and advance a cursor
+     * @param cursor Cursor returned by the previous call (0 to start)
+     * @param fn Callback invoked as fn(V&) on each relocated value so it can
+     *        move the buffers it owns as well
+     * @return size_t Next cursor (same order as scan()), 0 when done
+     *
+     * @details Every node in the bucket is copied into a fresh allocation and
+     *          relinked in place of the old one before the old node is freed.
+     *          New allocations are served from the allocator's existing holes,
+     *          so a full pass packs live data into dense pages and leaves the
+     *          sparse ones empty for the allocator to release.
+     */
+    template <typename Fn>
+    size_t defrag(size_t cursor, Fn &&fn)
+    {
+        Node **link = &table[cursor & (capacity - 1)];
+        while (*link)
+        {
+            Node *old = *link;
+            Node *fresh = new Node(old->key, std::move(old->value), old->next);
+            fn(fresh->value);
+            *link = fresh;
+            delete old;
+            link = &fresh->next;
+        }
+        return next_cursor(cursor);
+    }
+
     /**
      * @brief Clear all entries from the hash table
      * @details Deallocates all nodes and resets to initial state
@@ -239,6 +570,14 @@ public:
             table[i] = nullptr;
         }
         size = 0;
+        if (rehash == Rehash::SHRINKING)
+        {
+            table = static_cast<Node **>(HugePages::remap_pages(
+                table, capacity * sizeof(Node *), capacity / 2 * sizeof(Node *), page_mode));
+            capacity /= 2;
+        }
+        rehash = Rehash::NONE;
+        rehash_pos = 0;
     }
 
     // Disable copy operations
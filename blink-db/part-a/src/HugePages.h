@@ -0,0 +1,144 @@
+/**
+ * @file HugePages.h
+ * @brief Page-level allocation helpers with optional 2MB page backing
+ */
+
+ #pragma once
+ #include <cstddef>
+ #include <cstring>
+ #include <new>
+ #include <sys/mman.h>
+
+ /**
+  * @enum HugePageMode
+  * @brief How large engine arrays are backed by physical pages
+  */
+ enum class HugePageMode {
+     OFF,     ///< Regular 4KB pages
+     THP,     ///< Transparent huge pages via madvise(MADV_HUGEPAGE)
+     HUGETLB  ///< Explicit hugetlbfs pages via MAP_HUGETLB, falling back to THP
+ };
+
+ /**
+  * @namespace HugePages
+  * @brief mmap/mremap wrappers used for the hash table bucket array
+  *
+  * @details Mappings are anonymous and zero-filled. Every function takes the
+  * byte size the caller asked for and rounds it up the same way, so the caller
+  * only has to remember its logical size. A mapping records nothing about how
+  * it was created: MAP_HUGETLB mappings are rounded to 2MB and regular ones to
+  * the 4KB page size, and unmap_pages/remap_pages use the same rounding.
+  */
+ namespace HugePages {
+
+     constexpr size_t SMALL_PAGE = 4096;             ///< Base page size
+     constexpr size_t HUGE_PAGE = 2 * 1024 * 1024;   ///< x86-64 huge page size
+
+     /**
+      * @brief Round a size up to a multiple of align (a power of two)
+      */
+     inline size_t round_up(size_t bytes, size_t align) {
+         return (bytes + align - 1) & ~(align - 1);
+     }
+
+     /**
+      * @brief Mapping granularity for a mode
+      */
+     inline size_t granule(HugePageMode mode) {
+         return mode == HugePageMode::HUGETLB ? HUGE_PAGE : SMALL_PAGE;
+     }
+
+     /**
+      * @brief Ask for transparent huge pages on ranges large enough to use them
+      */
+     inline void advise(void* addr, size_t bytes, HugePageMode mode) {
+ #ifdef MADV_HUGEPAGE
+         if (mode != HugePageMode::OFF && bytes >= HUGE_PAGE) {
+             madvise(addr, bytes, MADV_HUGEPAGE);
+         }
+ #else
+         (void)addr; (void)bytes; (void)mode;
+ #endif
+     }
+
+     /**
+      * @brief Map zero-filled memory
+      * @param bytes Requested size in bytes
+      * @param[in,out] mode Requested backing; downgraded to THP if hugetlb pages are unavailable
+      * @return void* Start of the mapping
+      * @throws std::bad_alloc If the mapping cannot be created
+      */
+     inline void* map_pages(size_t bytes, HugePageMode& mode) {
+         void* addr = MAP_FAILED;
+ #ifdef MAP_HUGETLB
+         if (mode == HugePageMode::HUGETLB) {
+             addr = mmap(nullptr, round_up(bytes, HUGE_PAGE), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+             if (addr != MAP_FAILED) return addr;
+         }
+ #endif
+         if (mode == HugePageMode::HUGETLB) mode = HugePageMode::THP;
+
+         addr = mmap(nullptr, round_up(bytes, SMALL_PAGE), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+         if (addr == MAP_FAILED) throw std::bad_alloc();
+         advise(addr, round_up(bytes, SMALL_PAGE), mode);
+         return addr;
+     }
+
+     /**
+      * @brief Grow or shrink a mapping, moving it only if the kernel must
+      * @param addr Mapping returned by map_pages/remap_pages
+      * @param old_bytes Size the mapping was created with
+      * @param new_bytes Desired size
+      * @param[in,out] mode Backing the mapping was created with; downgraded
+      *                when a grown mapping had to fall back to regular pages
+      * @return void* Start of the (possibly moved) mapping with grown bytes
+      *               reading as zero, or nullptr if it cannot grow (addr is
+      *               then left untouched). Never fails to shrink.
+      *
+      * @details Page tables are moved instead of copying the contents, so
+      * resizing costs O(pages) rather than O(bytes). When the kernel cannot
+      * grow a mapping in place (typically no hugetlb pages left), a new one is
+      * mapped with map_pages and the contents copied over, O(bytes). A
+      * shrink that mremap refuses unmaps the tail instead. Never throws, so
+      * it is safe to call from code that must not unwind.
+      */
+     inline void* remap_pages(void* addr, size_t old_bytes, size_t new_bytes, HugePageMode& mode) noexcept {
+         size_t g = granule(mode);
+         size_t old_len = round_up(old_bytes, g);
+         size_t new_len = round_up(new_bytes, g);
+         if (old_len == new_len) return addr;
+
+         void* moved = mremap(addr, old_len, new_len, MREMAP_MAYMOVE);
+         if (moved != MAP_FAILED) {
+             if (new_len > old_len) advise(moved, new_len, mode);
+             return moved;
+         }
+         if (new_len < old_len) {
+             munmap(static_cast<char*>(addr) + new_len, old_len - new_len);
+             return addr;
+         }
+
+         HugePageMode fallback = mode;
+         try {
+             moved = map_pages(new_bytes, fallback);
+         } catch (const std::bad_alloc&) {
+             return nullptr;
+         }
+         std::memcpy(moved, addr, old_bytes);
+         munmap(addr, old_len);
+         mode = fallback;
+         return moved;
+     }
+
+     /**
+      * @brief Release a mapping
+      * @param addr Mapping start
+      * @param bytes Size the mapping currently has
+      * @param mode Backing the mapping was created with
+      */
+     inline void unmap_pages(void* addr, size_t bytes, HugePageMode mode) {
+         if (addr) munmap(addr, round_up(bytes, granule(mode)));
+     }
+ }
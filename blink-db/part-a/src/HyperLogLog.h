@@ -0,0 +1,437 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @namespace HyperLogLog
+ * @brief Cardinality sketch stored as a string value (PFADD, PFCOUNT, PFMERGE)
+ *
+ * @details 2^14 registers, each holding the longest run of trailing zeros
+ *          (plus one) seen among the 64-bit hashes routed to it; the standard
+ *          error is 1.04 / sqrt(16384) = 0.81%. A value is
+ *
+ *              "BHLL" | encoding (1 byte) | 3 reserved | cached count (8 bytes)
+ *              | registers
+ *
+ *          with the registers in one of two encodings:
+ *          - DENSE: 6 bits per register, packed least significant bit
+ *            first, 12288 bytes. Updated in place by PFADD.
+ *          - SPARSE: run-length opcodes, as Redis lays them out: ZERO
+ *            (00xxxxxx, 1-64 zero registers), XZERO (01xxxxxx xxxxxxxx,
+ *            1-16384 zero registers) and VAL (1vvvvvxx, 1-4 registers of value
+ *            1-32). A sketch of a few thousand elements takes a few hundred
+ *            bytes; once it would exceed SPARSE_MAX_BYTES or a register
+ *            exceeds 32 it is stored dense.
+ *
+ *          The cached count is valid unless bit 63 is set; every register
+ *          change sets it. Counting and merging work on registers unpacked to
+ *          one byte each, where merging is a byte-wise maximum taken 16
+ *          registers per SSE2 instruction and the estimate comes from a
+ *          register histogram (Ertl's improved estimator, no bias tables).
+ */
+namespace HyperLogLog
+{
+    constexpr int PRECISION = 14;                            ///< Bits of the hash selecting the register
+    constexpr size_t REGISTERS = size_t(1) << PRECISION;     ///< Number of registers
+    constexpr int REGISTER_BITS = 6;                         ///< Width of a dense register
+    constexpr int MAX_RANK = 64 - PRECISION + 1;             ///< Largest register value
+    constexpr size_t HEADER = 16;                            ///< Magic, encoding, reserved, cached count
+    constexpr size_t DENSE_BYTES = REGISTERS * REGISTER_BITS / 8; ///< Packed dense registers
+    constexpr size_t SPARSE_MAX_BYTES = 3000;                ///< Largest sparse encoding before going dense
+    constexpr uint64_t CACHE_STALE = uint64_t(1) << 63;      ///< Cached count must be recomputed
+
+    enum Encoding : uint8_t
+    {
+        DENSE = 0,
+        SPARSE = 1
+    };
+
+    /**
+     * @brief 64-bit MurmurHash2 (MurmurHash64A), stable across builds
+     */
+    inline uint64_t hash(std::string_view data)
+    {
+        const uint64_t m = 0xc6a4a7935bd1e995ULL;
+        const int r = 47;
+        uint64_t h = 0xadc83b19ULL ^ (data.size() * m);
+        const char *p = data.data();
+        size_t blocks = data.size() / 8;
+        for (size_t i = 0; i < blocks; i++, p += 8)
+        {
+            uint64_t k;
+            std::memcpy(&k, p, sizeof(k));
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+            h ^= k;
+            h *= m;
+        }
+        switch (data.size() & 7)
+        {
+        case 7: h ^= uint64_t(static_cast<unsigned char>(p[6])) << 48; [[fallthrough]];
+        case 6: h ^= uint64_t(static_cast<unsigned char>(p[5])) << 40; [[fallthrough]];
+        case 5: h ^= uint64_t(static_cast<unsigned char>(p[4])) << 32; [[fallthrough]];
+        case 4: h ^= uint64_t(static_cast<unsigned char>(p[3])) << 24; [[fallthrough]];
+        case 3: h ^= uint64_t(static_cast<unsigned char>(p[2])) << 16; [[fallthrough]];
+        case 2: h ^= uint64_t(static_cast<unsigned char>(p[1])) << 8; [[fallthrough]];
+        case 1:
+            h ^= uint64_t(static_cast<unsigned char>(p[0]));
+            h *= m;
+        }
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+        return h;
+    }
+
+    /**
+     * @brief Register and rank of an element
+     * @param element Element added
+     * @param[out] index Register the element maps to
+     * @return uint8_t Rank: trailing zeros of the remaining hash bits plus one
+     */
+    inline uint8_t position(std::string_view element, size_t &index)
+    {
+        uint64_t h = hash(element);
+        index = static_cast<size_t>(h & (REGISTERS - 1));
+        h >>= PRECISION;
+        h |= uint64_t(1) << (64 - PRECISION); // Bounds the rank at MAX_RANK
+        return static_cast<uint8_t>(__builtin_ctzll(h) + 1);
+    }
+
+    /**
+     * @brief Read a dense register
+     * @param regs Packed registers (after the header)
+     * @param i Register index
+     */
+    inline uint8_t get_register(const unsigned char *regs, size_t i)
+    {
+        size_t bit = i * REGISTER_BITS;
+        size_t byte = bit >> 3;
+        unsigned shift = bit & 7;
+        unsigned v = regs[byte] >> shift;
+        if (shift > 8 - REGISTER_BITS)
+            v |= static_cast<unsigned>(regs[byte + 1]) << (8 - shift);
+        return static_cast<uint8_t>(v & ((1u << REGISTER_BITS) - 1));
+    }
+
+    /**
+     * @brief Write a dense register
+     * @param regs Packed registers (after the header)
+     * @param i Register index
+     * @param v Value, below 64
+     */
+    inline void set_register(unsigned char *regs, size_t i, uint8_t v)
+    {
+        size_t bit = i * REGISTER_BITS;
+        size_t byte = bit >> 3;
+        unsigned shift = bit & 7;
+        unsigned mask = (1u << REGISTER_BITS) - 1;
+        regs[byte] = static_cast<unsigned char>((regs[byte] & ~(mask << shift)) | (v << shift));
+        if (shift > 8 - REGISTER_BITS)
+        {
+            unsigned high = 8 - shift;
+            regs[byte + 1] = static_cast<unsigned char>((regs[byte + 1] & ~(mask >> high)) | (v >> high));
+        }
+    }
+
+    /**
+     * @brief Check whether a value is a sketch this build can read
+     * @param value Stored value
+     * @return true For a well-formed dense or sparse sketch
+     * @note Dense register values are not checked here, which would unpack
+     *       all of them on every PFADD; decode() clamps them to MAX_RANK
+     */
+    inline bool valid(std::string_view value)
+    {
+        if (value.size() < HEADER || value.compare(0, 4, "BHLL") != 0)
+            return false;
+        if (static_cast<uint8_t>(value[4]) == DENSE)
+            return value.size() == HEADER + DENSE_BYTES;
+        if (static_cast<uint8_t>(value[4]) != SPARSE)
+            return false;
+        size_t covered = 0;
+        for (size_t i = HEADER; i < value.size(); i++)
+        {
+            unsigned char op = static_cast<unsigned char>(value[i]);
+            if ((op & 0xc0) == 0x40)
+            {
+                if (++i == value.size())
+                    return false;
+                covered += (((op & 0x3fu) << 8) | static_cast<unsigned char>(value[i])) + 1;
+            }
+            else
+            {
+                covered += (op & 0x80) ? (op & 3u) + 1 : (op & 0x3fu) + 1;
+            }
+        }
+        return covered == REGISTERS;
+    }
+
+    /**
+     * @brief Check whether a valid sketch is dense
+     */
+    inline bool is_dense(std::string_view value) { return static_cast<uint8_t>(value[4]) == DENSE; }
+
+    /**
+     * @brief Read the cached count of a valid sketch
+     * @param value Stored value
+     * @param[out] count Cached count
+     * @return false If the cache is stale
+     */
+    inline bool cached(std::string_view value, uint64_t &count)
+    {
+        uint64_t stored = 0;
+        for (int i = 0; i < 8; i++)
+            stored |= uint64_t(static_cast<unsigned char>(value[8 + i])) << (8 * i);
+        count = stored;
+        return !(stored & CACHE_STALE);
+    }
+
+    /**
+     * @brief Store the cached count in a sketch's header
+     * @param value Bytes of the stored value
+     * @param count Count, or CACHE_STALE to invalidate
+     */
+    inline void set_cache(unsigned char *value, uint64_t count)
+    {
+        for (int i = 0; i < 8; i++)
+            value[8 + i] = static_cast<unsigned char>(count >> (8 * i));
+    }
+
+    /**
+     * @brief Add an element to a dense sketch in place
+     * @param value Bytes of the stored dense value
+     * @param element Element to add
+     * @return true If a register grew (the cached count is then invalidated)
+     */
+    inline bool add_dense(unsigned char *value, std::string_view element)
+    {
+        size_t index;
+        uint8_t rank = position(element, index);
+        unsigned char *regs = value + HEADER;
+        if (get_register(regs, index) >= rank)
+            return false;
+        set_register(regs, index, rank);
+        value[15] |= 0x80; // CACHE_STALE
+        return true;
+    }
+
+    /**
+     * @brief Add an element to unpacked registers
+     * @param registers One byte per register
+     * @param element Element to add
+     * @return true If a register grew
+     */
+    inline bool add(uint8_t *registers, std::string_view element)
+    {
+        size_t index;
+        uint8_t rank = position(element, index);
+        if (registers[index] >= rank)
+            return false;
+        registers[index] = rank;
+        return true;
+    }
+
+    /**
+     * @brief Raise registers to the maximum of themselves and another set
+     * @param into Unpacked registers, updated
+     * @param from Unpacked registers merged in
+     */
+    inline void merge(uint8_t *into, const uint8_t *from)
+    {
+        size_t i = 0;
+#if defined(__SSE2__)
+        for (; i < REGISTERS; i += 16)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(into + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(into + i), _mm_max_epu8(a, b));
+        }
+#endif
+        for (; i < REGISTERS; i++)
+            if (from[i] > into[i])
+                into[i] = from[i];
+    }
+
+    /**
+     * @brief Unpack the registers of a valid sketch
+     * @param value Stored value
+     * @param[out] registers One byte per register (REGISTERS bytes)
+     */
+    inline void decode(std::string_view value, uint8_t *registers)
+    {
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(value.data()) + HEADER;
+        if (is_dense(value))
+        {
+            // Four 6-bit registers per three bytes; a stored value may come
+            // from SET or RESTORE, so registers above MAX_RANK are clamped
+            // (estimate() indexes its histogram with them)
+            auto clamp = [](unsigned v) { return static_cast<uint8_t>(v > MAX_RANK ? MAX_RANK : v); };
+            for (size_t i = 0; i < REGISTERS; i += 4, p += 3)
+            {
+                registers[i] = clamp(p[0] & 0x3fu);
+                registers[i + 1] = clamp(((p[0] >> 6) | (p[1] << 2)) & 0x3fu);
+                registers[i + 2] = clamp(((p[1] >> 4) | (p[2] << 4)) & 0x3fu);
+                registers[i + 3] = clamp(p[2] >> 2);
+            }
+            return;
+        }
+        const unsigned char *end = reinterpret_cast<const unsigned char *>(value.data()) + value.size();
+        size_t i = 0;
+        while (p < end)
+        {
+            unsigned char op = *p++;
+            if (op & 0x80)
+            {
+                size_t run = (op & 3u) + 1;
+                std::memset(registers + i, ((op >> 2) & 0x1f) + 1, run);
+                i += run;
+            }
+            else
+            {
+                size_t run = (op & 0x40) ? (((op & 0x3fu) << 8) | *p++) + 1 : (op & 0x3fu) + 1;
+                std::memset(registers + i, 0, run);
+                i += run;
+            }
+        }
+    }
+
+    /**
+     * @brief Merge the registers of a valid sketch into unpacked registers
+     * @param value Stored value
+     * @param registers Unpacked registers, raised to the sketch's
+     */
+    inline void merge_value(std::string_view value, uint8_t *registers)
+    {
+        uint8_t other[REGISTERS];
+        decode(value, other);
+        merge(registers, other);
+    }
+
+    /**
+     * @brief Encode registers as a sketch with a stale count
+     * @param registers One byte per register
+     * @return std::string Sparse if it fits in SPARSE_MAX_BYTES, otherwise dense
+     */
+    inline std::string encode(const uint8_t *registers)
+    {
+        std::string out("BHLL\x01\0\0\0\0\0\0\0\0\0\0\x80", HEADER);
+        bool sparse = true;
+        for (size_t i = 0; i < REGISTERS && sparse;)
+        {
+            size_t run = 1;
+            while (i + run < REGISTERS && registers[i + run] == registers[i])
+                run++;
+            if (registers[i] == 0)
+            {
+                for (size_t left = run; left > 0;)
+                {
+                    size_t n = left > 64 ? std::min<size_t>(left, 16384) : left;
+                    if (n > 64)
+                    {
+                        out.push_back(static_cast<char>(0x40 | ((n - 1) >> 8)));
+                        out.push_back(static_cast<char>((n - 1) & 0xff));
+                    }
+                    else
+                    {
+                        out.push_back(static_cast<char>(n - 1));
+                    }
+                    left -= n;
+                }
+            }
+            else if (registers[i] > 32)
+            {
+                sparse = false;
+            }
+            else
+            {
+                for (size_t left = run; left > 0;)
+                {
+                    size_t n = left > 4 ? 4 : left;
+                    out.push_back(static_cast<char>(0x80 | ((registers[i] - 1) << 2) | (n - 1)));
+                    left -= n;
+                }
+            }
+            sparse = sparse && out.size() <= HEADER + SPARSE_MAX_BYTES;
+            i += run;
+        }
+        if (sparse)
+            return out;
+
+        out.resize(HEADER + DENSE_BYTES);
+        out[4] = static_cast<char>(DENSE);
+        unsigned char *p = reinterpret_cast<unsigned char *>(&out[HEADER]);
+        for (size_t i = 0; i < REGISTERS; i += 4, p += 3)
+        {
+            p[0] = static_cast<unsigned char>(registers[i] | (registers[i + 1] << 6));
+            p[1] = static_cast<unsigned char>((registers[i + 1] >> 2) | (registers[i + 2] << 4));
+            p[2] = static_cast<unsigned char>((registers[i + 2] >> 4) | (registers[i + 3] << 2));
+        }
+        return out;
+    }
+
+    /**
+     * @brief Estimate the number of distinct elements
+     * @param registers One byte per register
+     * @return uint64_t Estimated cardinality
+     *
+     * @details Ertl, "New cardinality estimation algorithms for HyperLogLog
+     *          sketches" (2017): corrects for empty and saturated registers
+     *          through the sigma and tau series, so no empirical bias tables
+     *          or linear-counting switch are needed.
+     */
+    inline uint64_t estimate(const uint8_t *registers)
+    {
+        size_t histogram[MAX_RANK + 1] = {};
+        for (size_t i = 0; i < REGISTERS; i++)
+            histogram[registers[i]]++;
+
+        const double m = static_cast<double>(REGISTERS);
+        auto sigma = [](double x)
+        {
+            if (x == 1.0)
+                return HUGE_VAL;
+            double y = 1, z = x, previous;
+            do
+            {
+                x *= x;
+                previous = z;
+                z += x * y;
+                y += y;
+            } while (previous != z);
+            return z;
+        };
+        auto tau = [](double x)
+        {
+            if (x == 0.0 || x == 1.0)
+                return 0.0;
+            double y = 1, z = 1 - x, previous;
+            do
+            {
+                x = std::sqrt(x);
+                previous = z;
+                y *= 0.5;
+                z -= std::pow(1 - x, 2) * y;
+            } while (previous != z);
+            return z / 3;
+        };
+
+        double z = m * tau((m - histogram[MAX_RANK]) / m);
+        for (int k = MAX_RANK - 1; k >= 1; k--)
+        {
+            z += histogram[k];
+            z *= 0.5;
+        }
+        z += m * sigma(histogram[0] / m);
+        return static_cast<uint64_t>(std::llround(0.5 / std::log(2.0) * m * m / z));
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * @file LazyFree.h
+ * @brief Background reclamation of detached values for BLINK DB
+ */
+
+ #pragma once
+ #include <atomic>
+ #include <condition_variable>
+ #include <cstddef>
+ #include <deque>
+ #include <memory>
+ #include <mutex>
+ #include <thread>
+ #include <utility>
+ 
+ /**
+  * @class LazyFree
+  * @brief Destroys objects on a background thread instead of the caller's
+  *
+  * @details Callers move ownership of an object in with free_later(), which is
+  * O(1) (one heap node and a queue push), and return immediately. A dedicated
+  * thread destroys queued objects in batches. Pending bytes stay visible
+  * through pending_bytes() until the destructor has actually run, so memory
+  * accounting never under-reports what the process still holds.
+  */
+ class LazyFree {
+ private:
+     /**
+      * @struct Item
+      * @brief Type-erased owner of one queued object
+      */
+     struct Item {
+         size_t bytes = 0; ///< Bytes released when the object is destroyed
+         virtual ~Item() = default;
+     };
+ 
+     /**
+      * @struct Holder
+      * @brief Item holding an object of a concrete type
+      */
+     template <typename T>
+     struct Holder : Item {
+         T object; ///< Object to destroy
+         explicit Holder(T&& obj) : object(std::move(obj)) {}
+     };
+ 
+     std::deque<std::unique_ptr<Item>> queue; ///< Objects waiting to be destroyed
+     std::mutex mtx; ///< Protects queue and stopping
+     std::condition_variable work_cv; ///< Signals the worker that work or stop is pending
+     std::atomic<size_t> pending{0}; ///< Bytes queued or being destroyed
+     std::atomic<size_t> pending_count{0}; ///< Objects queued or being destroyed
+     std::atomic<size_t> freed_count{0}; ///< Objects destroyed so far
+     bool stopping = false; ///< Set by the destructor
+     std::thread worker; ///< Reclamation thread
+ 
+     /**
+      * @brief Worker loop: take the whole queue and destroy it outside the lock
+      */
+     void run() {
+         std::unique_lock<std::mutex> lock(mtx);
+         while (true) {
+             work_cv.wait(lock, [this] { return stopping || !queue.empty(); });
+             if (queue.empty()) break;
+ 
+             std::deque<std::unique_ptr<Item>> batch;
+             batch.swap(queue);
+             lock.unlock();
+             for (auto& item : batch) {
+                 size_t bytes = item->bytes;
+                 item.reset();
+                 pending -= bytes;
+                 pending_count--;
+                 freed_count++;
+             }
+             batch.clear();
+             lock.lock();
+         }
+     }
+ 
+ public:
+     /**
+      * @brief Start the reclamation thread
+      */
+     LazyFree() : worker([this] { run(); }) {}
+ 
+     /**
+      * @brief Destroy everything still queued, then stop the thread
+      */
+     ~LazyFree() {
+         {
+             std::lock_guard<std::mutex> lock(mtx);
+             stopping = true;
+         }
+         work_cv.notify_one();
+         if (worker.joinable()) worker.join();
+     }
+ 
+     /**
+      * @brief Hand an object to the background thread
+      * @param object Object to destroy (moved from)
+      * @param bytes Bytes its destruction releases, for accounting
+      *
+      * @details O(1); the caller never runs the object's destructor
+      */
+     template <typename T>
+     void free_later(T&& object, size_t bytes) {
+         auto item = std::make_unique<Holder<std::decay_t<T>>>(std::forward<T>(object));
+         item->bytes = bytes;
+         pending += bytes;
+         pending_count++;
+         {
+             std::lock_guard<std::mutex> lock(mtx);
+             queue.push_back(std::move(item));
+         }
+         work_cv.notify_one();
+     }
+ 
+     /**
+      * @brief Bytes handed over but not yet released
+      * @return size_t Pending bytes
+      */
+     size_t pending_bytes() const { return pending; }
+ 
+     /**
+      * @brief Objects handed over but not yet destroyed
+      * @return size_t Pending objects
+      */
+     size_t pending_objects() const { return pending_count; }
+ 
+     /**
+      * @brief Objects destroyed by the background thread so far
+      * @return size_t Freed objects
+      */
+     size_t freed_objects() const { return freed_count; }
+ 
+     // Disable copy operations
+     LazyFree(const LazyFree&) = delete;
+     LazyFree& operator=(const LazyFree&) = delete;
+ };
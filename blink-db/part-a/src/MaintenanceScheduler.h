@@ -0,0 +1,208 @@
+/**
+ * @file MaintenanceScheduler.h
+ * @brief Time-budgeted cooperative scheduler for background maintenance
+ */
+
+ #pragma once
+ #include <algorithm>
+ #include <atomic>
+ #include <chrono>
+ #include <condition_variable>
+ #include <functional>
+ #include <mutex>
+ #include <string>
+ #include <thread>
+ #include <vector>
+ 
+ /**
+  * @class MaintenanceScheduler
+  * @brief Runs background tasks on one thread within per-run time budgets
+  *
+  * @details Each task is a function that does a bounded amount of work before
+  * a deadline and reports whether a backlog remains. The scheduler adapts how
+  * often each task runs: a task with a backlog is rescheduled at half its
+  * current interval (down to its minimum), an idle task at twice its interval
+  * (up to its maximum). Before starting a task the scheduler consults a
+  * pressure probe; while foreground work is waiting, tasks are deferred to
+  * the next tick instead of competing with it (except tiny tasks registered
+  * as non-deferrable, such as a clock ticker). Tasks are expected to check
+  * the same probe between slices of work.
+  */
+ class MaintenanceScheduler {
+ public:
+     using Clock = std::chrono::steady_clock; ///< Clock used for budgets and deadlines
+ 
+     /**
+      * @brief Task body
+      * @details Called with the deadline of this run; returns true if work is
+      * left over (a backlog), false if the task is caught up
+      */
+     using TaskFn = std::function<bool(Clock::time_point deadline)>;
+ 
+     /**
+      * @struct TaskOptions
+      * @brief Budget and frequency limits of one task
+      */
+     struct TaskOptions {
+         std::chrono::microseconds budget{1000}; ///< Maximum run time per invocation
+         std::chrono::milliseconds min_interval{10}; ///< Shortest gap between runs (backlog)
+         std::chrono::milliseconds max_interval{1000}; ///< Longest gap between runs (idle)
+         bool deferrable = true; ///< Postponed while the pressure probe reports foreground work
+     };
+ 
+     /**
+      * @struct TaskStats
+      * @brief Counters reported for one task
+      */
+     struct TaskStats {
+         std::string name; ///< Task name
+         size_t runs = 0; ///< Completed invocations
+         size_t deferrals = 0; ///< Invocations postponed because of foreground pressure
+         std::chrono::microseconds busy{0}; ///< Total time spent running
+         std::chrono::milliseconds interval{0}; ///< Current interval between runs
+     };
+ 
+ private:
+     /**
+      * @struct Task
+      * @brief Registered task with its scheduling state
+      */
+     struct Task {
+         TaskFn fn; ///< Task body
+         TaskOptions options; ///< Budget and limits
+         std::chrono::milliseconds interval; ///< Current adaptive interval
+         Clock::time_point next_due; ///< When the task runs next
+         TaskStats stats; ///< Reported counters
+     };
+ 
+     std::vector<Task> tasks; ///< Registered tasks (fixed once started)
+     std::function<bool()> pressure; ///< Returns true while foreground work is waiting
+     mutable std::mutex mtx; ///< Protects task stats and the stop flag
+     std::condition_variable wake; ///< Interrupts the sleep on stop() and trigger()
+     bool stopping = false; ///< Set by stop()
+     std::thread worker; ///< Scheduler thread
+ 
+     static constexpr std::chrono::milliseconds TICK{10}; ///< Sleep granularity and deferral delay
+ 
+     /**
+      * @brief Scheduler loop: run every due task, then sleep until the next one
+      */
+     void run() {
+         std::unique_lock<std::mutex> lock(mtx);
+         while (!stopping) {
+             auto now = Clock::now();
+ 
+             for (Task& task : tasks) {
+                 if (stopping) break;
+                 if (task.next_due > now) continue;
+ 
+                 if (task.options.deferrable && pressure && pressure()) {
+                     task.stats.deferrals++;
+                     task.next_due = now + TICK;
+                     continue;
+                 }
+ 
+                 lock.unlock();
+                 auto start = Clock::now();
+                 bool backlog = task.fn(start + task.options.budget);
+                 auto end = Clock::now();
+                 lock.lock();
+ 
+                 task.stats.runs++;
+                 task.stats.busy += std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+                 task.interval = backlog ? std::max(task.options.min_interval, task.interval / 2)
+                                         : std::min(task.options.max_interval, task.interval * 2);
+                 task.stats.interval = task.interval;
+                 task.next_due = end + task.interval;
+                 now = end;
+             }
+ 
+             // Recomputed under the lock, so a trigger() during a task run is not missed
+             auto next_wake = Clock::now() + std::chrono::milliseconds(1000);
+             for (const Task& task : tasks) next_wake = std::min(next_wake, task.next_due);
+             if (!stopping) wake.wait_until(lock, next_wake);
+         }
+     }
+ 
+ public:
+     MaintenanceScheduler() = default;
+ 
+     /**
+      * @brief Stop the scheduler thread if it is still running
+      */
+     ~MaintenanceScheduler() { stop(); }
+ 
+     /**
+      * @brief Register a task
+      * @param name Name used in statistics
+      * @param options Budget and interval limits
+      * @param fn Task body
+      * @return size_t Task id for trigger()
+      * @note Must be called before start()
+      */
+     size_t add_task(const std::string& name, const TaskOptions& options, TaskFn fn) {
+         Task task{std::move(fn), options, options.max_interval, Clock::now() + options.max_interval, {}};
+         task.stats.name = name;
+         task.stats.interval = task.interval;
+         tasks.push_back(std::move(task));
+         return tasks.size() - 1;
+     }
+ 
+     /**
+      * @brief Run a task as soon as possible
+      * @param id Id returned by add_task()
+      *
+      * @details Makes the task due now and resets it to its minimum interval,
+      * as if it had reported a backlog. Cheap enough to call from a write path;
+      * the task body runs on the scheduler thread, never on the caller's.
+      */
+     void trigger(size_t id) {
+         {
+             std::lock_guard<std::mutex> lock(mtx);
+             Task& task = tasks[id];
+             task.interval = task.options.min_interval;
+             task.stats.interval = task.interval;
+             task.next_due = Clock::now();
+         }
+         wake.notify_one();
+     }
+ 
+     /**
+      * @brief Install the foreground pressure probe
+      * @param probe Returns true while tasks should stay out of the way
+      * @note Must be called before start()
+      */
+     void set_pressure_probe(std::function<bool()> probe) { pressure = std::move(probe); }
+ 
+     /**
+      * @brief Start the scheduler thread
+      */
+     void start() { worker = std::thread([this] { run(); }); }
+ 
+     /**
+      * @brief Stop the scheduler thread, waiting for a running task to return
+      */
+     void stop() {
+         {
+             std::lock_guard<std::mutex> lock(mtx);
+             stopping = true;
+         }
+         wake.notify_all();
+         if (worker.joinable()) worker.join();
+     }
+ 
+     /**
+      * @brief Snapshot the counters of every task
+      * @return std::vector<TaskStats> One entry per task, in registration order
+      */
+     std::vector<TaskStats> task_stats() const {
+         std::lock_guard<std::mutex> lock(mtx);
+         std::vector<TaskStats> out;
+         for (const Task& task : tasks) out.push_back(task.stats);
+         return out;
+     }
+ 
+     // Disable copy operations
+     MaintenanceScheduler(const MaintenanceScheduler&) = delete;
+     MaintenanceScheduler& operator=(const MaintenanceScheduler&) = delete;
+ };
@@ -1,61 +1,384 @@
 /**
  * @file MemoryManager.h
- * @brief LRU eviction policy manager for BLINK DB storage engine
+ * @brief Eviction policy manager for BLINK DB storage engine
  */
 
  #pragma once
  #include <list>
+ #include <map>
  #include <string>
+ #include <string_view>
+ #include <unordered_map>
+ #include <vector>
+ #include <chrono>
+ #include <cstdint>
+ #include <random>
+ 
+ /**
+  * @enum EvictionPolicy
+  * @brief How victims are chosen when memory exceeds the configured maximum
+  */
+ enum class EvictionPolicy {
+     NOEVICTION,     ///< Never evict; writes that do not fit are rejected
+     ALLKEYS_LRU,    ///< Least recently used key
+     VOLATILE_LRU,   ///< Least recently used key among keys with a TTL
+     VOLATILE_TTL,   ///< Key with a TTL that expires soonest
+     ALLKEYS_RANDOM, ///< Uniformly random key
+     ALLKEYS_LFU     ///< Least frequently used key
+ };
  
  /**
   * @class MemoryManager
-  * @brief Manages Least Recently Used (LRU) eviction policy
-  * 
-  * @details Tracks key access patterns using a queue structure. Integrates with
-  *          StorageEngine to enforce memory limits as per project requirements.
+  * @brief Tracks keys for the configured eviction policy and selects victims
+  *
+  * @details Each policy keeps its own victim-selection structure, and only the
+  *          structure of the active policy is maintained:
+  *          - LRU policies: recency list plus key -> node map, O(1)
+  *          - volatile-ttl: expiry-ordered multimap, O(log n)
+  *          - allkeys-random: dense key vector with swap-remove, O(1)
+  *          - allkeys-lfu: frequency -> recency-list buckets, O(log f) for f
+  *            distinct frequencies. Counts decay by one per lfu_decay of
+  *            idleness and new keys start at LFU_INIT, so keys that were
+  *            popular once eventually make way, and a key just written is
+  *            not the first victim
+  *          - noeviction: nothing is tracked
+  *          Index maps are keyed by string_view into the owning list or map
+  *          node, so each key is stored once per structure. Integrates with
+  *          StorageEngine to enforce memory limits.
   */
  class MemoryManager {
+ public:
+     using TimePoint = std::chrono::system_clock::time_point; ///< Expiry timestamp type
+     static constexpr uint64_t LFU_INIT = 5; ///< Access count of a new key under allkeys-lfu
+ 
  private:
-     std::list<std::string> lru_queue; ///< LRU tracking queue (front=MRU, back=LRU)
+     EvictionPolicy policy; ///< Active policy
+ 
+     // LRU (allkeys-lru, volatile-lru)
+     std::list<std::string> lru_queue; ///< Recency list (front=MRU, back=LRU)
+     std::unordered_map<std::string_view, std::list<std::string>::iterator> lru_index; ///< Key -> node
+ 
+     // volatile-ttl
+     std::multimap<TimePoint, std::string> ttl_queue; ///< Keys ordered by expiry
+     std::unordered_map<std::string_view, std::multimap<TimePoint, std::string>::iterator> ttl_index; ///< Key -> node
+ 
+     // allkeys-random
+     std::unordered_map<std::string, size_t> random_index; ///< Key -> slot in random_keys
+     std::vector<const std::string*> random_keys; ///< Dense array of tracked keys
+     std::mt19937_64 rng{std::random_device{}()}; ///< Victim sampler
+ 
+     // allkeys-lfu
+     /**
+      * @struct LfuSlot
+      * @brief Access score and position of one key
+      *
+      * @details The score is the decayed access count plus the number of decay
+      *          periods elapsed at the last access. A count decays by the
+      *          periods elapsed since, so ordering keys by score orders them
+      *          by their current count without visiting idle keys.
+      */
+     struct LfuSlot {
+         uint64_t score; ///< Access count plus decay period of the last access
+         std::list<std::string>::iterator node; ///< Node in freq_buckets[score]
+     };
+     std::map<uint64_t, std::list<std::string>> freq_buckets; ///< Score -> keys (front=MRU)
+     std::unordered_map<std::string_view, LfuSlot> lfu_index; ///< Key -> slot
+     std::chrono::minutes lfu_decay; ///< Idle time that takes one off a count (0: no decay)
+     std::chrono::steady_clock::time_point lfu_epoch = std::chrono::steady_clock::now(); ///< Start of period 0
+ 
+     /**
+      * @brief Decay periods elapsed since the manager was created
+      */
+     uint64_t lfu_period() const {
+         if (lfu_decay.count() == 0) return 0;
+         return static_cast<uint64_t>((std::chrono::steady_clock::now() - lfu_epoch) / lfu_decay);
+     }
+ 
+     /**
+      * @brief Move a key to the MRU end of the recency list, adding it if new
+      */
+     void lru_touch(const std::string& key) {
+         auto it = lru_index.find(key);
+         if (it != lru_index.end()) {
+             lru_queue.splice(lru_queue.begin(), lru_queue, it->second);
+             return;
+         }
+         lru_queue.push_front(key);
+         lru_index.emplace(lru_queue.front(), lru_queue.begin());
+     }
+ 
+     /**
+      * @brief Set or update the expiry of a key in the TTL queue
+      */
+     void ttl_update(const std::string& key, TimePoint expires_at) {
+         auto it = ttl_index.find(key);
+         if (it != ttl_index.end()) {
+             if (it->second->first == expires_at) return;
+             // Re-key the existing node so its string (and the view on it) stays put
+             auto node = ttl_queue.extract(it->second);
+             node.key() = expires_at;
+             it->second = ttl_queue.insert(std::move(node));
+             return;
+         }
+         auto pos = ttl_queue.emplace(expires_at, key);
+         ttl_index.emplace(pos->second, pos);
+     }
+ 
+     /**
+      * @brief Count one access, moving the key to the bucket of its new score
+      * @param key The accessed key
+      * @param period Current decay period, from lfu_period()
+      *
+      * @details A new key starts at LFU_INIT; an existing key's count first
+      *          loses the periods it sat idle (down to 0), then gains one.
+      */
+     void lfu_touch(const std::string& key, uint64_t period) {
+         auto it = lfu_index.find(key);
+         if (it == lfu_index.end()) {
+             auto& bucket = freq_buckets[period + LFU_INIT];
+             bucket.push_front(key);
+             lfu_index.emplace(bucket.front(), LfuSlot{period + LFU_INIT, bucket.begin()});
+             return;
+         }
+         LfuSlot& slot = it->second;
+         uint64_t count = slot.score > period ? slot.score - period : 0;
+         uint64_t score = period + count + 1;
+         auto from = freq_buckets.find(slot.score);
+         auto& to = freq_buckets[score];
+         // splice keeps the node, so the string_view key remains valid
+         to.splice(to.begin(), from->second, slot.node);
+         if (from->second.empty()) freq_buckets.erase(from);
+         slot.score = score;
+     }
+ 
+     /**
+      * @brief Add a key to the random-eviction array if not already present
+      */
+     void random_add(const std::string& key) {
+         auto [it, inserted] = random_index.emplace(key, random_keys.size());
+         if (inserted) random_keys.push_back(&it->first);
+     }
+ 
+     /**
+      * @brief Remove a key from the random-eviction array by swapping in the last slot
+      */
+     void random_remove(const std::string& key) {
+         auto it = random_index.find(key);
+         if (it == random_index.end()) return;
+         size_t slot = it->second;
+         const std::string* last = random_keys.back();
+         random_keys[slot] = last;
+         random_index[*last] = slot;
+         random_keys.pop_back();
+         random_index.erase(it);
+     }
  
  public:
      /**
-      * @brief Update LRU queue on key access
+      * @brief Construct a manager for one policy
+      * @param policy Eviction policy (default: allkeys-lru)
+      * @param lfu_decay_minutes Idle minutes that take one access off a key's
+      *        allkeys-lfu count (default: 1, 0 disables decay)
+      */
+     explicit MemoryManager(EvictionPolicy policy = EvictionPolicy::ALLKEYS_LRU,
+                            unsigned lfu_decay_minutes = 1)
+         : policy(policy), lfu_decay(lfu_decay_minutes) {}
+ 
+     /**
+      * @brief Get the active policy
+      * @return EvictionPolicy Policy chosen at construction
+      */
+     EvictionPolicy get_policy() const { return policy; }
+ 
+     /**
+      * @brief Record a write of a key
+      * @param key The written key
+      * @param has_ttl Whether the key now has an expiry
+      * @param expires_at Expiry time (ignored when has_ttl is false)
+      *
+      * @details Counts as an access. Volatile policies start tracking keys that
+      *          gained a TTL and drop keys that lost it. Called on SET.
+      */
+     void record_write(const std::string& key, bool has_ttl, TimePoint expires_at) {
+         switch (policy) {
+             case EvictionPolicy::ALLKEYS_LRU: lru_touch(key); break;
+             case EvictionPolicy::VOLATILE_LRU:
+                 if (has_ttl) lru_touch(key); else forget(key);
+                 break;
+             case EvictionPolicy::VOLATILE_TTL:
+                 if (has_ttl) ttl_update(key, expires_at); else forget(key);
+                 break;
+             case EvictionPolicy::ALLKEYS_RANDOM: random_add(key); break;
+             case EvictionPolicy::ALLKEYS_LFU: lfu_touch(key, lfu_period()); break;
+             case EvictionPolicy::NOEVICTION: break;
+         }
+     }
+ 
+     /**
+      * @brief Record a batch of keys just written without a TTL
+      * @param keys Written keys
+      *
+      * @details Bulk counterpart of record_write() used by LOAD: sizes the
+      *          index of the active policy once for the whole batch, and does
+      *          nothing for the volatile policies, which never track keys
+      *          without a TTL.
+      */
+     void record_bulk_write(const std::vector<const std::string*>& keys) {
+         switch (policy) {
+             case EvictionPolicy::ALLKEYS_LRU:
+                 lru_index.reserve(lru_index.size() + keys.size());
+                 for (const std::string* key : keys) lru_touch(*key);
+                 break;
+             case EvictionPolicy::ALLKEYS_RANDOM:
+                 random_index.reserve(random_index.size() + keys.size());
+                 random_keys.reserve(random_keys.size() + keys.size());
+                 for (const std::string* key : keys) random_add(*key);
+                 break;
+             case EvictionPolicy::ALLKEYS_LFU: {
+                 lfu_index.reserve(lfu_index.size() + keys.size());
+                 uint64_t period = lfu_period();
+                 for (const std::string* key : keys) lfu_touch(*key, period);
+                 break;
+             }
+             case EvictionPolicy::VOLATILE_LRU:
+             case EvictionPolicy::VOLATILE_TTL:
+             case EvictionPolicy::NOEVICTION: break;
+         }
+     }
+ 
+     /**
+      * @brief Record a read of an existing key
       * @param key The accessed key
-      * 
-      * @details Moves the key to the front of the LRU queue. Complexity O(n) due
-      *          to list search. Called on GET/SET operations.
+      * @param has_ttl Whether the key has an expiry
+      * @param expires_at Current expiry time (ignored when has_ttl is false)
+      *
+      * @details Updates recency or frequency. Called on GET.
       */
-     void update_lru(const std::string& key) {
-         lru_queue.remove(key);
-         lru_queue.push_front(key);
+     void record_access(const std::string& key, bool has_ttl, TimePoint expires_at) {
+         switch (policy) {
+             case EvictionPolicy::ALLKEYS_LRU: lru_touch(key); break;
+             case EvictionPolicy::VOLATILE_LRU:
+                 if (has_ttl) lru_touch(key);
+                 break;
+             case EvictionPolicy::VOLATILE_TTL:
+                 if (has_ttl) ttl_update(key, expires_at);
+                 break;
+             case EvictionPolicy::ALLKEYS_LFU: lfu_touch(key, lfu_period()); break;
+             case EvictionPolicy::ALLKEYS_RANDOM:
+             case EvictionPolicy::NOEVICTION: break;
+         }
      }
  
      /**
-      * @brief Evict least recently used key
-      * @return std::string Evicted key (empty if queue is empty)
-      * 
-      * @details Removes and returns the LRU key from queue back. Complexity O(1).
-      *          Called when enforcing memory limits.
+      * @brief Stop tracking a key
+      * @param key The removed key
+      *
+      * @details Used when keys are deleted, expired or evicted. O(1) except
+      *          for volatile-ttl and allkeys-lfu, which are O(log n).
       */
-     std::string evict_lru() {
-         if (!lru_queue.empty()) {
-             std::string key = lru_queue.back();
-             lru_queue.pop_back();
-             return key;
+     void forget(const std::string& key) {
+         switch (policy) {
+             case EvictionPolicy::ALLKEYS_LRU:
+             case EvictionPolicy::VOLATILE_LRU: {
+                 auto it = lru_index.find(key);
+                 if (it == lru_index.end()) return;
+                 auto node = it->second;
+                 lru_index.erase(it);
+                 lru_queue.erase(node);
+                 break;
+             }
+             case EvictionPolicy::VOLATILE_TTL: {
+                 auto it = ttl_index.find(key);
+                 if (it == ttl_index.end()) return;
+                 auto node = it->second;
+                 ttl_index.erase(it);
+                 ttl_queue.erase(node);
+                 break;
+             }
+             case EvictionPolicy::ALLKEYS_RANDOM: random_remove(key); break;
+             case EvictionPolicy::ALLKEYS_LFU: {
+                 auto it = lfu_index.find(key);
+                 if (it == lfu_index.end()) return;
+                 LfuSlot slot = it->second;
+                 lfu_index.erase(it);
+                 auto bucket = freq_buckets.find(slot.score);
+                 bucket->second.erase(slot.node);
+                 if (bucket->second.empty()) freq_buckets.erase(bucket);
+                 break;
+             }
+             case EvictionPolicy::NOEVICTION: break;
          }
-         return "";
      }
  
      /**
-      * @brief Remove specific key from LRU tracking
-      * @param key The key to remove
-      * 
-      * @details Used when keys are explicitly deleted. Complexity O(n).
-      *          Maintains queue consistency after manual deletions.
+      * @brief Choose the next key to evict
+      * @param[out] key Receives the victim
+      * @return true If a victim was found
+      * @return false If nothing is evictable (noeviction, or no volatile keys)
+      *
+      * @details The victim stays tracked until the caller removes it with
+      *          forget(). allkeys-lfu picks the lowest decayed count; ties go to
+      *          the key idle longest.
       */
-     void evict_lru(const std::string& key) {
-         lru_queue.remove(key);
+     bool select_victim(std::string& key) {
+         switch (policy) {
+             case EvictionPolicy::ALLKEYS_LRU:
+             case EvictionPolicy::VOLATILE_LRU:
+                 if (lru_queue.empty()) return false;
+                 key = lru_queue.back();
+                 return true;
+             case EvictionPolicy::VOLATILE_TTL:
+                 if (ttl_queue.empty()) return false;
+                 key = ttl_queue.begin()->second;
+                 return true;
+             case EvictionPolicy::ALLKEYS_RANDOM: {
+                 if (random_keys.empty()) return false;
+                 std::uniform_int_distribution<size_t> pick(0, random_keys.size() - 1);
+                 key = *random_keys[pick(rng)];
+                 return true;
+             }
+             case EvictionPolicy::ALLKEYS_LFU:
+                 if (freq_buckets.empty()) return false;
+                 key = freq_buckets.begin()->second.back();
+                 return true;
+             case EvictionPolicy::NOEVICTION:
+                 return false;
+         }
+         return false;
+     }
+ 
+     /**
+      * @brief Parse a policy name as used in configuration ("allkeys-lru", ...)
+      * @param name Policy name
+      * @param[out] out Parsed policy
+      * @return true If the name is known
+      */
+     static bool parse_policy(const std::string& name, EvictionPolicy& out) {
+         for (auto p : {EvictionPolicy::NOEVICTION, EvictionPolicy::ALLKEYS_LRU,
+                        EvictionPolicy::VOLATILE_LRU, EvictionPolicy::VOLATILE_TTL,
+                        EvictionPolicy::ALLKEYS_RANDOM, EvictionPolicy::ALLKEYS_LFU}) {
+             if (name == policy_name(p)) {
+                 out = p;
+                 return true;
+             }
+         }
+         return false;
+     }
+ 
+     /**
+      * @brief Configuration name of a policy
+      * @param p Policy
+      * @return const char* Name such as "allkeys-lru"
+      */
+     static const char* policy_name(EvictionPolicy p) {
+         switch (p) {
+             case EvictionPolicy::NOEVICTION: return "noeviction";
+             case EvictionPolicy::ALLKEYS_LRU: return "allkeys-lru";
+             case EvictionPolicy::VOLATILE_LRU: return "volatile-lru";
+             case EvictionPolicy::VOLATILE_TTL: return "volatile-ttl";
+             case EvictionPolicy::ALLKEYS_RANDOM: return "allkeys-random";
+             case EvictionPolicy::ALLKEYS_LFU: return "allkeys-lfu";
+         }
+         return "unknown";
      }
  };
- 
\ No newline at end of file
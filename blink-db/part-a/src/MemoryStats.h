@@ -0,0 +1,142 @@
+/**
+ * @file MemoryStats.h
+ * @brief Process and allocator memory statistics for BLINK DB
+ */
+
+ #pragma once
+ #include <cstddef>
+ #include <cstdio>
+ #include <cstring>
+ #include <string>
+ #include <unistd.h>
+ #if defined(__GLIBC__)
+ #include <malloc.h>
+ #endif
+ 
+ /**
+  * @namespace MemoryStats
+  * @brief Thin wrappers over /proc and the C allocator
+  *
+  * @details Used by the storage engine to measure fragmentation (resident
+  * memory versus bytes actually handed out by the allocator), to return
+  * freed pages to the operating system after a defragmentation cycle, and to
+  * size the cache to its cgroup v2 memory limits.
+  */
+ namespace MemoryStats {
+ 
+     /**
+      * @brief Resident set size of this process
+      * @return size_t RSS in bytes (0 if unavailable)
+      */
+     inline size_t process_rss_bytes() {
+         FILE* f = std::fopen("/proc/self/statm", "r");
+         if (!f) return 0;
+         unsigned long pages_total = 0, pages_resident = 0;
+         int fields = std::fscanf(f, "%lu %lu", &pages_total, &pages_resident);
+         std::fclose(f);
+         if (fields != 2) return 0;
+         return static_cast<size_t>(pages_resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+     }
+ 
+     /**
+      * @brief Bytes currently allocated through malloc
+      * @return size_t Allocated bytes (0 if the allocator cannot report it)
+      */
+     inline size_t allocator_bytes_in_use() {
+ #if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+         struct mallinfo2 info = mallinfo2();
+         return info.uordblks + info.hblkhd;
+ #else
+         return 0;
+ #endif
+     }
+ 
+     /**
+      * @brief Return free allocator pages to the operating system
+      * @details No-op on allocators without malloc_trim()
+      */
+     inline void release_free_memory() {
+ #if defined(__GLIBC__)
+         malloc_trim(0);
+ #endif
+     }
+ 
+     /**
+      * @brief cgroup v2 directory of this process
+      * @return std::string Path under /sys/fs/cgroup, or empty without a
+      *         unified hierarchy with the memory controller
+      */
+     inline std::string cgroup_dir() {
+         FILE* f = std::fopen("/proc/self/cgroup", "r");
+         if (!f) return std::string();
+         std::string dir;
+         char line[4096];
+         while (std::fgets(line, sizeof(line), f)) {
+             if (std::strncmp(line, "0::", 3) != 0) continue;
+             dir = "/sys/fs/cgroup";
+             dir.append(line + 3, std::strcspn(line + 3, "\n"));
+             break;
+         }
+         std::fclose(f);
+         if (!dir.empty() && dir.back() == '/') dir.pop_back();
+         FILE* probe = dir.empty() ? nullptr : std::fopen((dir + "/memory.current").c_str(), "r");
+         if (!probe) return std::string();
+         std::fclose(probe);
+         return dir;
+     }
+ 
+     /**
+      * @brief Read a single-number cgroup file such as memory.max
+      * @param dir cgroup directory
+      * @param file File name
+      * @param[out] value Number read
+      * @return false If the file is missing or holds "max" (no limit)
+      */
+     inline bool cgroup_value(const std::string& dir, const char* file, size_t& value) {
+         FILE* f = std::fopen((dir + "/" + file).c_str(), "r");
+         if (!f) return false;
+         unsigned long long v = 0;
+         int fields = std::fscanf(f, "%llu", &v);
+         std::fclose(f);
+         if (fields != 1) return false;
+         value = static_cast<size_t>(v);
+         return true;
+     }
+ 
+     /**
+      * @brief Read one counter of a cgroup's memory.stat
+      * @param dir cgroup directory
+      * @param name Counter name, e.g. "inactive_file"
+      * @return size_t Counter value (0 if absent)
+      */
+     inline size_t cgroup_memory_stat(const std::string& dir, const char* name) {
+         FILE* f = std::fopen((dir + "/memory.stat").c_str(), "r");
+         if (!f) return 0;
+         size_t len = std::strlen(name);
+         unsigned long long v = 0;
+         char line[256];
+         while (std::fgets(line, sizeof(line), f)) {
+             if (std::strncmp(line, name, len) == 0 && line[len] == ' ') {
+                 std::sscanf(line + len + 1, "%llu", &v);
+                 break;
+             }
+         }
+         std::fclose(f);
+         return static_cast<size_t>(v);
+     }
+ 
+     /**
+      * @brief Memory pressure stall of a cgroup (PSI)
+      * @param dir cgroup directory
+      * @return double Share of the last 10 seconds, in percent, in which some
+      *         task of the cgroup stalled on memory (-1 if unavailable)
+      */
+     inline double cgroup_memory_pressure(const std::string& dir) {
+         FILE* f = std::fopen((dir + "/memory.pressure").c_str(), "r");
+         if (!f) return -1;
+         double avg10 = -1;
+         if (std::fscanf(f, "some avg10=%lf", &avg10) != 1) avg10 = -1;
+         std::fclose(f);
+         return avg10;
+     }
+ }
@@ -4,28 +4,135 @@
  */
 
  #include "StorageEngine.h"
+ #include "GlobPattern.h"
+ #include "MemoryStats.h"
  #include <algorithm>
+ #include <stdexcept>
  
  /**
   * @brief Construct a new Storage Engine object
   * @param max_memory Maximum allowed memory in bytes
   * 
   * @details Initializes the storage engine with specified memory limit
-  * and starts background eviction daemon thread
+  * and starts the background maintenance scheduler
   */
  StorageEngine::StorageEngine(size_t max_memory) 
-     : max_memory(max_memory) {
-     start_eviction_daemon();
+     : max_memory(max_memory), high_watermark(max_memory * 90 / 100),
+       low_watermark(max_memory * 80 / 100) {
+     start_maintenance();
+ }
+ 
+ /**
+  * @brief Construct a new Storage Engine object from a configuration
+  * @param config Engine options
+  * 
+  * @details Same as the size-only constructor, but additionally selects the
+  * page backing of the hash table, the eviction policy, lazy freeing and
+  * value deduplication,
+  * builds the optional ordered key index and configures active defragmentation
+  */
+ StorageEngine::StorageEngine(const EngineConfig& config)
+     : store(8, config.huge_pages), mem_manager(config.eviction_policy, config.lfu_decay_minutes),
+       lazy_evict(config.lazy_free), lazyfree_min_bytes(config.lazyfree_min_bytes),
+       max_memory(config.max_memory) {
+     current_memory.share(config.shared_memory);
+     dedup_min_bytes = config.dedup ? std::max<size_t>(config.dedup_min_bytes, 16) : 0;
+     evict_high_pct = std::min(config.evict_high_pct, 100u);
+     evict_low_pct = std::min(config.evict_low_pct, evict_high_pct);
+     apply_memory_limit(max_memory, evict_low_pct);
+     if (config.ordered_index) {
+         ordered_index = std::make_unique<ArtIndex>();
+     }
+     defrag.enabled = config.active_defrag;
+     defrag.threshold_pct = config.defrag_threshold_pct;
+     defrag.ignore_bytes = config.defrag_ignore_bytes;
+     defrag.cpu_pct = std::min(config.defrag_cpu_pct, 100u);
+     maintenance_budget = std::chrono::microseconds(config.maintenance_budget_us);
+     lease_timeout = std::max(config.lease_timeout_s, 1u);
+     lease_grace = config.lease_grace_s;
+     if (config.cgroup_memory) {
+         cgroup.dir = config.cgroup_dir.empty() ? MemoryStats::cgroup_dir() : config.cgroup_dir;
+         cgroup.enabled = !cgroup.dir.empty();
+         cgroup.pct = std::min(std::max(config.cgroup_memory_pct, 1u), 100u);
+         cgroup.ceiling = max_memory;
+     }
+     if (SharedMemory* budget = current_memory.budget()) {
+         std::lock_guard<std::mutex> registry(budget->mtx);
+         budget->engines.push_back(this);
+     }
+     start_maintenance();
  }
  
  /**
   * @brief Destroy the Storage Engine object
   * 
-  * @details Stops eviction thread and cleans up resources
+  * @details Leaves the shared budget first, so no other engine evicts from
+  * this one any more, then stops the maintenance scheduler before any state
+  * its tasks touch is destroyed
   */
  StorageEngine::~StorageEngine() {
-     running = false;
-     if (eviction_thread.joinable()) eviction_thread.join();
+     if (SharedMemory* budget = current_memory.budget()) {
+         std::lock_guard<std::mutex> registry(budget->mtx);
+         budget->engines.erase(std::find(budget->engines.begin(), budget->engines.end(), this));
+     }
+     maintenance.stop();
+ }
+ 
+ /**
+  * @brief Register the background tasks and start the scheduler
+  * 
+  * @details Tasks and their limits:
+  * - clock: advances the coarse clock every CLOCK_TICK, never deferred
+  * - stats: samples RSS and allocator usage once per second
+  * - expire: incremental TTL sweep, every 10ms-1s depending on how much expires
+  * - evict: evicts from the high watermark down to the low one, every
+  *   10ms-1s, and immediately when a SET crosses the high watermark
+  * - rehash: finishes incremental hash table resizes, every 10ms-1s
+  * - defrag (only when enabled): every 100ms with defrag_cpu_pct of that interval
+  * 
+  * Expire, evict and rehash may each run for maintenance_budget per
+  * invocation.
+  */
+ void StorageEngine::start_maintenance() {
+     using Options = MaintenanceScheduler::TaskOptions;
+     using std::chrono::milliseconds;
+     using TimePoint = MaintenanceScheduler::Clock::time_point;
+ 
+     sample_memory();
+     maintenance.set_pressure_probe([this] { return under_pressure(); });
+     maintenance.add_task("clock", Options{maintenance_budget, CLOCK_TICK, CLOCK_TICK, false},
+                          [this](TimePoint) { return tick_clock(); });
+     maintenance.add_task("stats", Options{maintenance_budget, milliseconds(1000), milliseconds(1000)},
+                          [this](TimePoint) { return sample_memory(); });
+     maintenance.add_task("expire", Options{maintenance_budget, milliseconds(10), milliseconds(1000)},
+                          [this](TimePoint deadline) { return expire_step(deadline); });
+     evict_task = maintenance.add_task("evict", Options{maintenance_budget, milliseconds(10), milliseconds(1000)},
+                          [this](TimePoint deadline) { return evict_step(deadline); });
+     maintenance.add_task("rehash", Options{maintenance_budget, milliseconds(10), milliseconds(1000)},
+                          [this](TimePoint deadline) { return rehash_step(deadline); });
+     if (defrag.enabled) {
+         auto budget = std::chrono::duration_cast<std::chrono::microseconds>(DEFRAG_INTERVAL) *
+                       defrag.cpu_pct / 100;
+         maintenance.add_task("defrag", Options{budget, DEFRAG_INTERVAL, DEFRAG_INTERVAL},
+                              [this](TimePoint deadline) { return defrag_step(deadline); });
+     }
+     if (cgroup.enabled) {
+         cgroup_step();
+         maintenance.add_task("cgroup", Options{maintenance_budget, CGROUP_INTERVAL, CGROUP_INTERVAL},
+                              [this](TimePoint) { return cgroup_step(); });
+     }
+     maintenance.start();
+ }
+ 
+ /**
+  * @brief Check whether background tasks should yield to client requests
+  * @return true If a request is blocked on mtx or was within PRESSURE_WINDOW
+  */
+ bool StorageEngine::under_pressure() const {
+     if (foreground_waiters > 0) return true;
+     auto now = MaintenanceScheduler::Clock::now().time_since_epoch().count();
+     return now - last_contention_ns <
+            std::chrono::duration_cast<std::chrono::nanoseconds>(PRESSURE_WINDOW).count();
  }
  
  /**
@@ -33,33 +140,150 @@
   * @param key Key to store/update
   * @param value Value to associate with key
   * @param ttl Time-to-live in seconds (default: no expiration)
+  * @param tags Tags replacing the key's current ones (empty: keep them)
+  * @return false If the write was rejected for lack of memory
+  * 
+  * @details Implements SET operation with thread safety; memory limits,
+  * versioning and bookkeeping are handled by write_entry()
+  * 
+  * @note Locks mutex during operation
+  */
+ bool StorageEngine::set(const std::string& key, const std::string& value,
+                        std::chrono::seconds ttl, const std::vector<std::string>& tags) {
+     ForegroundLock lock(*this);
+     const CompactString lookup = CompactString::borrow(key);
+     if (write_entry(key, lookup, store.find(lookup), value, ttl, false,
+                     TagIndex::assign_bytes(key, tags)) == 0) {
+         return false;
+     }
+     if (!tags.empty()) retag(key, &tags);
+     return true;
+ }
+ 
+ /**
+  * @brief Read a key, or take the lease to fill it on a miss
+  * @param key Key to read
+  * @param[out] value Value, or stale value
+  * @param[out] token Lease token when GRANTED
+  * @param[out] stale Whether value is a stale value
+  * @return LeaseStatus HIT, GRANTED or WAIT
   * 
-  * @details Implements SET operation with thread safety and memory management:
-  * - Updates existing entries' memory usage
-  * - Applies LRU tracking
-  * - Enforces memory limits
+  * @details Implements GETL. A hit counts as an access, like GET. On a miss
+  * at most one caller per lease_timeout gets a token (a new version number,
+  * so tokens never repeat), which spares the origin a stampede of identical
+  * reloads when a hot key expires.
   * 
   * @note Locks mutex during operation
   */
- void StorageEngine::set(const std::string& key, const std::string& value,
-                        std::chrono::seconds ttl) {
-     std::lock_guard<std::mutex> lock(mtx);
+ LeaseStatus StorageEngine::get_or_lease(const std::string& key, std::string& value, uint64_t& token,
+                                         bool& stale) {
+     ForegroundLock lock(*this);
+     const uint32_t now = coarse_now();
+     stale = false;
+     token = 0;
  
-     Entry new_entry{
-         .value = value,
-         .ttl = ttl,
-         .last_accessed = std::chrono::system_clock::now()
-     };
+     Entry* entry = store.find(CompactString::borrow(key));
+     if (entry && !is_expired(*entry, now)) {
+         MemoryManager::TimePoint expires_at{};
+         bool has_ttl = entry_expiry(*entry, expires_at);
+         mem_manager.record_access(key, has_ttl, expires_at);
+         value = entry->value.str();
+         return LeaseStatus::HIT;
+     }
+     if (entry) expire_entry(key);
+     std::string_view frozen_value;
+     if (!entry && frozen.find(key, frozen_value)) {
+         value.assign(frozen_value);
+         return LeaseStatus::HIT;
+     }
+ 
+     value.clear();
+     auto kept = stale_values.find(key);
+     if (kept != stale_values.end() && now <= kept->second.until) {
+         value = kept->second.value.str();
+         stale = true;
+     }
+     auto lease = leases.find(key);
+     if (lease != leases.end() && now <= lease->second.expires_at) {
+         lease_waits++;
+         return LeaseStatus::WAIT;
+     }
+     token = ++version_clock;
+     if (lease == leases.end()) {
+         lease = leases.emplace(key, Lease{}).first;
+         current_memory += lease_bytes(key);
+     }
+     lease->second = Lease{token, now + lease_timeout};
+     lease_order.emplace_back(lease->second.expires_at, key);
+     lease_grants++;
+     return LeaseStatus::GRANTED;
+ }
+ 
+ /**
+  * @brief Store a value only if the caller holds the key's lease
+  * @param key Key to write
+  * @param value Value to store
+  * @param token Token from get_or_lease()
+  * @param ttl Time-to-live in seconds
+  * @param tags Tags replacing the key's current ones (empty: keep them)
+  * @return CasStatus OK, MISMATCH or OOM
+  * 
+  * @details Any write or delete of the key ends its lease (see end_lease),
+  * so a holder that loaded its value before an invalidation cannot store
+  * it afterwards.
+  * 
+  * @note Locks mutex during operation
+  */
+ CasStatus StorageEngine::set_with_lease(const std::string& key, const std::string& value, uint64_t token,
+                                         std::chrono::seconds ttl, const std::vector<std::string>& tags) {
+     ForegroundLock lock(*this);
+     auto lease = leases.find(key);
+     if (lease == leases.end() || lease->second.token != token || coarse_now() > lease->second.expires_at) {
+         lease_rejected++;
+         return CasStatus::MISMATCH;
+     }
+ 
+     const CompactString lookup = CompactString::borrow(key);
+     if (write_entry(key, lookup, store.find(lookup), value, ttl, false,
+                     TagIndex::assign_bytes(key, tags)) == 0) {
+         return CasStatus::OOM;
+     }
+     if (!tags.empty()) retag(key, &tags);
+     return CasStatus::OK;
+ }
  
-     Entry old_entry;
-     if (store.get(key, old_entry)) {
-         current_memory -= key.size() + old_entry.value.size();
+ /**
+  * @brief Store a value only if the stored version matches
+  * @param key Key to write
+  * @param value Value to store
+  * @param expected Expected version (0 = key must be absent)
+  * @param[out] version New version
+  * @param ttl Time-to-live in seconds
+  * @param tags Tags replacing the key's current ones (empty: keep them)
+  * @return CasStatus OK, MISMATCH or OOM
+  * 
+  * @details Implements SET ... IFVERSION. The lookup that checks the version
+  * is the one the write reuses, so a matching update of an existing key costs
+  * a single hash probe.
+  * 
+  * @note Locks mutex during operation
+  */
+ CasStatus StorageEngine::set_if_version(const std::string& key, const std::string& value,
+                                         uint64_t expected, uint64_t& version,
+                                         std::chrono::seconds ttl, const std::vector<std::string>& tags) {
+     ForegroundLock lock(*this);
+     const CompactString lookup = CompactString::borrow(key);
+     Entry* entry = find_for_write(key, lookup);
+     if (entry && is_expired(*entry, coarse_now())) {
+         expire_entry(key);
+         entry = nullptr;
      }
+     if ((entry ? entry->version : 0) != expected) return CasStatus::MISMATCH;
  
-     store.insert(key, new_entry);
-     current_memory += key.size() + value.size();
-     mem_manager.update_lru(key);
-     enforce_memory_limits();
+     version = write_entry(key, lookup, entry, value, ttl, false, TagIndex::assign_bytes(key, tags));
+     if (version == 0) return CasStatus::OOM;
+     if (!tags.empty()) retag(key, &tags);
+     return CasStatus::OK;
  }
  
  /**
@@ -68,108 +292,2059 @@
   * @return std::string Retrieved value or empty string
   * 
   * @details Implements GET operation with:
-  * - Access time updating
-  * - TTL expiration checks
-  * - LRU tracking updates
+  * - TTL expiration checks against the coarse clock
+  * - Eviction policy tracking updates
+  * - Fallback to the frozen tier for keys not in the hash table
   * 
   * @note Locks mutex during operation
   */
  std::string StorageEngine::get(const std::string& key) {
-     std::lock_guard<std::mutex> lock(mtx);
+     ForegroundLock lock(*this);
  
-     Entry entry;
-     if (!store.get(key, entry)) return "";
- 
-     entry.last_accessed = std::chrono::system_clock::now();
-     store.insert(key, entry); // Update access time
+     Entry* entry = store.find(CompactString::borrow(key));
+     if (!entry) {
+         std::string_view value;
+         return frozen.find(key, value) ? std::string(value) : "";
+     }
  
-     if (entry.ttl != std::chrono::seconds::max() && 
-         (std::chrono::system_clock::now() - entry.last_accessed) > entry.ttl) {
-         store.remove(key);
+     if (is_expired(*entry, coarse_now())) {
+         expire_entry(key);
          return "";
      }
  
-     mem_manager.update_lru(key);
-     return entry.value;
+     MemoryManager::TimePoint expires_at{};
+     bool has_ttl = entry_expiry(*entry, expires_at);
+     mem_manager.record_access(key, has_ttl, expires_at);
+     return entry->value.str();
  }
  
  /**
-  * @brief Delete a key-value pair
-  * @param key Key to delete
-  * @return true If key existed and was deleted
-  * @return false If key didn't exist
+  * @brief Retrieve a value together with its version
+  * @param key Key to look up
+  * @param[out] value Stored value
+  * @param[out] version Version of the stored value
+  * @return true If the key exists
   * 
-  * @details Implements DEL operation with:
-  * - Memory usage adjustment
-  * - LRU tracking cleanup
+  * @details Implements GETV. Checks expiry and updates eviction tracking like
+  * GET. All frozen keys report the version assigned by the last FREEZE.
   * 
   * @note Locks mutex during operation
   */
- bool StorageEngine::del(const std::string& key) {
-     std::lock_guard<std::mutex> lock(mtx);
+ bool StorageEngine::get_versioned(const std::string& key, std::string& value, uint64_t& version) {
+     ForegroundLock lock(*this);
  
-     Entry entry;
-     if (!store.get(key, entry)) return false;
+     Entry* entry = store.find(CompactString::borrow(key));
+     if (!entry) {
+         std::string_view frozen_value;
+         if (!frozen.find(key, frozen_value)) return false;
+         value.assign(frozen_value);
+         version = frozen_version;
+         return true;
+     }
  
-     current_memory -= key.size() + entry.value.size();
-     store.remove(key);
-     mem_manager.evict_lru(key);
+     if (is_expired(*entry, coarse_now())) {
+         expire_entry(key);
+         return false;
+     }
+     MemoryManager::TimePoint expires_at{};
+     bool has_ttl = entry_expiry(*entry, expires_at);
+     mem_manager.record_access(key, has_ttl, expires_at);
+     value = entry->value.str();
+     version = entry->version;
      return true;
  }
  
  /**
-  * @brief Enforce memory limits using LRU policy
+  * @brief Atomically add to an integer value
+  * @param key Counter key
+  * @param delta Amount to add
+  * @param[out] result New value
+  * @return IncrStatus OK, NOT_INTEGER, OUT_OF_RANGE or OOM
+  * 
+  * @details Implements INCR/DECR/INCRBY/DECRBY. A missing key counts as 0 and
+  * is created without a TTL; an existing key keeps its TTL. Values that are
+  * not integer-encoded are rejected without being parsed, which is exact
+  * because every canonical integer is stored integer-encoded. If the counter
+  * grows by a digit, room is made for it like for a SET.
+  * 
+  * Hot counters make every caller queue on mtx for a few nanoseconds of
+  * work, so calls are flat-combined: the caller publishes its request in a
+  * CombineSlot, then polls for the lock or for its slot to be completed.
+  * Whoever gets the lock applies all published requests, merging those of
+  * the same key into one lookup and one write, so a burst of N increments
+  * costs one lock handoff instead of N. When the lock is free the caller
+  * skips publishing and applies its increment (and any published ones)
+  * directly; so does a caller inside a Batch or finding every slot taken.
   * 
-  * @details Iteratively removes least recently used entries until:
-  * - Memory usage is below max_memory
-  * - LRU queue is empty
+  * Only multi-threaded embedders of the engine benefit. blink_server runs
+  * every command on its one event-loop thread, so no two increments are
+  * ever in flight together: the lock is free (or held by a background task,
+  * which is simply waited for) and nothing is combined.
   * 
-  * @note Called automatically during SET operations
+  * @note Locks mutex during operation
   */
- void StorageEngine::enforce_memory_limits() {
-     while (current_memory > max_memory) {
-         std::string key = mem_manager.evict_lru();
-         if (key.empty()) break;
+ IncrStatus StorageEngine::incr_by(const std::string& key, int64_t delta, int64_t& result) {
+     IncrRequest direct{&key, delta};
+     IncrRequest* request = &direct;
+     if (batch_owner == std::this_thread::get_id()) {
+         apply_increments(&request, 1);
+         result = direct.result;
+         return direct.status;
+     }
+     {
+         std::unique_lock<std::mutex> lock(mtx, std::try_to_lock);
+         if (lock.owns_lock()) {
+             apply_increments(&request, 1);
+             combine_increments();
+             result = direct.result;
+             return direct.status;
+         }
+     }
  
-         Entry entry;
-         if (store.get(key, entry)) {
-             current_memory -= key.size() + entry.value.size();
-             store.remove(key);
+     CombineSlot* slot = nullptr;
+     size_t start = std::hash<std::thread::id>{}(std::this_thread::get_id());
+     for (size_t i = 0; i < COMBINE_SLOTS && !slot; i++) {
+         CombineSlot& candidate = combine_slots[(start + i) % COMBINE_SLOTS];
+         int expected = SLOT_FREE;
+         if (candidate.state.compare_exchange_strong(expected, SLOT_CLAIMED, std::memory_order_acquire)) {
+             slot = &candidate;
          }
      }
+     if (!slot) {
+         ForegroundLock lock(*this);
+         apply_increments(&request, 1);
+         result = direct.result;
+         return direct.status;
+     }
+ 
+     slot->request = direct;
+     slot->state.store(SLOT_PENDING, std::memory_order_release);
+     combine_pending.fetch_add(1, std::memory_order_release);
+     {
+         std::unique_lock<std::mutex> lock(mtx, std::try_to_lock);
+         for (int spin = 0; !lock.owns_lock() && spin < COMBINE_SPINS; spin++) {
+             if (slot->state.load(std::memory_order_acquire) == SLOT_DONE) break;
+             std::this_thread::yield();
+             lock.try_lock();
+         }
+         if (lock.owns_lock()) {
+             combine_increments();
+         } else if (slot->state.load(std::memory_order_acquire) != SLOT_DONE) {
+             ForegroundLock blocking(*this);
+             combine_increments();
+         }
+     }
+ 
+     result = slot->request.result;
+     IncrStatus status = slot->request.status;
+     slot->state.store(SLOT_FREE, std::memory_order_release);
+     return status;
  }
  
  /**
-  * @brief Evict expired entries based on TTL
+  * @brief Apply every published increment
   * 
-  * @details Background process that:
-  * 1. Scans all entries for expiration
-  * 2. Removes expired entries
-  * 3. Updates LRU tracking
+  * @details Takes the pending slots, sorts them by key so that requests for
+  * the same counter are adjacent, applies each run with one write and marks
+  * the slots done. Requests published after the scan are applied by their
+  * own caller, which keeps waiting for the lock.
   * 
-  * @note Runs in dedicated thread started by constructor
-  * Complexity: O(n) where n = number of entries
+  * @note Caller must hold mtx
   */
- void StorageEngine::evict_expired() {
-     auto now = std::chrono::system_clock::now();
-     std::vector<std::string> keys_to_remove;
+ void StorageEngine::combine_increments() {
+     if (combine_pending.load(std::memory_order_acquire) == 0) return;
+     std::array<CombineSlot*, COMBINE_SLOTS> pending;
+     size_t count = 0;
+     for (auto& slot : combine_slots) {
+         if (slot.state.load(std::memory_order_acquire) == SLOT_PENDING) pending[count++] = &slot;
+     }
+     if (count == 0) return;
+     std::sort(pending.begin(), pending.begin() + count, [](const CombineSlot* a, const CombineSlot* b) {
+         return *a->request.key < *b->request.key;
+     });
  
-     // Scan all buckets in hash table
-     for (size_t i = 0; i < store.get_capacity(); ++i) {
-         auto* current = store.get_table()[i];
-         while (current) {
-             if (current->value.ttl != std::chrono::seconds::max() &&
-                 (now - current->value.last_accessed) > current->value.ttl) {
-                 keys_to_remove.push_back(current->key);
+     std::array<IncrRequest*, COMBINE_SLOTS> group;
+     for (size_t first = 0; first < count;) {
+         size_t size = 0;
+         const std::string& key = *pending[first]->request.key;
+         while (first + size < count && *pending[first + size]->request.key == key) {
+             group[size] = &pending[first + size]->request;
+             size++;
+         }
+         apply_increments(group.data(), size);
+         incr_merged += size - 1;
+         first += size;
+     }
+     incr_batches++;
+     combine_pending.fetch_sub(static_cast<unsigned>(count), std::memory_order_relaxed);
+     for (size_t i = 0; i < count; i++) {
+         pending[i]->state.store(SLOT_DONE, std::memory_order_release);
+     }
+ }
+ 
+ /**
+  * @brief Apply increments of one key with a single write
+  * @param group Requests for the same key
+  * @param count Number of requests
+  * 
+  * @details The counter is read once, each delta is added in order (a delta
+  * that would overflow fails alone), and the final value is stored once. If
+  * it does not fit in memory every request that had succeeded gets OOM. An
+  * expired key counts as missing, so the counter restarts at 0 without TTL.
+  * 
+  * @note Caller must hold mtx
+  */
+ void StorageEngine::apply_increments(IncrRequest* const* group, size_t count) {
+     const std::string& key = *group[0]->key;
+     const CompactString lookup = CompactString::borrow(key);
+     Entry* entry = find_for_write(key, lookup);
+     if (entry && is_expired(*entry, coarse_now())) {
+         expire_entry(key);
+         entry = nullptr;
+     }
+     int64_t current = 0;
+     if (entry) {
+         if (!entry->value.is_integer()) {
+             for (size_t i = 0; i < count; i++) group[i]->status = IncrStatus::NOT_INTEGER;
+             return;
+         }
+         current = entry->value.integer();
+     }
+     bool changed = false;
+     for (size_t i = 0; i < count; i++) {
+         if (__builtin_add_overflow(current, group[i]->delta, &group[i]->result)) {
+             group[i]->status = IncrStatus::OUT_OF_RANGE;
+             continue;
+         }
+         current = group[i]->result;
+         group[i]->status = IncrStatus::OK;
+         changed = true;
+     }
+     if (!changed) return;
+ 
+     CompactString updated = CompactString::from_integer(current);
+     size_t new_size = updated.size();
+     if (!entry || new_size > entry->value.size()) {
+         if (!enforce_memory_limits(key, key.size() + new_size)) {
+             for (size_t i = 0; i < count; i++) {
+                 if (group[i]->status == IncrStatus::OK) group[i]->status = IncrStatus::OOM;
              }
-             current = current->next;
+             return;
+         }
+         entry = store.find(lookup); // Eviction may have picked this key
+     }
+ 
+     if (entry) {
+         current_memory -= entry->value.size();
+         entry->value = std::move(updated);
+         entry->version = ++version_clock;
+         current_memory += new_size;
+ 
+         MemoryManager::TimePoint expires_at{};
+         bool has_ttl = entry_expiry(*entry, expires_at);
+         mem_manager.record_write(key, has_ttl, expires_at);
+     } else {
+         store.insert(lookup, Entry{std::move(updated), ++version_clock, 0});
+         if (ordered_index) ordered_index->insert(key);
+         current_memory += key.size() + new_size;
+         mem_manager.record_write(key, false, {});
+     }
+     touch(key);
+     end_lease(key);
+     wake_evictor();
+ }
+ 
+ /**
+  * @brief Look up a value for a read command that works on its bytes
+  * @param key Key to look up
+  * @param scratch Buffer for values not stored as bytes
+  * @param[out] value View of the value
+  * @return true If the key exists
+  * 
+  * @details Like GET, but hands out a view of a heap or frozen value instead
+  * of a copy, so BITCOUNT and friends scan megabyte values where they lie.
+  * Inline and integer values are materialised into scratch.
+  * 
+  * @note Caller must hold mtx
+  */
+ bool StorageEngine::read_value(const std::string& key, std::string& scratch, std::string_view& value) {
+     Entry* entry = store.find(CompactString::borrow(key));
+     if (!entry) return frozen.find(key, value);
+ 
+     if (is_expired(*entry, coarse_now())) {
+         expire_entry(key);
+         return false;
+     }
+ 
+     MemoryManager::TimePoint expires_at{};
+     bool has_ttl = entry_expiry(*entry, expires_at);
+     mem_manager.record_access(key, has_ttl, expires_at);
+     value = entry->value.view(scratch);
+     return true;
+ }
+ 
+ /**
+  * @brief Edit a value's bytes, creating or zero-extending it first
+  * @param key Key to modify
+  * @param min_size Length the value is zero-extended to
+  * @param fn Called as fn(unsigned char* data, size_t size) on the value;
+  *        returns whether it changed anything
+  * @return false If the extended value does not fit in max_memory
+  * 
+  * @details An owned value longer than any integer's text is edited in its
+  * own buffer (grown with realloc when needed), so SETBIT on a megabyte
+  * bitmap copies nothing. Any other value (missing, inline, integer, or
+  * shared with other keys by deduplication) is copied out, edited and
+  * stored again in its canonical encoding; a shared value thereby becomes
+  * this key's own copy while the other keys keep the original
+  * (copy-on-write). A frozen key is thawed first and an expired key counts
+  * as missing. The TTL is kept; unless fn reports no change, version,
+  * WATCH, leases and eviction tracking are updated like any write.
+  * 
+  * @note Caller must hold mtx
+  */
+ template <typename Fn>
+ bool StorageEngine::update_bytes(const std::string& key, size_t min_size, Fn&& fn) {
+     const CompactString lookup = CompactString::borrow(key);
+     Entry* entry = find_for_write(key, lookup);
+     if (entry && is_expired(*entry, coarse_now())) {
+         expire_entry(key);
+         entry = nullptr;
+     }
+     size_t replaced = entry ? entry_bytes(key.size(), entry->value) : 0;
+     size_t incoming = key.size() + std::max(entry ? entry->value.size() : 0, min_size);
+     if (current_memory.total() + lazy_free.pending_bytes() - replaced + incoming > max_memory) {
+         if (!enforce_memory_limits(key, incoming)) return false;
+         entry = store.find(lookup); // Eviction may have picked this key
+     }
+ 
+     if (entry && entry->value.is_writable()) {
+         size_t size = entry->value.size();
+         if (min_size > size) {
+             entry->value.grow(min_size);
+             current_memory += min_size - size;
+             size = min_size;
+         }
+         if (!fn(reinterpret_cast<unsigned char*>(entry->value.mutable_data()), size)) return true;
+     } else {
+         std::string text;
+         if (entry) entry->value.append_to(text);
+         if (text.size() < min_size) text.resize(min_size, '\0');
+         if (!fn(reinterpret_cast<unsigned char*>(&text[0]), text.size()) && entry) return true;
+         CompactString updated(text);
+         if (entry) {
+             current_memory -= entry_bytes(key.size(), entry->value);
+             release_value(entry->value);
+             entry->value = std::move(updated);
+         } else {
+             store.insert(lookup, Entry{std::move(updated), 0, 0});
+             if (ordered_index) ordered_index->insert(key);
+             entry = store.find(lookup);
+         }
+         current_memory += entry_bytes(key.size(), entry->value);
+     }
+ 
+     entry->version = ++version_clock;
+     MemoryManager::TimePoint expires_at{};
+     bool has_ttl = entry_expiry(*entry, expires_at);
+     mem_manager.record_write(key, has_ttl, expires_at);
+     touch(key);
+     end_lease(key);
+     wake_evictor();
+     return true;
+ }
+ 
+ /**
+  * @brief Set or clear one bit of a value
+  * @param key Bitmap key
+  * @param offset Bit index
+  * @param value New bit
+  * @param[out] previous Bit before the write
+  * @return false If extending the value does not fit in max_memory
+  * 
+  * @note Locks mutex during operation
+  */
+ bool StorageEngine::setbit(const std::string& key, size_t offset, bool value, bool& previous) {
+     ForegroundLock lock(*this);
+     return update_bytes(key, offset / 8 + 1, [&](unsigned char* data, size_t) {
+         previous = Bitmap::set(data, offset, value);
+         return true;
+     });
+ }
+ 
+ /**
+  * @brief Read one bit of a value
+  * @param key Bitmap key
+  * @param offset Bit index
+  * @return bool The bit, false past the end of the value
+  * 
+  * @note Locks mutex during operation
+  */
+ bool StorageEngine::getbit(const std::string& key, size_t offset) {
+     ForegroundLock lock(*this);
+     std::string scratch;
+     std::string_view value;
+     if (!read_value(key, scratch, value) || offset / 8 >= value.size()) return false;
+     return Bitmap::get(reinterpret_cast<const unsigned char*>(value.data()), offset);
+ }
+ 
+ /**
+  * @brief Count the set bits of a value
+  * @param key Bitmap key
+  * @param start First byte (or bit)
+  * @param end Last byte (or bit), inclusive
+  * @param bit_units Whether start and end index bits
+  * @return size_t Set bits in the range
+  * 
+  * @note Locks mutex during operation
+  */
+ size_t StorageEngine::bitcount(const std::string& key, int64_t start, int64_t end, bool bit_units) {
+     ForegroundLock lock(*this);
+     std::string scratch;
+     std::string_view value;
+     size_t first, last;
+     if (!read_value(key, scratch, value) || !Bitmap::range(value.size(), start, end, bit_units, first, last)) {
+         return 0;
+     }
+     return Bitmap::count(reinterpret_cast<const unsigned char*>(value.data()), first, last);
+ }
+ 
+ /**
+  * @brief Find the first bit with a given value
+  * @param key Bitmap key
+  * @param value Bit looked for
+  * @param start First byte (or bit)
+  * @param end Last byte (or bit), inclusive
+  * @param end_given Whether end was given by the caller
+  * @param bit_units Whether start and end index bits
+  * @return int64_t Bit index, or -1
+  * 
+  * @note Locks mutex during operation
+  */
+ int64_t StorageEngine::bitpos(const std::string& key, bool value, int64_t start, int64_t end,
+                               bool end_given, bool bit_units) {
+     ForegroundLock lock(*this);
+     std::string scratch;
+     std::string_view bytes;
+     size_t first, last;
+     if (!read_value(key, scratch, bytes)) return value ? -1 : 0;
+     if (!Bitmap::range(bytes.size(), start, end, bit_units, first, last)) return -1;
+     int64_t pos = Bitmap::find(reinterpret_cast<const unsigned char*>(bytes.data()), first, last, value);
+     if (pos < 0 && !value && !end_given) return static_cast<int64_t>(last + 1);
+     return pos;
+ }
+ 
+ /**
+  * @brief Combine values bit by bit into a destination key
+  * @param op AND, OR, XOR or NOT
+  * @param dest Key receiving the result
+  * @param keys Source keys (NOT only reads the first)
+  * @param[out] length Length of the result
+  * @return false If the result does not fit in max_memory
+  * 
+  * @details Sources are read in place; the result is built in one buffer of
+  * the longest source's length, starting from the first source, and every
+  * other source is folded in 16 bytes at a time. For AND the bytes past a
+  * shorter source are cleared, since they read as zeros. NOT inverts its
+  * single source into the buffer.
+  * 
+  * @note Locks mutex during operation
+  */
+ bool StorageEngine::bitop(Bitmap::Op op, const std::string& dest, const std::vector<std::string>& keys,
+                           size_t& length) {
+     ForegroundLock lock(*this);
+     std::vector<std::string> scratch(keys.size());
+     std::vector<std::string_view> sources(keys.size());
+     length = 0;
+     for (size_t i = 0; i < keys.size(); i++) {
+         if (!read_value(keys[i], scratch[i], sources[i])) sources[i] = std::string_view();
+         length = std::max(length, sources[i].size());
+     }
+     if (op == Bitmap::Op::NOT) {
+         sources.resize(1);
+         length = sources[0].size();
+     }
+     if (length == 0) {
+         remove_entry(dest);
+         return true;
+     }
+ 
+     std::string result(length, '\0');
+     unsigned char* out = reinterpret_cast<unsigned char*>(&result[0]);
+     const unsigned char* first = reinterpret_cast<const unsigned char*>(sources[0].data());
+     if (op == Bitmap::Op::NOT) Bitmap::combine(op, out, first, length);
+     else if (!sources[0].empty()) std::memcpy(out, first, sources[0].size());
+     for (size_t i = 1; i < sources.size(); i++) {
+         Bitmap::combine(op, out, reinterpret_cast<const unsigned char*>(sources[i].data()), sources[i].size());
+         if (op == Bitmap::Op::AND) std::memset(out + sources[i].size(), 0, length - sources[i].size());
+     }
+ 
+     const CompactString lookup = CompactString::borrow(dest);
+     return write_entry(dest, lookup, store.find(lookup), result, std::chrono::seconds::max()) != 0;
+ }
+ 
+ /**
+  * @brief Add elements to a HyperLogLog sketch
+  * @param key Sketch key
+  * @param elements Elements to add
+  * @param[out] changed Whether a register changed or the key was created
+  * @return HllStatus OK, WRONGTYPE or OOM
+  * 
+  * @details A dense sketch (a 12KB owned value) has its 6-bit registers
+  * raised in its own buffer through update_bytes(), so PFADD on a large
+  * counter copies nothing. A sparse sketch is unpacked to one byte per
+  * register, updated, and encoded again, dense if it no longer fits the
+  * sparse limit; a missing key starts from empty registers.
+  * 
+  * @note Locks mutex during operation
+  */
+ HllStatus StorageEngine::pfadd(const std::string& key, const std::vector<std::string>& elements, bool& changed) {
+     ForegroundLock lock(*this);
+     changed = false;
+     const CompactString lookup = CompactString::borrow(key);
+     Entry* entry = find_for_write(key, lookup);
+     if (entry && is_expired(*entry, coarse_now())) {
+         expire_entry(key);
+         entry = nullptr;
+     }
+     std::string scratch;
+     std::string_view current = entry ? entry->value.view(scratch) : std::string_view();
+     if (entry && !HyperLogLog::valid(current)) return HllStatus::WRONGTYPE;
+ 
+     if (entry && HyperLogLog::is_dense(current)) {
+         bool fits = update_bytes(key, 0, [&](unsigned char* data, size_t) {
+             for (const auto& element : elements) changed |= HyperLogLog::add_dense(data, element);
+             return changed;
+         });
+         return fits ? HllStatus::OK : HllStatus::OOM;
+     }
+ 
+     std::vector<uint8_t> registers(HyperLogLog::REGISTERS, 0);
+     if (entry) HyperLogLog::decode(current, registers.data());
+     for (const auto& element : elements) changed |= HyperLogLog::add(registers.data(), element);
+     if (entry && !changed) return HllStatus::OK;
+     changed = true;
+     if (write_entry(key, lookup, entry, HyperLogLog::encode(registers.data()), std::chrono::seconds::max(), true) == 0) {
+         return HllStatus::OOM;
+     }
+     return HllStatus::OK;
+ }
+ 
+ /**
+  * @brief Estimate the number of distinct elements added to sketches
+  * @param keys Sketch keys
+  * @param[out] count Estimated cardinality
+  * @return HllStatus OK or WRONGTYPE
+  * 
+  * @details With one key, a valid cached count is returned as is; otherwise
+  * the count is computed and, if the value can be written in place, cached
+  * in its header (not a modification: the version does not change). With
+  * several keys the registers are unpacked and merged 16 at a time into a
+  * temporary union, which is not cached.
+  * 
+  * @note Locks mutex during operation
+  */
+ HllStatus StorageEngine::pfcount(const std::vector<std::string>& keys, uint64_t& count) {
+     ForegroundLock lock(*this);
+     count = 0;
+     std::vector<uint8_t> registers(HyperLogLog::REGISTERS, 0);
+     std::string scratch;
+     std::string_view value;
+     if (keys.size() == 1) {
+         if (!read_value(keys[0], scratch, value)) return HllStatus::OK;
+         if (!HyperLogLog::valid(value)) return HllStatus::WRONGTYPE;
+         if (HyperLogLog::cached(value, count)) return HllStatus::OK;
+         HyperLogLog::decode(value, registers.data());
+         count = HyperLogLog::estimate(registers.data());
+         Entry* entry = store.find(CompactString::borrow(keys[0]));
+         if (entry && entry->value.is_writable()) {
+             HyperLogLog::set_cache(reinterpret_cast<unsigned char*>(entry->value.mutable_data()), count);
+         }
+         return HllStatus::OK;
+     }
+ 
+     for (const auto& key : keys) {
+         if (!read_value(key, scratch, value)) continue;
+         if (!HyperLogLog::valid(value)) return HllStatus::WRONGTYPE;
+         HyperLogLog::merge_value(value, registers.data());
+     }
+     count = HyperLogLog::estimate(registers.data());
+     return HllStatus::OK;
+ }
+ 
+ /**
+  * @brief Merge sketches into a destination sketch
+  * @param dest Key receiving the union
+  * @param keys Source sketch keys
+  * @return HllStatus OK, WRONGTYPE or OOM
+  * 
+  * @details Every source (and dest itself) is unpacked and merged with a
+  * byte-wise maximum; the union is encoded sparse or dense like PFADD.
+  * 
+  * @note Locks mutex during operation
+  */
+ HllStatus StorageEngine::pfmerge(const std::string& dest, const std::vector<std::string>& keys) {
+     ForegroundLock lock(*this);
+     std::vector<uint8_t> registers(HyperLogLog::REGISTERS, 0);
+     std::string scratch;
+     std::string_view value;
+     if (read_value(dest, scratch, value)) {
+         if (!HyperLogLog::valid(value)) return HllStatus::WRONGTYPE;
+         HyperLogLog::merge_value(value, registers.data());
+     }
+     for (const auto& key : keys) {
+         if (!read_value(key, scratch, value)) continue;
+         if (!HyperLogLog::valid(value)) return HllStatus::WRONGTYPE;
+         HyperLogLog::merge_value(value, registers.data());
+     }
+ 
+     const CompactString lookup = CompactString::borrow(dest);
+     Entry* entry = find_for_write(dest, lookup);
+     if (write_entry(dest, lookup, entry, HyperLogLog::encode(registers.data()), std::chrono::seconds::max(), true) == 0) {
+         return HllStatus::OOM;
+     }
+     return HllStatus::OK;
+ }
+ 
+ /**
+  * @brief Align a stored Bloom filter to cache lines
+  * @param lookup Borrowed encoding of the filter's key
+  * 
+  * @details The value was just copied into its own buffer, at an address
+  * of malloc's choosing; BloomFilter::align() shifts the blocks to the next
+  * 64-byte boundary of that buffer. Does not change the version.
+  * 
+  * @note Caller must hold mtx
+  */
+ void StorageEngine::align_filter(const CompactString& lookup) {
+     Entry* entry = store.find(lookup);
+     if (!entry || !entry->value.is_writable()) return;
+     unsigned char* data = reinterpret_cast<unsigned char*>(entry->value.mutable_data());
+     size_t size = entry->value.size();
+     if (BloomFilter::valid(std::string_view(reinterpret_cast<const char*>(data), size))) {
+         BloomFilter::align(data, size);
+     }
+ }
+ 
+ /**
+  * @brief Create an empty Bloom filter
+  * @param key Filter key
+  * @param error_rate False positive rate
+  * @param capacity Number of elements the rate holds for
+  * @return BloomStatus OK, EXISTS or OOM
+  * 
+  * @note Locks mutex during operation
+  */
+ BloomStatus StorageEngine::bf_reserve(const std::string& key, double error_rate, uint64_t capacity) {
+     ForegroundLock lock(*this);
+     const CompactString lookup = CompactString::borrow(key);
+     Entry* entry = find_for_write(key, lookup);
+     if (entry && is_expired(*entry, coarse_now())) {
+         expire_entry(key);
+         entry = nullptr;
+     }
+     if (entry) return BloomStatus::EXISTS;
+ 
+     size_t blocks = 1;
+     unsigned hashes = 1;
+     BloomFilter::plan(error_rate, capacity, blocks, hashes);
+     if (write_entry(key, lookup, nullptr, BloomFilter::create(blocks, hashes), std::chrono::seconds::max()) == 0) {
+         return BloomStatus::OOM;
+     }
+     align_filter(lookup);
+     return BloomStatus::OK;
+ }
+ 
+ /**
+  * @brief Add elements to a Bloom filter
+  * @param key Filter key
+  * @param elements Elements to add
+  * @param[out] added Per element, whether it was new to the filter
+  * @return BloomStatus OK, WRONGTYPE or OOM
+  * 
+  * @details A missing key first gets an empty filter sized with
+  * BloomFilter::DEFAULT_ERROR_RATE and DEFAULT_CAPACITY. The bits are then
+  * set through update_bytes(), in the value's own buffer unless it is
+  * shared; the blocks are realigned to cache lines first if the value has
+  * moved since it was created or restored (SET of a filter, FREEZE and
+  * back, defragmentation).
+  * 
+  * @note Locks mutex during operation
+  */
+ BloomStatus StorageEngine::bf_add(const std::string& key, const std::vector<std::string>& elements,
+                                   std::vector<bool>& added) {
+     ForegroundLock lock(*this);
+     added.assign(elements.size(), false);
+     const CompactString lookup = CompactString::borrow(key);
+     Entry* entry = find_for_write(key, lookup);
+     if (entry && is_expired(*entry, coarse_now())) {
+         expire_entry(key);
+         entry = nullptr;
+     }
+     if (entry) {
+         std::string scratch;
+         if (!BloomFilter::valid(entry->value.view(scratch))) return BloomStatus::WRONGTYPE;
+     } else {
+         size_t blocks = 1;
+         unsigned hashes = 1;
+         BloomFilter::plan(BloomFilter::DEFAULT_ERROR_RATE, BloomFilter::DEFAULT_CAPACITY, blocks, hashes);
+         if (write_entry(key, lookup, nullptr, BloomFilter::create(blocks, hashes), std::chrono::seconds::max()) == 0) {
+             return BloomStatus::OOM;
          }
+         align_filter(lookup);
      }
  
-     // Batch remove expired entries
-     for (const auto& key : keys_to_remove) {
-         store.remove(key);
-         mem_manager.evict_lru(key);
+     bool fits = update_bytes(key, 0, [&](unsigned char* data, size_t size) {
+         BloomFilter::align(data, size);
+         return BloomFilter::add(data, size, elements, added);
+     });
+     return fits ? BloomStatus::OK : BloomStatus::OOM;
+ }
+ 
+ /**
+  * @brief Look elements up in a Bloom filter
+  * @param key Filter key
+  * @param elements Elements to look up
+  * @param[out] found Per element, whether it may have been added
+  * @return BloomStatus OK or WRONGTYPE
+  * 
+  * @details Read-only. Filters are aligned to cache lines when created or
+  * restored, so each element costs one cache miss; a filter that has moved
+  * since reads the same, with blocks that may straddle two lines until the
+  * next BF.ADD realigns it.
+  * 
+  * @note Locks mutex during operation
+  */
+ BloomStatus StorageEngine::bf_exists(const std::string& key, const std::vector<std::string>& elements,
+                                      std::vector<bool>& found) {
+     ForegroundLock lock(*this);
+     found.assign(elements.size(), false);
+     std::string scratch;
+     std::string_view value;
+     if (!read_value(key, scratch, value)) return BloomStatus::OK;
+     if (!BloomFilter::valid(value)) return BloomStatus::WRONGTYPE;
+     BloomFilter::contains(value, elements, found);
+     return BloomStatus::OK;
+ }
+ 
+ /**
+  * @brief Delete a key-value pair
+  * @param key Key to delete
+  * @return true If key existed and was deleted
+  * @return false If key didn't exist
+  * 
+  * @details Implements DEL operation with:
+  * - Memory usage adjustment
+  * - Eviction policy tracking cleanup
+  * 
+  * @note Locks mutex during operation
+  */
+ bool StorageEngine::del(const std::string& key) {
+     ForegroundLock lock(*this);
+     return remove_entry(key);
+ }
+ 
+ /**
+  * @brief Delete a key-value pair only if its version matches
+  * @param key Key to delete
+  * @param expected Version the caller last read
+  * @return true If the key existed at that version and was deleted
+  * 
+  * @details Implements DEL ... IFVERSION
+  * 
+  * @note Locks mutex during operation
+  */
+ bool StorageEngine::del_if_version(const std::string& key, uint64_t expected) {
+     ForegroundLock lock(*this);
+     const Entry* entry = find_for_write(key, CompactString::borrow(key));
+     if (entry && is_expired(*entry, coarse_now())) {
+         expire_entry(key);
+         entry = nullptr;
      }
+     if (!entry || entry->version != expected) return false;
+     return remove_entry(key);
+ }
+ 
+ /**
+  * @brief Delete a key-value pair without freeing its value inline
+  * @param key Key to unlink
+  * @return true If key existed and was unlinked
+  * @return false If key didn't exist
+  * 
+  * @details Implements UNLINK: same as DEL, except that values of at least
+  * lazyfree_min_bytes are destroyed on the lazy-free thread
+  * 
+  * @note Locks mutex during operation
+  */
+ bool StorageEngine::unlink(const std::string& key) {
+     ForegroundLock lock(*this);
+     return remove_entry(key, true);
+ }
+ 
+ /**
+  * @brief Start watching a key
+  * @param key Key to watch
+  * @return uint64_t Modification count at the time of the call
+  * 
+  * @details Keys are reference-counted in the registry, so several clients
+  * can watch the same key and the entry disappears with the last unwatch()
+  * 
+  * @note Locks mutex during operation
+  */
+ uint64_t StorageEngine::watch(const std::string& key) {
+     ForegroundLock lock(*this);
+     WatchSlot& slot = watched_keys[key];
+     slot.watchers++;
+     return slot.touches;
+ }
+ 
+ /**
+  * @brief Stop watching a key
+  * @param key Key passed to watch()
+  * 
+  * @note Locks mutex during operation
+  */
+ void StorageEngine::unwatch(const std::string& key) {
+     ForegroundLock lock(*this);
+     auto it = watched_keys.find(key);
+     if (it != watched_keys.end() && --it->second.watchers == 0) watched_keys.erase(it);
+ }
+ 
+ /**
+  * @brief Current modification count of a watched key
+  * @param key Key passed to watch()
+  * @return uint64_t Modification count (0 if the key is not watched)
+  * 
+  * @note Locks mutex during operation
+  */
+ uint64_t StorageEngine::watch_touches(const std::string& key) {
+     ForegroundLock lock(*this);
+     auto it = watched_keys.find(key);
+     return it == watched_keys.end() ? 0 : it->second.touches;
+ }
+ 
+ /**
+  * @brief List keys starting with a prefix
+  * @param prefix Key prefix to match
+  * @param limit Maximum number of keys to return (0 = unlimited)
+  * @return std::vector<std::string> Matching keys in lexicographic order
+  * 
+  * @details Descends the ordered index to the prefix in O(prefix length) and
+  * then walks only the matching keys
+  * 
+  * @note Locks mutex during operation
+  */
+ std::vector<std::string> StorageEngine::keys_with_prefix(const std::string& prefix, size_t limit) {
+     ForegroundLock lock(*this);
+     require_ordered_index();
+ 
+     std::vector<std::string> keys;
+     ordered_index->for_each_prefix(prefix, [&](const std::string& key) {
+         keys.push_back(key);
+         return limit == 0 || keys.size() < limit;
+     });
+     return keys;
+ }
+ 
+ /**
+  * @brief List keys in the half-open range [start, end)
+  * @param start Inclusive lower bound
+  * @param end Exclusive upper bound (empty = unbounded)
+  * @param limit Maximum number of keys to return (0 = unlimited)
+  * @return std::vector<std::string> Matching keys in lexicographic order
+  * 
+  * @note Locks mutex during operation
+  */
+ std::vector<std::string> StorageEngine::keys_in_range(const std::string& start, const std::string& end,
+                                                       size_t limit) {
+     ForegroundLock lock(*this);
+     require_ordered_index();
+ 
+     std::vector<std::string> keys;
+     ordered_index->for_each_range(start, end, [&](const std::string& key) {
+         keys.push_back(key);
+         return limit == 0 || keys.size() < limit;
+     });
+     return keys;
+ }
+ 
+ /**
+  * @brief Delete every key starting with a prefix
+  * @param prefix Key prefix to match
+  * @return size_t Number of keys deleted
+  * 
+  * @details Collects the matching keys from the ordered index first, then
+  * removes them. Cost is proportional to the number of matching keys.
+  * 
+  * @note Locks mutex during operation
+  */
+ size_t StorageEngine::del_prefix(const std::string& prefix) {
+     ForegroundLock lock(*this);
+     require_ordered_index();
+ 
+     std::vector<std::string> keys;
+     ordered_index->for_each_prefix(prefix, [&](const std::string& key) {
+         keys.push_back(key);
+         return true;
+     });
+ 
+     size_t deleted = 0;
+     for (const auto& key : keys) {
+         if (remove_entry(key)) deleted++;
+     }
+     return deleted;
+ }
+ 
+ /**
+  * @brief Change the tags of a key, charging the tag index to current_memory
+  * @param key Key being tagged or removed
+  * @param tags New tags, or nullptr to drop the key from the index
+  * 
+  * @details The index's size estimate is O(1), so its change is taken
+  * around the update; summed over all updates it equals the index's size.
+  * 
+  * @note Caller must hold mtx
+  */
+ void StorageEngine::retag(const std::string& key, const std::vector<std::string>* tags) {
+     if (!tags && tag_index.empty()) return;
+     size_t before = tag_index.memory_bytes();
+     if (tags) {
+         tag_index.assign(key, *tags);
+     } else {
+         tag_index.forget(key);
+     }
+     current_memory = current_memory + tag_index.memory_bytes() - before;
+ }
+ 
+ /**
+  * @brief Delete every key carrying any of the given tags
+  * @param tag_names Tags to invalidate
+  * @return size_t Number of keys deleted
+  * 
+  * @details Each tag's keys are copied out of the tag index first, since
+  * remove_entry drops them from it. A key carrying several of the tags is
+  * deleted once; the tags vanish with their last key.
+  * 
+  * @note Locks mutex during operation
+  */
+ size_t StorageEngine::invalidate(const std::vector<std::string>& tag_names) {
+     ForegroundLock lock(*this);
+     size_t deleted = 0;
+     for (const auto& tag : tag_names) {
+         for (const auto& key : tag_index.keys(tag)) {
+             if (remove_entry(key, true)) deleted++;
+         }
+     }
+     return deleted;
+ }
+ 
+ /**
+  * @brief Incrementally iterate the keyspace
+  * @param cursor Cursor from the previous call (0 to start)
+  * @param[out] keys Matching keys visited by this call
+  * @param pattern Glob pattern keys must match
+  * @param count Entries to visit before returning
+  * @return size_t Next cursor, 0 once the iteration is complete
+  * 
+  * @details Stops after visiting `count` entries or `count *
+  * SCAN_BUCKETS_PER_ENTRY` buckets, whichever comes first, so sparse tables
+  * cannot make one call run long.
+  * Expired entries that the daemon has not reaped yet are skipped. A cursor
+  * into the frozen tier carries the tier's generation; if a FREEZE rebuilt
+  * the tier since, its slots mean nothing anymore and the frozen part is
+  * walked again from the start, which may repeat keys but misses none.
+  * 
+  * @note Locks mutex during operation
+  */
+ size_t StorageEngine::scan(size_t cursor, std::vector<std::string>& keys,
+                            const std::string& pattern, size_t count) {
+     GlobPattern glob(pattern);
+     // Clamped so the bucket budget below cannot overflow
+     count = std::clamp<size_t>(count, 1, SIZE_MAX / SCAN_BUCKETS_PER_ENTRY);
+ 
+     ForegroundLock lock(*this);
+     const uint32_t now = coarse_now();
+     size_t visited = 0;
+     size_t max_buckets = count * SCAN_BUCKETS_PER_ENTRY;
+ 
+     if (cursor < FROZEN_CURSOR) {
+         do {
+             cursor = store.scan(cursor, [&](const CompactString& key, const Entry& entry) {
+                 visited++;
+                 if (is_expired(entry, now)) return;
+                 std::string text = key.str();
+                 if (glob.matches(text)) keys.push_back(std::move(text));
+             });
+         } while (cursor != 0 && visited < count && --max_buckets > 0);
+ 
+         if (cursor != 0 || frozen.empty()) return cursor;
+         cursor = frozen_cursor(0);
+         if (visited >= count) return cursor;
+     }
+ 
+     size_t slot = cursor & FROZEN_SLOT_MASK;
+     if (cursor != frozen_cursor(slot)) slot = 0; // Tier rebuilt since
+     slot = frozen.scan(slot, count - visited, [&](std::string_view key, std::string_view) {
+         std::string text(key);
+         if (glob.matches(text)) keys.push_back(std::move(text));
+     });
+     return slot == 0 ? 0 : frozen_cursor(slot);
+ }
+ 
+ /**
+  * @brief Move keys into the frozen tier
+  * @param pattern Glob pattern of the keys to freeze
+  * @return size_t Number of keys moved
+  * 
+  * @details Runs in three steps so that clients are only blocked while
+  * records are copied and while the result is installed:
+  * - Under the lock, copies the tier's live records and every matching key
+  *   without a TTL, noting each key's version
+  * - Without the lock, builds the new tier (the perfect hash dominates)
+  * - Under the lock, tombstones in the new tier every record that went stale
+  *   meanwhile (a key written, expired-by-TTL or deleted since its copy, a
+  *   frozen key thawed or deleted), swaps the tier in and detaches the moved
+  *   keys from the hash table, memory accounting and eviction tracking
+  * If another FREEZE installed its tier first, the copy is redone. The keys
+  * stay in the ordered index and their values do not change, so WATCH is not
+  * notified. All frozen keys take one new version.
+  * 
+  * @note Locks mutex while copying and while installing
+  */
+ size_t StorageEngine::freeze(const std::string& pattern) {
+     GlobPattern glob(pattern);
+ 
+     while (true) {
+         std::vector<std::string> keys;
+         std::vector<uint64_t> versions;
+         std::vector<std::pair<std::string, std::string>> records;
+         uint64_t generation;
+         size_t frozen_live;
+         {
+             ForegroundLock lock(*this);
+             size_t cursor = 0;
+             do {
+                 cursor = store.scan(cursor, [&](const CompactString& key, const Entry& entry) {
+                     if (entry.expires_at != 0) return;
+                     std::string text = key.str();
+                     if (glob.matches(text)) keys.push_back(std::move(text));
+                 });
+             } while (cursor != 0);
+             std::sort(keys.begin(), keys.end());
+             keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+             if (keys.empty()) return 0;
+ 
+             records.reserve(frozen.size() + keys.size());
+             frozen.for_each([&](std::string_view key, std::string_view value) {
+                 records.emplace_back(key, value);
+             });
+             versions.reserve(keys.size());
+             for (const auto& key : keys) {
+                 const Entry* entry = store.find(CompactString::borrow(key));
+                 records.emplace_back(key, entry->value.str());
+                 versions.push_back(entry->version);
+             }
+             generation = frozen_generation;
+             frozen_live = frozen.size();
+         }
+ 
+         FrozenTier built(records);
+ 
+         ForegroundLock lock(*this);
+         if (frozen_generation != generation) continue;
+         // The tier only ever loses keys, so an unchanged count means none left it
+         if (frozen.size() != frozen_live) {
+             std::string_view value;
+             for (size_t i = 0; i < records.size() - keys.size(); i++) {
+                 if (!frozen.find(records[i].first, value)) built.erase(records[i].first);
+             }
+         }
+         size_t moved = 0;
+         for (size_t i = 0; i < keys.size(); i++) {
+             const CompactString lookup = CompactString::borrow(keys[i]);
+             Entry* entry = store.find(lookup);
+             if (!entry || entry->version != versions[i] || entry->expires_at != 0) {
+                 built.erase(keys[i]);
+                 continue;
+             }
+             current_memory -= entry_bytes(keys[i].size(), entry->value);
+             release_value(entry->value);
+             store.remove(lookup);
+             mem_manager.forget(keys[i]);
+             moved++;
+         }
+         frozen = std::move(built);
+         frozen_generation++;
+         frozen_version = ++version_clock;
+         return moved;
+     }
+ }
+ 
+ /**
+  * @brief Insert many key-value pairs at once
+  * @param records Keys and values to store
+  * @return true If stored, false if the batch does not fit
+  * 
+  * @details Compared with one SET per record this skips, per key: the lock
+  * acquisition, the memory check and eviction, the incremental rehash steps
+  * of a growing table (HashTable::reserve sizes it once) and the TTL
+  * bookkeeping. New keys reach the eviction policy in a final pass, after the
+  * table inserts, with the policy's index sized once. A key that repeats or already exists goes through
+  * write_entry like a SET.
+  * 
+  * @note Locks mutex during operation
+  */
+ bool StorageEngine::bulk_load(const std::vector<std::pair<std::string, std::string>>& records) {
+     ForegroundLock lock(*this);
+ 
+     size_t incoming = 0;
+     for (const auto& record : records) incoming += record.first.size() + record.second.size();
+     if (current_memory.total() + lazy_free.pending_bytes() + incoming > max_memory &&
+         !enforce_memory_limits(std::string(), incoming)) {
+         return false;
+     }
+ 
+     store.reserve(store.get_size() + records.size());
+     std::vector<const std::string*> inserted;
+     inserted.reserve(records.size());
+     for (const auto& [key, value] : records) {
+         const CompactString lookup = CompactString::borrow(key);
+         Entry* entry = store.find(lookup);
+         if (entry) {
+             write_entry(key, lookup, entry, value, std::chrono::seconds::max());
+             continue;
+         }
+         Entry fresh{intern(value), ++version_clock, 0};
+         current_memory += entry_bytes(key.size(), fresh.value);
+         store.insert(lookup, std::move(fresh));
+         frozen.erase(key);
+         if (ordered_index) ordered_index->insert(key);
+         touch(key);
+         end_lease(key);
+         inserted.push_back(&key);
+     }
+ 
+     mem_manager.record_bulk_write(inserted);
+     wake_evictor();
+     return true;
+ }
+ 
+ /**
+  * @brief Serialize one key
+  * @param key Key to serialize
+  * @param[out] payload DUMP blob
+  * @return true If the key exists
+  * 
+  * @note Locks mutex during operation
+  */
+ bool StorageEngine::dump(const std::string& key, std::string& payload) {
+     ForegroundLock lock(*this);
+     payload.clear();
+     DumpPayload::begin(payload, DumpPayload::SINGLE);
+     if (!dump_record(payload, false, key)) return false;
+     DumpPayload::finish(payload);
+     return true;
+ }
+ 
+ /**
+  * @brief Serialize several keys into one blob
+  * @param keys Keys to serialize
+  * @param[out] dumped Number of keys in the blob
+  * @return std::string KEYED DUMP blob
+  * 
+  * @note Locks mutex during operation
+  */
+ std::string StorageEngine::dump_keys(const std::vector<std::string>& keys, size_t& dumped) {
+     std::string payload;
+     DumpPayload::begin(payload, DumpPayload::KEYED);
+     dumped = 0;
+     {
+         ForegroundLock lock(*this);
+         for (const auto& key : keys) {
+             if (dump_record(payload, true, key)) dumped++;
+         }
+     }
+     DumpPayload::finish(payload);
+     return payload;
+ }
+ 
+ /**
+  * @brief Install a DUMP blob under a key
+  * @param key Target key
+  * @param payload Blob produced by dump()
+  * @param replace Overwrite an existing key
+  * @return RestoreStatus Outcome
+  * 
+  * @details The blob is validated before the lock is taken. The write goes
+  * through write_entry, so it gets a new version and notifies WATCH like SET.
+  * 
+  * @note Locks mutex during operation
+  */
+ RestoreStatus StorageEngine::restore(const std::string& key, const std::string& payload, bool replace) {
+     DumpPayload reader;
+     DumpPayload::Record record;
+     if (!reader.open(payload) || reader.payload_kind() != DumpPayload::SINGLE ||
+         !reader.next(record) || !reader.at_end()) {
+         return RestoreStatus::BAD_PAYLOAD;
+     }
+ 
+     ForegroundLock lock(*this);
+     if (!replace && key_exists(key)) return RestoreStatus::BUSY_KEY;
+     const CompactString lookup = CompactString::borrow(key);
+     if (write_entry(key, lookup, store.find(lookup), record.value, record.ttl) == 0) return RestoreStatus::OOM;
+     if (BloomFilter::valid(record.value)) align_filter(lookup);
+     return RestoreStatus::OK;
+ }
+ 
+ /**
+  * @brief Install every key of an MDUMP blob
+  * @param payload Blob produced by dump_keys()
+  * @param replace Overwrite existing keys
+  * @param[out] restored Number of keys installed
+  * @return RestoreStatus Outcome; after OOM the first `restored` keys stay installed
+  * 
+  * @note Locks mutex during operation
+  */
+ RestoreStatus StorageEngine::restore_keys(const std::string& payload, bool replace, size_t& restored) {
+     restored = 0;
+     DumpPayload reader;
+     if (!reader.open(payload) || reader.payload_kind() != DumpPayload::KEYED) return RestoreStatus::BAD_PAYLOAD;
+     std::vector<DumpPayload::Record> records;
+     while (!reader.at_end()) {
+         records.emplace_back();
+         if (!reader.next(records.back())) return RestoreStatus::BAD_PAYLOAD;
+     }
+ 
+     ForegroundLock lock(*this);
+     std::vector<std::string> keys;
+     keys.reserve(records.size());
+     for (const auto& record : records) {
+         keys.emplace_back(record.key);
+         if (!replace && key_exists(keys.back())) return RestoreStatus::BUSY_KEY;
+     }
+     for (size_t i = 0; i < records.size(); i++) {
+         const CompactString lookup = CompactString::borrow(keys[i]);
+         if (write_entry(keys[i], lookup, store.find(lookup), records[i].value, records[i].ttl) == 0) {
+             return RestoreStatus::OOM;
+         }
+         if (BloomFilter::valid(records[i].value)) align_filter(lookup);
+         restored++;
+     }
+     return RestoreStatus::OK;
+ }
+ 
+ /**
+  * @brief Append a key's record to a DUMP blob
+  * @param out Blob being built
+  * @param keyed Whether records carry their key
+  * @param key Key to serialize
+  * @return true If the key exists
+  * 
+  * @details The TTL is stored as the time remaining on the coarse clock, so
+  * it survives the move between instances.
+  * 
+  * @note Caller must hold mtx
+  */
+ bool StorageEngine::dump_record(std::string& out, bool keyed, const std::string& key) {
+     const Entry* entry = store.find(CompactString::borrow(key));
+     if (entry) {
+         uint32_t now = coarse_now();
+         if (is_expired(*entry, now)) return false;
+         auto ttl = entry->expires_at == 0 ? std::chrono::seconds::max()
+                                           : std::chrono::seconds(entry->expires_at - std::min(now, entry->expires_at));
+         DumpPayload::add(out, keyed, key, entry->value, ttl);
+         return true;
+     }
+     std::string_view value;
+     if (!frozen.find(key, value)) return false;
+     DumpPayload::add(out, keyed, key, CompactString(value), std::chrono::seconds::max());
+     return true;
+ }
+ 
+ /**
+  * @brief Check whether a key exists in either tier
+  * @param key Key to look up
+  * @return true If the key is live
+  * 
+  * @note Caller must hold mtx
+  */
+ bool StorageEngine::key_exists(const std::string& key) {
+     const Entry* entry = store.find(CompactString::borrow(key));
+     if (entry) return !is_expired(*entry, coarse_now());
+     std::string_view value;
+     return frozen.find(key, value);
+ }
+ 
+ /**
+  * @brief Find a key's entry for a write, thawing a frozen key
+  * @param key Key being written
+  * @param lookup Borrowed encoding of key
+  * @return Entry* Entry in the hash table, or nullptr if the key does not exist
+  * 
+  * @details A frozen key is copied into the hash table with the frozen
+  * version and tombstoned in the tier, so read-modify-write commands and
+  * version checks see it like any other key. The copy is charged to
+  * current_memory; the caller's write enforces the limit.
+  * 
+  * @note Caller must hold mtx
+  */
+ StorageEngine::Entry* StorageEngine::find_for_write(const std::string& key, const CompactString& lookup) {
+     Entry* entry = store.find(lookup);
+     if (entry || frozen.empty()) return entry;
+ 
+     std::string_view value;
+     if (!frozen.find(key, value)) return nullptr;
+     Entry thawed{intern(std::string(value)), frozen_version, 0};
+     current_memory += entry_bytes(key.size(), thawed.value);
+     frozen.erase(key);
+     store.insert(lookup, std::move(thawed));
+     mem_manager.record_write(key, false, {});
+     return store.find(lookup);
+ }
+ 
+ /**
+  * @brief Report engine and memory statistics
+  * @return Ordered name/value pairs
+  * 
+  * @details RSS and allocator figures come from the stats task, which
+  * samples them once per second, so INFO never walks the heap itself
+  * 
+  * @note Locks mutex during operation
+  */
+ std::vector<std::pair<std::string, std::string>> StorageEngine::stats() {
+     size_t rss = sampled_rss;
+     size_t allocated = sampled_allocated;
+     auto tasks = maintenance.task_stats();
+ 
+     ForegroundLock lock(*this);
+     std::vector<std::pair<std::string, std::string>> out;
+     out.emplace_back("keys", std::to_string(store.get_size() + frozen.size()));
+     out.emplace_back("frozen_keys", std::to_string(frozen.size()));
+     out.emplace_back("frozen_memory", std::to_string(frozen.memory_bytes()));
+     out.emplace_back("hash_table_buckets", std::to_string(store.get_capacity()));
+     static const char* page_modes[] = {"off", "thp", "hugetlb"};
+     out.emplace_back("hash_table_huge_pages", page_modes[static_cast<int>(store.get_page_mode())]);
+     out.emplace_back("hash_table_rehashing", store.is_rehashing() ? "1" : "0");
+     out.emplace_back("used_memory", std::to_string(current_memory + lazy_free.pending_bytes()));
+     if (current_memory.is_shared()) {
+         out.emplace_back("used_memory_all_keyspaces", std::to_string(current_memory.total()));
+     }
+     out.emplace_back("maxmemory", std::to_string(max_memory));
+     out.emplace_back("maxmemory_policy", MemoryManager::policy_name(mem_manager.get_policy()));
+     out.emplace_back("maxmemory_high_watermark", std::to_string(high_watermark));
+     out.emplace_back("maxmemory_low_watermark", std::to_string(low_watermark));
+     out.emplace_back("cgroup_memory_enabled", cgroup.enabled ? "1" : "0");
+     if (cgroup.enabled) {
+         char pressure[32];
+         std::snprintf(pressure, sizeof(pressure), "%.2f", cgroup.pressure);
+         out.emplace_back("cgroup_memory_limit", std::to_string(cgroup.limit));
+         out.emplace_back("cgroup_working_set", std::to_string(cgroup.working_set));
+         out.emplace_back("cgroup_memory_pressure", pressure);
+         out.emplace_back("cgroup_limit_scale_pct", std::to_string(cgroup.scale_pct));
+         out.emplace_back("cgroup_limit_adjustments", std::to_string(cgroup.adjustments));
+     }
+     out.emplace_back("evicted_keys", std::to_string(evicted_keys));
+     out.emplace_back("evicted_keys_sync", std::to_string(evicted_keys_sync));
+     out.emplace_back("expired_keys", std::to_string(expired_keys));
+     out.emplace_back("incr_combine_batches", std::to_string(incr_batches));
+     out.emplace_back("incr_merged", std::to_string(incr_merged));
+     out.emplace_back("leases", std::to_string(leases.size()));
+     out.emplace_back("lease_grants", std::to_string(lease_grants));
+     out.emplace_back("lease_waits", std::to_string(lease_waits));
+     out.emplace_back("lease_rejected", std::to_string(lease_rejected));
+     out.emplace_back("stale_values", std::to_string(stale_values.size()));
+     out.emplace_back("tags", std::to_string(tag_index.tag_count()));
+     out.emplace_back("tagged_keys", std::to_string(tag_index.key_count()));
+     out.emplace_back("tag_index_memory", std::to_string(tag_index.memory_bytes()));
+     out.emplace_back("dedup_enabled", dedup_min_bytes > 0 ? "1" : "0");
+     out.emplace_back("dedup_values", std::to_string(dedup_table.size()));
+     out.emplace_back("dedup_saved_bytes", std::to_string(dedup_saved_bytes));
+     out.emplace_back("lazyfree_pending_objects", std::to_string(lazy_free.pending_objects()));
+     out.emplace_back("lazyfree_pending_memory", std::to_string(lazy_free.pending_bytes()));
+     out.emplace_back("lazyfreed_objects", std::to_string(lazy_free.freed_objects()));
+     out.emplace_back("used_memory_rss", std::to_string(rss));
+     out.emplace_back("allocator_allocated", std::to_string(allocated));
+     if (allocated > 0) {
+         char ratio[32];
+         std::snprintf(ratio, sizeof(ratio), "%.2f", static_cast<double>(rss) / allocated);
+         out.emplace_back("allocator_frag_ratio", ratio);
+     }
+     out.emplace_back("active_defrag_enabled", defrag.enabled ? "1" : "0");
+     out.emplace_back("active_defrag_running", defrag.in_cycle ? "1" : "0");
+     out.emplace_back("active_defrag_cycles", std::to_string(defrag.cycles));
+     out.emplace_back("active_defrag_relocations", std::to_string(defrag.relocations));
+     for (const auto& task : tasks) {
+         std::string prefix = "maintenance_" + task.name + "_";
+         out.emplace_back(prefix + "runs", std::to_string(task.runs));
+         out.emplace_back(prefix + "deferrals", std::to_string(task.deferrals));
+         out.emplace_back(prefix + "busy_us", std::to_string(task.busy.count()));
+         out.emplace_back(prefix + "interval_ms", std::to_string(task.interval.count()));
+     }
+     return out;
+ }
+ 
+ /**
+  * @brief Run one CPU-budgeted slice of active defragmentation
+  * 
+  * @details Outside a cycle, compares RSS with the bytes the allocator has
+  * handed out; a cycle starts when the difference exceeds defrag_threshold_pct
+  * and has grown by defrag_ignore_bytes since the last cycle settled. Within a
+  * cycle, entries are relocated bucket by bucket (node, key and value buffer)
+  * so the allocator can pack them into its densest pages. The scheduler caps
+  * each run at defrag_cpu_pct of DEFRAG_INTERVAL, the lock is released every
+  * LOCK_SLICE, and the run stops early when client requests are waiting.
+  * When the cursor wraps, free pages are handed back to the OS.
+  * 
+  * @note Runs on the maintenance scheduler; takes mtx per slice
+  */
+ bool StorageEngine::defrag_step(MaintenanceScheduler::Clock::time_point deadline) {
+     using clock = MaintenanceScheduler::Clock;
+ 
+     if (!defrag.in_cycle) {
+         size_t rss = sampled_rss;
+         size_t allocated = sampled_allocated;
+         if (allocated == 0 || rss <= allocated) return false;
+         size_t wasted = rss - allocated;
+         // Waste a previous cycle could not reclaim (code, stacks, allocator
+         // metadata) does not count, otherwise cycles would repeat forever
+         defrag.settled_waste = std::min(defrag.settled_waste, wasted);
+         if (wasted < defrag.settled_waste + defrag.ignore_bytes ||
+             wasted * 100 < allocated * defrag.threshold_pct) return false;
+         defrag.in_cycle = true;
+         defrag.cursor = 0;
+     }
+ 
+     bool finished = false;
+     while (!finished && clock::now() < deadline && !under_pressure()) {
+         std::lock_guard<std::mutex> lock(mtx);
+         const auto slice_end = std::min(deadline, clock::now() + LOCK_SLICE);
+         do {
+             for (int i = 0; i < 16 && !finished; ++i) {
+                 defrag.cursor = store.defrag(defrag.cursor, [this](Entry& entry) {
+                     // One relocation per entry: its node and key were moved by
+                     // the table; only heap buffers move here, integers and short
+                     // values are inline
+                     defrag.relocations++;
+                     if (entry.value.has_heap_buffer()) {
+                         CompactString relocated(entry.value);
+                         entry.value.swap(relocated);
+                     }
+                 });
+                 finished = defrag.cursor == 0;
+             }
+         } while (!finished && clock::now() < slice_end);
+ 
+         if (finished) {
+             defrag.in_cycle = false;
+             defrag.cycles++;
+         }
+     }
+ 
+     // Trim outside the lock: walking the heap can take milliseconds
+     if (finished) {
+         MemoryStats::release_free_memory();
+         sample_memory();
+         size_t rss = sampled_rss;
+         size_t allocated = sampled_allocated;
+         defrag.settled_waste = rss > allocated ? rss - allocated : 0;
+     }
+     return !finished;
+ }
+ 
+ /**
+  * @brief Remove an entry together with its bookkeeping
+  * @param key Key to remove
+  * @param lazy Queue large values on the lazy-free thread
+  * @return true If the key existed and was removed
+  * 
+  * @details Single removal path shared by DEL, UNLINK, eviction and expiry so
+  * that memory accounting, eviction tracking and the ordered index stay
+  * consistent. A lazily freed value leaves current_memory immediately and is
+  * counted by the lazy-free queue until its buffer is released. A key found
+  * only in the frozen tier is tombstoned there. Either way the key leaves
+  * the tag index.
+  * 
+  * @note Caller must hold mtx
+  */
+ bool StorageEngine::remove_entry(const std::string& key, bool lazy) {
+     const CompactString lookup = CompactString::borrow(key);
+     Entry* entry = store.find(lookup);
+     if (!entry) {
+         if (!frozen.erase(key)) {
+             end_lease(key); // Deleting a missing key still cancels a pending reload
+             return false;
+         }
+         touch(key);
+         retag(key, nullptr);
+         if (ordered_index) ordered_index->erase(key);
+         return true;
+     }
+ 
+     current_memory -= entry_bytes(key.size(), entry->value);
+     size_t bytes = release_value(entry->value);
+     if (lazy && bytes >= lazyfree_min_bytes) {
+         lazy_free.free_later(std::move(entry->value), bytes);
+     }
+     store.remove(lookup);
+     touch(key);
+     retag(key, nullptr);
+     end_lease(key);
+     mem_manager.forget(key);
+     if (ordered_index) ordered_index->erase(key);
+     return true;
+ }
+ 
+ /**
+  * @brief Remove an expired key, keeping its value for the lease grace period
+  * @param key Expired key
+  * @param lazy Free the value on the lazy-free thread
+  * @return true If the key was removed
+  * 
+  * @details With lease_grace set, the value is copied out (plainly encoded,
+  * charged to current_memory) before removal and queued for dropping once
+  * the grace period ends, so GETL can serve it while a lease holder reloads.
+  * 
+  * @note Caller must hold mtx
+  */
+ bool StorageEngine::expire_entry(const std::string& key, bool lazy) {
+     std::string last;
+     if (lease_grace > 0) {
+         const Entry* entry = store.find(CompactString::borrow(key));
+         if (entry) last = entry->value.str();
+     }
+     if (!remove_entry(key, lazy)) return false;
+     if (lease_grace > 0) {
+         uint32_t until = coarse_now() + lease_grace;
+         current_memory += key.size() + last.size();
+         stale_values[key] = StaleValue{CompactString(last), until};
+         stale_order.emplace_back(until, key);
+     }
+     return true;
+ }
+ 
+ /**
+  * @brief Drop the lease and the stale value of a key
+  * @param key Key written or removed
+  * 
+  * @details Called on every write and removal, so a lease never outlives a
+  * change of the key and a stale value never hides a newer one.
+  * 
+  * @note Caller must hold mtx
+  */
+ void StorageEngine::end_lease(const std::string& key) {
+     if (!leases.empty() && leases.erase(key)) current_memory -= lease_bytes(key);
+     if (stale_values.empty()) return;
+     auto kept = stale_values.find(key);
+     if (kept == stale_values.end()) return;
+     current_memory -= key.size() + kept->second.value.size();
+     stale_values.erase(kept);
+ }
+ 
+ /**
+  * @brief Drop stale values past their grace period and timed-out leases
+  * @param now Coarse clock
+  * 
+  * @details Stale values and leases are queued in drop order, so this pops
+  * from the fronts; an entry whose key was rewritten, expired again or leased
+  * again since is skipped.
+  * 
+  * @note Caller must hold mtx
+  */
+ void StorageEngine::drop_expired_leases(uint32_t now) {
+     while (!stale_order.empty() && now > stale_order.front().first) {
+         auto kept = stale_values.find(stale_order.front().second);
+         if (kept != stale_values.end() && kept->second.until == stale_order.front().first) {
+             current_memory -= kept->first.size() + kept->second.value.size();
+             stale_values.erase(kept);
+         }
+         stale_order.pop_front();
+     }
+     while (!lease_order.empty() && now > lease_order.front().first) {
+         auto lease = leases.find(lease_order.front().second);
+         if (lease != leases.end() && lease->second.expires_at == lease_order.front().first) {
+             current_memory -= lease_bytes(lease->first);
+             leases.erase(lease);
+         }
+         lease_order.pop_front();
+     }
+ }
+ 
+ /**
+  * @brief Write a value into a looked-up entry, or insert a new one
+  * @param key Key being written
+  * @param lookup Borrowed encoding of key
+  * @param entry Existing entry for key, or nullptr
+  * @param value Value to store
+  * @param ttl Time-to-live in seconds
+  * @param keep_ttl Keep the existing entry's expiry (commands that rewrite a
+  *        value rather than replace it, e.g. PFADD)
+  * @param extra Bytes the caller charges right after the write (the tag
+  *        index growth of SET ... TAGS), checked against max_memory with it
+  * @return uint64_t New version, or 0 if the write does not fit
+  * 
+  * @details Shared by SET and SET ... IFVERSION:
+  * - Evicts according to the configured policy only if the write would
+  *   exceed max_memory (the hard limit), then repeats the lookup since the
+  *   policy may have picked this very key
+  * - Overwrites an existing entry in place, otherwise inserts a new one,
+  *   adds the key to the ordered index and drops a frozen copy of the key
+  * - Shares the value with identical ones when deduplication is enabled;
+  *   the old value is released first, so overwriting a shared value never
+  *   touches the other keys (copy-on-write)
+  * - Stamps the entry with the next version, notifies WATCH and eviction
+  *   tracking, and wakes the background evictor above the high watermark
+  * 
+  * @note Caller must hold mtx
+  */
+ uint64_t StorageEngine::write_entry(const std::string& key, const CompactString& lookup, Entry* entry,
+                                     const std::string& value, std::chrono::seconds ttl, bool keep_ttl,
+                                     size_t extra) {
+     size_t incoming = key.size() + value.size() + extra;
+     size_t replaced = entry ? entry_bytes(key.size(), entry->value) : 0;
+     if (current_memory.total() + lazy_free.pending_bytes() - replaced + incoming > max_memory) {
+         if (!enforce_memory_limits(key, incoming)) return 0;
+         entry = store.find(lookup);
+     }
+ 
+     Entry fresh{intern(value), ++version_clock, keep_ttl && entry ? entry->expires_at : expiry_after(ttl)};
+     uint64_t version = fresh.version;
+     MemoryManager::TimePoint expires_at{};
+     bool has_ttl = entry_expiry(fresh, expires_at);
+ 
+     size_t charged = entry_bytes(key.size(), fresh.value);
+     if (entry) {
+         current_memory -= entry_bytes(key.size(), entry->value);
+         release_value(entry->value);
+         *entry = std::move(fresh);
+     } else {
+         store.insert(lookup, std::move(fresh));
+         frozen.erase(key);
+         if (ordered_index) ordered_index->insert(key);
+     }
+     current_memory += charged;
+     touch(key);
+     end_lease(key);
+     wake_evictor();
+ 
+     mem_manager.record_write(key, has_ttl, expires_at);
+     return version;
+ }
+ 
+ /**
+  * @brief Encode a value, deduplicating it against identical stored values
+  * @param value Value being written
+  * @return CompactString Shared reference, or the plain encoding
+  * 
+  * @details Values of at least dedup_min_bytes are looked up by content in
+  * dedup_table. A hit returns another reference to the existing buffer; a
+  * miss creates a shared buffer, registers it and charges its bytes to
+  * current_memory once for all the keys that will share it.
+  * 
+  * @note Caller must hold mtx
+  */
+ CompactString StorageEngine::intern(const std::string& value) {
+     if (dedup_min_bytes == 0 || value.size() < dedup_min_bytes) return CompactString(value);
+ 
+     auto it = dedup_table.find(value);
+     if (it != dedup_table.end()) {
+         dedup_saved_bytes += value.size();
+         return it->second;
+     }
+     CompactString shared = CompactString::share(value);
+     dedup_table.emplace(shared.heap_view(), shared);
+     current_memory += value.size();
+     return shared;
+ }
+ 
+ /**
+  * @brief Release an entry's reference to its value
+  * @param value Value about to be overwritten or removed
+  * @return size_t Bytes freed when the caller destroys the value
+  * 
+  * @details For a shared value still used by other keys, only the savings
+  * counter changes. When the caller holds the last key reference, the table's
+  * reference is dropped and the buffer's bytes leave current_memory; the
+  * caller's copy then owns the buffer and frees it (possibly lazily).
+  * 
+  * @note Caller must hold mtx
+  */
+ size_t StorageEngine::release_value(const CompactString& value) {
+     if (!value.is_shared()) return value.size();
+ 
+     size_t size = value.size();
+     if (value.share_count() > 2) {
+         dedup_saved_bytes -= size;
+         return 0;
+     }
+     dedup_table.erase(value.heap_view());
+     current_memory -= size;
+     return size;
+ }
+ 
+ /**
+  * @brief Wake the evict task when memory crosses the high watermark
+  * 
+  * @details Only the first crossing of a round triggers the task; evict_step
+  * clears the flag once memory is back at the low watermark
+  * 
+  * @note Caller must hold mtx
+  */
+ void StorageEngine::wake_evictor() {
+     if (!evicting && current_memory.total() > high_watermark &&
+         mem_manager.get_policy() != EvictionPolicy::NOEVICTION) {
+         evicting = true;
+         maintenance.trigger(evict_task);
+     }
+ }
+ 
+ /**
+  * @brief Throw unless the ordered index is enabled
+  * @throws std::logic_error If the engine was built without ordered_index
+  */
+ void StorageEngine::require_ordered_index() const {
+     if (!ordered_index) {
+         throw std::logic_error("ordered index is disabled");
+     }
+ }
+ 
+ /**
+  * @brief Evict keys until an incoming write fits in max_memory
+  * @param key Key about to be written
+  * @param incoming Bytes the write will add (key plus new value)
+  * @return true If the write fits
+  * @return false If the write is larger than max_memory or the policy has no
+  *         victims left (noeviction, or volatile policies without TTL keys)
+  * 
+  * @details The bytes of the value being overwritten are credited first, and
+  * values still waiting on the lazy-free thread are counted as used, so keys
+  * are evicted until the write fits with that backlog included. Once the
+  * policy has no victims left the backlog is counted as already freed (it
+  * is detached and on its way out): the thread is never waited on under
+  * mtx, which would stall every client. If the policy picks the key being
+  * written it is evicted like any other key and then rewritten by the caller.
+  * When keyspaces share max_memory their total is what must fit, and
+  * victims come from any of them (see evict_one()).
+  * 
+  * @note Called automatically during SET operations; caller must hold mtx
+  */
+ bool StorageEngine::enforce_memory_limits(const std::string& key, size_t incoming) {
+     if (incoming > max_memory) return false;
+ 
+     const CompactString lookup = CompactString::borrow(key);
+     auto replaced = [&]() -> size_t {
+         const Entry* old_entry = store.find(lookup);
+         return old_entry ? entry_bytes(key.size(), old_entry->value) : 0;
+     };
+ 
+     while (current_memory.total() + lazy_free.pending_bytes() - replaced() + incoming > max_memory) {
+         if (!evict_one(true)) return current_memory.total() - replaced() + incoming <= max_memory;
+     }
+     return true;
+ }
+ 
+ /**
+  * @brief Evict one key to bring memory down
+  * @param sync Evicted for a write that must fit (counted in evicted_keys_sync)
+  * @return true If a key was evicted
+  * @return false If no engine had a victim under its policy
+  * 
+  * @details Alone, this is the policy's pick. With a shared budget the
+  * victim comes from the member holding the most bytes that has one, so
+  * filling a small keyspace neither evicts its own fresh keys nor fails
+  * under a volatile policy while another keyspace holds the memory. Other
+  * members are only try-locked (engines have no lock order between them)
+  * and skipped while another thread holds them.
+  * 
+  * @note Caller must hold mtx
+  */
+ bool StorageEngine::evict_one(bool sync) {
+     SharedMemory* budget = current_memory.budget();
+     if (!budget) return evict_own(sync);
+ 
+     std::lock_guard<std::mutex> registry(budget->mtx);
+     std::vector<std::unique_lock<std::mutex>> locks;
+     std::vector<StorageEngine*> members;
+     for (StorageEngine* member : budget->engines) {
+         // This engine, or another the calling thread holds through a Batch
+         if (member != this && member->batch_owner != std::this_thread::get_id()) {
+             std::unique_lock<std::mutex> lock(member->mtx, std::try_to_lock);
+             if (!lock.owns_lock()) continue;
+             locks.push_back(std::move(lock));
+         }
+         members.push_back(member);
+     }
+     std::sort(members.begin(), members.end(), [](const StorageEngine* a, const StorageEngine* b) {
+         return a->current_memory > b->current_memory;
+     });
+     for (StorageEngine* member : members) {
+         if (member->evict_own(sync)) return true;
+     }
+     return false;
+ }
+ 
+ /**
+  * @brief Evict this engine's policy victim
+  * @param sync Evicted for a write that must fit (counted in evicted_keys_sync)
+  * @return true If the policy had a victim
+  * 
+  * @note Caller must hold mtx
+  */
+ bool StorageEngine::evict_own(bool sync) {
+     std::string victim;
+     if (!mem_manager.select_victim(victim)) return false;
+     remove_entry(victim, lazy_evict);
+     evicted_keys++;
+     if (sync) evicted_keys_sync++;
+     return true;
+ }
+ 
+ /**
+  * @brief Report whether an entry carries a TTL and when it expires
+  * @param entry Entry to inspect
+  * @param[out] expires_at Wall-clock time of expires_at if the entry has a TTL
+  * @return true If the entry has a TTL
+  */
+ bool StorageEngine::entry_expiry(const Entry& entry, MemoryManager::TimePoint& expires_at) const {
+     if (entry.expires_at == 0) return false;
+     expires_at = clock_wall_start + std::chrono::seconds(entry.expires_at - 1);
+     return true;
+ }
+ 
+ /**
+  * @brief Convert a TTL into an entry expiry
+  * @param ttl Time-to-live, seconds::max() for none
+  * @return uint32_t Coarse-clock expiry second, 0 for no expiry
+  * 
+  * @details The entry expires once the coarse clock moves past the returned
+  * second, so it lives at least ttl and at most ttl plus one second and one
+  * clock tick. Expiries beyond the clock's range saturate.
+  */
+ uint32_t StorageEngine::expiry_after(std::chrono::seconds ttl) const {
+     if (ttl == std::chrono::seconds::max()) return 0;
+     int64_t at = static_cast<int64_t>(coarse_now()) + std::max<int64_t>(ttl.count(), 0);
+     return static_cast<uint32_t>(std::min<int64_t>(at, UINT32_MAX));
+ }
+ 
+ /**
+  * @brief Advance the coarse clock
+  * @return bool Always false
+  * 
+  * @details Derives the second from steady_clock, so wall-clock adjustments
+  * never expire keys early or late.
+  * 
+  * @note Runs on the maintenance scheduler every CLOCK_TICK, without mtx
+  */
+ bool StorageEngine::tick_clock() {
+     auto elapsed = std::chrono::steady_clock::now() - clock_start;
+     auto seconds = std::chrono::duration_cast<std::chrono::seconds>(elapsed).count();
+     clock_seconds.store(static_cast<uint32_t>(seconds + 1), std::memory_order_relaxed);
+     return false;
+ }
+ 
+ /**
+  * @brief Sweep part of the keyspace for expired entries
+  * @param deadline Time by which the sweep must return
+  * @return true If more than a quarter of the sampled entries had expired
+  * 
+  * @details Walks buckets from expire_cursor in slices of at most LOCK_SLICE,
+  * removing expired entries as it goes. The run ends at the deadline, when a
+  * full sweep completes, or when client requests are waiting. A high expired
+  * ratio tells the scheduler to run the task more often.
+  * 
+  * @note Runs on the maintenance scheduler; takes mtx per slice
+  */
+ bool StorageEngine::expire_step(MaintenanceScheduler::Clock::time_point deadline) {
+     using clock = MaintenanceScheduler::Clock;
+     size_t sampled = 0;
+     size_t expired = 0;
+     bool wrapped = false;
+     std::vector<std::string> keys_to_remove;
+ 
+     while (!wrapped && clock::now() < deadline && !under_pressure()) {
+         std::lock_guard<std::mutex> lock(mtx);
+         const auto slice_end = std::min(deadline, clock::now() + LOCK_SLICE);
+         const uint32_t now = coarse_now();
+         drop_expired_leases(now);
+         do {
+             for (int i = 0; i < 16 && !wrapped; ++i) {
+                 expire_cursor = store.scan(expire_cursor, [&](const CompactString& key, const Entry& entry) {
+                     sampled++;
+                     if (is_expired(entry, now)) {
+                         keys_to_remove.push_back(key.str());
+                     }
+                 });
+                 wrapped = expire_cursor == 0;
+             }
+ 
+             // Remove after visiting: the scan callback must not modify the table
+             for (const auto& key : keys_to_remove) {
+                 if (expire_entry(key, lazy_evict)) {
+                     expired++;
+                     expired_keys++;
+                 }
+             }
+             keys_to_remove.clear();
+         } while (!wrapped && clock::now() < slice_end);
+     }
+ 
+     return expired * 4 > sampled;
+ }
+ 
+ /**
+  * @brief Evict keys from above the high watermark down to the low one
+  * @param deadline Time by which the task must return
+  * @return true If an eviction round is still in progress
+  * 
+  * @details A round starts when memory exceeds high_watermark (SET triggers
+  * the task at that point) and continues across runs until memory is at or
+  * below low_watermark, so writers stay clear of the hard limit without
+  * paying for eviction themselves. Values queued for lazy freeing are not
+  * counted here, otherwise evicting with --lazyfree would never look like
+  * progress until the free thread caught up. With a shared budget the
+  * watermarks apply to the total of all keyspaces, and the victims come
+  * from the largest keyspaces first (evict_one()).
+  * 
+  * @note Runs on the maintenance scheduler; takes mtx per slice
+  */
+ bool StorageEngine::evict_step(MaintenanceScheduler::Clock::time_point deadline) {
+     using clock = MaintenanceScheduler::Clock;
+ 
+     while (clock::now() < deadline && !under_pressure()) {
+         std::lock_guard<std::mutex> lock(mtx);
+         if (!evicting) evicting = current_memory.total() > high_watermark;
+         if (!evicting) return false;
+ 
+         const auto slice_end = std::min(deadline, clock::now() + LOCK_SLICE);
+         do {
+             if (current_memory.total() <= low_watermark) {
+                 evicting = false;
+                 return false;
+             }
+             // Nothing evictable yet (e.g. no TTL keys); retry on the idle interval
+             if (!evict_one(false)) return false;
+         } while (clock::now() < slice_end);
+     }
+     return true;
+ }
+ 
+ /**
+  * @brief Advance an in-progress incremental hash table resize
+  * @param deadline Time by which the task must return
+  * @return true If buckets remain to be rehashed
+  * 
+  * @details Inserts and removes rehash a couple of buckets each, which is
+  * enough to finish before the next resize but leaves a shrink stranded when
+  * traffic stops; this task finishes resizes in 64-bucket steps and keeps
+  * halving a sparse table that no longer sees removes.
+  * 
+  * @note Runs on the maintenance scheduler; takes mtx per slice
+  */
+ bool StorageEngine::rehash_step(MaintenanceScheduler::Clock::time_point deadline) {
+     using clock = MaintenanceScheduler::Clock;
+     bool pending = true;
+ 
+     while (pending && clock::now() < deadline && !under_pressure()) {
+         std::lock_guard<std::mutex> lock(mtx);
+         const auto slice_end = std::min(deadline, clock::now() + LOCK_SLICE);
+         do {
+             store.shrink_if_sparse();
+             pending = store.rehash_step(64);
+         } while (pending && clock::now() < slice_end);
+     }
+     return pending;
+ }
+ 
+ /**
+  * @brief Refresh the sampled RSS and allocator statistics
+  * @return false Always; sampling never accumulates a backlog
+  * 
+  * @details Reads /proc and the allocator without taking mtx
+  */
+ bool StorageEngine::sample_memory() {
+     sampled_rss = MemoryStats::process_rss_bytes();
+     sampled_allocated = MemoryStats::allocator_bytes_in_use();
+     return false;
+ }
+ 
+ /**
+  * @brief Fit max_memory and the watermarks to the cgroup
+  * @return false Always; each sample is complete
+  * 
+  * @details The cgroup limit is the lower of memory.max (the OOM kill line)
+  * and memory.high (the throttling line). The cache may grow until the
+  * cgroup's working set (memory.current minus inactive_file, which the
+  * kernel reclaims before killing anything) reaches cgroup_memory_pct of
+  * it, so the new max_memory is that budget minus what the rest of the
+  * cgroup uses. "The rest" is everything not counted in current_memory:
+  * allocator and table overhead of this engine, other keyspaces and other
+  * processes of the pod; the limit therefore settles where the whole
+  * cgroup fits, and several engines sharing a cgroup split it between them.
+  * 
+  * Memory pressure (PSI "some avg10") adds a back-off on top: each sample
+  * at or above PSI_HIGH takes 10% off the derived limit (down to
+  * SCALE_MIN) and moves the low watermark down by half as much, so
+  * eviction both starts earlier and goes deeper per round, and returns
+  * freed pages to the kernel; each sample below PSI_LOW gives back 5%.
+  * The result never exceeds the configured max_memory and never drops
+  * below CGROUP_MIN_MEMORY. Changes under 1% are ignored so allocator
+  * noise does not move the limit every second.
+  * 
+  * @note Runs on the maintenance scheduler; takes mtx to apply the limit
+  */
+ bool StorageEngine::cgroup_step() {
+     size_t limit = 0, high = 0, current = 0;
+     MemoryStats::cgroup_value(cgroup.dir, "memory.max", limit);
+     if (MemoryStats::cgroup_value(cgroup.dir, "memory.high", high) && (limit == 0 || high < limit)) {
+         limit = high;
+     }
+     MemoryStats::cgroup_value(cgroup.dir, "memory.current", current);
+     size_t inactive = MemoryStats::cgroup_memory_stat(cgroup.dir, "inactive_file");
+     size_t working_set = current > inactive ? current - inactive : 0;
+     double pressure = MemoryStats::cgroup_memory_pressure(cgroup.dir);
+ 
+     bool backing_off;
+     {
+         std::lock_guard<std::mutex> lock(mtx);
+         cgroup.limit = limit;
+         cgroup.working_set = working_set;
+         cgroup.pressure = std::max(pressure, 0.0);
+         backing_off = pressure >= PSI_HIGH;
+         if (backing_off) {
+             cgroup.scale_pct = std::max(SCALE_MIN, cgroup.scale_pct - 10);
+         } else if (pressure >= 0 && pressure < PSI_LOW) {
+             cgroup.scale_pct = std::min(100u, cgroup.scale_pct + 5);
+         }
+ 
+         size_t target = cgroup.ceiling;
+         if (limit > 0) {
+             size_t used = current_memory.total() + lazy_free.pending_bytes();
+             size_t others = working_set > used ? working_set - used : 0;
+             size_t budget = limit / 100 * cgroup.pct;
+             target = std::min(target, budget > others ? budget - others : 0);
+         }
+         target = std::max(target / 100 * cgroup.scale_pct, std::min(CGROUP_MIN_MEMORY, cgroup.ceiling));
+         unsigned low_pct = evict_low_pct - std::min(evict_low_pct, (100 - cgroup.scale_pct) / 2);
+ 
+         size_t delta = target > max_memory ? target - max_memory : max_memory - target;
+         if (delta > max_memory / 100 || low_watermark != max_memory * low_pct / 100) {
+             apply_memory_limit(delta > max_memory / 100 ? target : max_memory, low_pct);
+             cgroup.adjustments++;
+             wake_evictor();
+         }
+     }
+     if (backing_off) MemoryStats::release_free_memory();
+     return false;
+ }
+ 
+ /**
+  * @brief Set max_memory and derive both watermarks from it
+  * @param bytes New limit
+  * @param low_pct Low watermark in % of the limit (clamped to the high one)
+  * 
+  * @note Caller must hold mtx
+  */
+ void StorageEngine::apply_memory_limit(size_t bytes, unsigned low_pct) {
+     max_memory = bytes;
+     high_watermark = max_memory * evict_high_pct / 100;
+     low_watermark = max_memory * std::min(low_pct, evict_high_pct) / 100;
  }
- 
\ No newline at end of file
@@ -4,24 +4,148 @@
  */
 
  #pragma once
+ #include <array>
+ #include <deque>
  #include <string>
  #include <mutex>
  #include <chrono>
  #include <thread>
  #include <atomic>
  #include <vector>
+ #include <memory>
+ #include <utility>
+ #include <unordered_map>
  #include "HashTable.h"
+ #include "CompactString.h"
  #include "MemoryManager.h"
+ #include "ArtIndex.h"
+ #include "Bitmap.h"
+ #include "HyperLogLog.h"
+ #include "BloomFilter.h"
+ #include "FrozenTier.h"
+ #include "DumpPayload.h"
+ #include "TagIndex.h"
+ #include "LazyFree.h"
+ #include "MaintenanceScheduler.h"
+ 
+ class StorageEngine;
+ 
+ /**
+  * @struct SharedMemory
+  * @brief One max_memory budget for several engines (the keyspaces of a server)
+  * 
+  * @details Every member charges its bytes to used, and is listed in engines
+  * while it is alive so that a member over the budget can evict from the
+  * others.
+  */
+ struct SharedMemory {
+     std::atomic<size_t> used{0}; ///< Bytes charged by all members
+     std::mutex mtx; ///< Guards engines
+     std::vector<StorageEngine*> engines; ///< Live members
+ };
+ 
+ /**
+  * @struct EngineConfig
+  * @brief Startup options for a StorageEngine instance
+  */
+ struct EngineConfig {
+     size_t max_memory = 1024 * 1024 * 1024; ///< Maximum allowed memory in bytes (1GB default)
+     bool ordered_index = false; ///< Maintain an ordered key index for prefix/range queries
+     bool active_defrag = false; ///< Run the incremental background defragmenter
+     unsigned defrag_threshold_pct = 10; ///< Start a defrag cycle above this % of wasted RSS
+     size_t defrag_ignore_bytes = 100 * 1024 * 1024; ///< Never defrag when less than this is wasted
+     unsigned defrag_cpu_pct = 10; ///< Share of background thread time a defrag cycle may use
+     HugePageMode huge_pages = HugePageMode::OFF; ///< Page backing of the hash table bucket array
+     EvictionPolicy eviction_policy = EvictionPolicy::ALLKEYS_LRU; ///< Victim selection above max_memory
+     unsigned lfu_decay_minutes = 1; ///< Idle minutes that take one access off an allkeys-lfu count (0 = no decay)
+     bool lazy_free = false; ///< Free evicted and expired values on the lazy-free thread
+     size_t lazyfree_min_bytes = 4096; ///< Smaller values are freed inline (queueing costs as much)
+     bool dedup = false; ///< Store identical values once, shared between keys
+     size_t dedup_min_bytes = 64; ///< Shorter values are never deduplicated
+     size_t maintenance_budget_us = 1000; ///< Per-run budget of expiry, eviction and rehash tasks
+     unsigned evict_high_pct = 90; ///< Background eviction starts above this % of max_memory
+     unsigned evict_low_pct = 80; ///< Background eviction stops at this % of max_memory
+     unsigned lease_timeout_s = 10; ///< Lifetime of a GETL lease not yet fulfilled by its SET
+     unsigned lease_grace_s = 0; ///< Keep expired values this long to serve as stale (0 = off)
+     bool cgroup_memory = false; ///< Derive the effective max_memory from cgroup v2 limits and pressure
+     unsigned cgroup_memory_pct = 80; ///< Share of the cgroup limit the cache may bring the cgroup to
+     std::string cgroup_dir; ///< cgroup directory to follow (empty: this process's own cgroup)
+     std::shared_ptr<SharedMemory> shared_memory; ///< Budget shared with other engines (null: this engine alone)
+ };
+ 
+ /**
+  * @enum IncrStatus
+  * @brief Outcome of an atomic counter update
+  */
+ enum class IncrStatus {
+     OK,           ///< Counter updated
+     NOT_INTEGER,  ///< Stored value is not a canonical 64-bit integer
+     OUT_OF_RANGE, ///< Result would not fit in 64 bits
+     OOM           ///< Does not fit in max_memory under the eviction policy
+ };
+ 
+ /**
+  * @enum CasStatus
+  * @brief Outcome of a versioned (IFVERSION) write or delete
+  */
+ enum class CasStatus {
+     OK,       ///< Applied
+     MISMATCH, ///< Stored version differs from the expected one; nothing changed
+     OOM       ///< Does not fit in max_memory under the eviction policy
+ };
+ 
+ /**
+  * @enum LeaseStatus
+  * @brief Outcome of a lease-based read (GETL)
+  */
+ enum class LeaseStatus {
+     HIT,     ///< Key present, value returned
+     GRANTED, ///< Key missing; the caller holds the lease and should fill it
+     WAIT     ///< Key missing and another caller holds the lease
+ };
+ 
+ /**
+  * @enum RestoreStatus
+  * @brief Outcome of RESTORE / MRESTORE
+  */
+ enum class RestoreStatus {
+     OK,          ///< Every key installed
+     BAD_PAYLOAD, ///< Unknown format version, wrong checksum or malformed record; nothing changed
+     BUSY_KEY,    ///< A target key exists and REPLACE was not given; nothing changed
+     OOM          ///< Does not fit in max_memory under the eviction policy
+ };
+ 
+ /**
+  * @enum HllStatus
+  * @brief Outcome of a HyperLogLog command
+  */
+ enum class HllStatus {
+     OK,        ///< Done
+     WRONGTYPE, ///< A key holds a value that is not a HyperLogLog sketch; nothing changed
+     OOM        ///< Does not fit in max_memory under the eviction policy
+ };
+ 
+ /**
+  * @enum BloomStatus
+  * @brief Outcome of a Bloom filter command
+  */
+ enum class BloomStatus {
+     OK,        ///< Done
+     EXISTS,    ///< BF.RESERVE on a key that already exists; nothing changed
+     WRONGTYPE, ///< The key holds a value that is not a Bloom filter; nothing changed
+     OOM        ///< Does not fit in max_memory under the eviction policy
+ };
  
  /**
   * @class StorageEngine
-  * @brief In-memory key-value store with LRU eviction and TTL expiration
+  * @brief In-memory key-value store with configurable eviction and TTL expiration
   * 
   * @details Implements CRUD operations using custom HashTable and MemoryManager.
   * Designed for Part 1 of DESIGN_LAB_PROJECT.pdf specifications with:
   * - O(1) average case performance
   * - Thread-safe operations
-  * - Background TTL eviction thread
+  * - Background maintenance (expiry, eviction, rehash, defrag, stats) on a
+  *   time-budgeted scheduler
   */
  class StorageEngine {
  private:
@@ -30,42 +154,277 @@
       * @brief Metadata for stored values
       */
      struct Entry {
-         std::string value; ///< User-supplied data
-         std::chrono::seconds ttl; ///< Time-to-live (default: max seconds)
-         std::chrono::system_clock::time_point last_accessed; ///< LRU tracking timestamp
+         CompactString value; ///< User-supplied data (integers and short values inline)
+         uint64_t version; ///< Engine-wide write sequence number of the last write
+         uint32_t expires_at; ///< Coarse-clock second after which the entry is gone (0 = never)
      };
  
-     HashTable<std::string, Entry> store; ///< Custom hash table for core storage
-     MemoryManager mem_manager; ///< LRU eviction policy manager
-     size_t current_memory = 0; ///< Current memory usage in bytes
+     /**
+      * @class MemoryCounter
+      * @brief Bytes charged to this engine, mirrored into a shared budget
+      * 
+      * @details Reads as a size_t. When engines share max_memory (the
+      * keyspaces of one server), every change is also applied to their
+      * common total, and an engine's remaining bytes leave the total when it
+      * is destroyed. O(1) per update: one relaxed atomic add.
+      */
+     class MemoryCounter {
+     private:
+         size_t bytes = 0; ///< This engine's bytes
+         std::shared_ptr<SharedMemory> shared; ///< Budget of every sharing engine (null: none)
+ 
+     public:
+         ~MemoryCounter() {
+             if (shared) shared->used.fetch_sub(bytes, std::memory_order_relaxed);
+         }
+         void share(std::shared_ptr<SharedMemory> budget) { shared = std::move(budget); }
+         operator size_t() const { return bytes; }
+         MemoryCounter& operator+=(size_t n) {
+             bytes += n;
+             if (shared) shared->used.fetch_add(n, std::memory_order_relaxed);
+             return *this;
+         }
+         MemoryCounter& operator-=(size_t n) {
+             bytes -= n;
+             if (shared) shared->used.fetch_sub(n, std::memory_order_relaxed);
+             return *this;
+         }
+         MemoryCounter& operator=(size_t n) {
+             if (n >= bytes) return *this += n - bytes;
+             return *this -= bytes - n;
+         }
+         /**
+          * @brief Bytes counted against max_memory: the shared total, or this engine's
+          */
+         size_t total() const { return shared ? shared->used.load(std::memory_order_relaxed) : bytes; }
+         bool is_shared() const { return shared != nullptr; }
+         SharedMemory* budget() const { return shared.get(); }
+     };
+ 
+     HashTable<CompactString, Entry> store; ///< Custom hash table for core storage
+     std::unordered_map<std::string_view, CompactString> dedup_table; ///< Content -> shared value
+     size_t dedup_min_bytes = 0; ///< Values at least this long are deduplicated (0 = off)
+     size_t dedup_saved_bytes = 0; ///< Bytes not stored thanks to sharing
+     MemoryManager mem_manager; ///< Eviction policy manager
+     LazyFree lazy_free; ///< Background reclamation of unlinked values
+     bool lazy_evict = false; ///< Eviction and expiry go through lazy_free
+     size_t lazyfree_min_bytes = 4096; ///< Values below this size are always freed inline
+     std::unique_ptr<ArtIndex> ordered_index; ///< Optional ordered key index (null when disabled)
+     FrozenTier frozen; ///< Immutable tier of keys moved there by FREEZE
+     TagIndex tag_index; ///< Tags given to keys by SET ... TAGS
+ 
+     /**
+      * @struct Lease
+      * @brief Right to fill a missing key, granted by GETL
+      */
+     struct Lease {
+         uint64_t token; ///< Token the holder presents with SET ... LEASE
+         uint32_t expires_at; ///< Coarse-clock second after which the lease can be granted again
+     };
+ 
+     /**
+      * @struct StaleValue
+      * @brief Value of an expired key, kept for the lease grace period
+      */
+     struct StaleValue {
+         CompactString value; ///< Last value of the key
+         uint32_t until; ///< Coarse-clock second after which it is dropped
+     };
+     std::unordered_map<std::string, Lease> leases; ///< Outstanding leases of missing keys (charged to current_memory)
+     std::deque<std::pair<uint32_t, std::string>> lease_order; ///< Leases by expiry time
+     std::unordered_map<std::string, StaleValue> stale_values; ///< Recently expired values
+     std::deque<std::pair<uint32_t, std::string>> stale_order; ///< Stale values by drop time
+     uint32_t lease_timeout = 10; ///< Seconds a lease stays valid
+     uint32_t lease_grace = 0; ///< Seconds expired values are kept (0 = never)
+     size_t lease_grants = 0; ///< Leases granted
+     size_t lease_waits = 0; ///< GETL misses answered with WAIT
+     size_t lease_rejected = 0; ///< SET ... LEASE refused for lack of a valid lease
+     uint64_t frozen_version = 0; ///< Version reported for every frozen key
+     uint64_t frozen_generation = 0; ///< Number of times FREEZE installed a new tier
+     uint64_t version_clock = 0; ///< Last version handed out (versions start at 1)
+     const std::chrono::steady_clock::time_point clock_start = std::chrono::steady_clock::now(); ///< Coarse clock epoch
+     const std::chrono::system_clock::time_point clock_wall_start = std::chrono::system_clock::now(); ///< Wall time at the epoch
+     std::atomic<uint32_t> clock_seconds{1}; ///< Coarse clock: whole seconds since the epoch plus one
+     MemoryCounter current_memory; ///< Current memory usage in bytes
      size_t max_memory; ///< Maximum allowed memory (1GB default)
+     size_t evicted_keys = 0; ///< Keys removed to stay under max_memory
+     size_t evicted_keys_sync = 0; ///< Of those, keys SET had to evict itself
+     size_t high_watermark; ///< Background eviction starts above this many bytes
+     size_t low_watermark; ///< Background eviction evicts down to this many bytes
+     bool evicting = false; ///< Background eviction is between the high and low marks
+     size_t evict_task = 0; ///< Scheduler id of the evict task
+     size_t expired_keys = 0; ///< Keys removed by the expiry task
+     size_t expire_cursor = 0; ///< Bucket cursor of the incremental expiry sweep
      std::mutex mtx; ///< Mutex for thread safety
-     std::thread eviction_thread; ///< Background TTL eviction thread
-     std::atomic<bool> running{true}; ///< Control flag for eviction thread
  
      /**
-      * @brief Start background eviction daemon
-      * @details Runs evict_expired() every second in separate thread
+      * @struct WatchSlot
+      * @brief Registry entry of a key watched by at least one client
       */
-     void start_eviction_daemon() {
-         eviction_thread = std::thread([this] {
-             while (running) {
-                 std::this_thread::sleep_for(std::chrono::seconds(1));
-                 evict_expired();
-             }
-         });
-     }
+     struct WatchSlot {
+         size_t watchers = 0; ///< Clients watching the key
+         uint64_t touches = 0; ///< Modifications since the key was first watched
+     };
+     std::unordered_map<std::string, WatchSlot> watched_keys; ///< Keys under WATCH
+     std::atomic<std::thread::id> batch_owner{}; ///< Thread holding mtx through a Batch
+ 
+     std::atomic<unsigned> foreground_waiters{0}; ///< Requests currently blocked on mtx
+     std::atomic<int64_t> last_contention_ns{0}; ///< steady_clock time a request last found mtx taken
+     std::atomic<size_t> sampled_rss{0}; ///< Process RSS from the last stats sample
+     std::atomic<size_t> sampled_allocated{0}; ///< Allocator bytes in use from the last stats sample
+     std::chrono::microseconds maintenance_budget{1000}; ///< Per-run budget of expire/evict/rehash
+     MaintenanceScheduler maintenance; ///< Runs all background work
+ 
+     /**
+      * @struct ForegroundLock
+      * @brief Lock taken by client requests, visible to background tasks
+      * 
+      * @details Tries the mutex first; if a background task holds it, records
+      * the contention and counts the request as waiting, which makes the
+      * maintenance scheduler and its tasks back off. Takes nothing when the
+      * calling thread already holds mtx through a Batch.
+      */
+     struct ForegroundLock {
+         std::unique_lock<std::mutex> lock; ///< Held engine mutex (unowned inside a Batch)
+         explicit ForegroundLock(StorageEngine& engine) {
+             if (engine.batch_owner == std::this_thread::get_id()) return;
+             lock = std::unique_lock<std::mutex>(engine.mtx, std::try_to_lock);
+             if (lock.owns_lock()) return;
+             engine.last_contention_ns = MaintenanceScheduler::Clock::now().time_since_epoch().count();
+             engine.foreground_waiters++;
+             lock.lock();
+             engine.foreground_waiters--;
+         }
+     };
+ 
+     /**
+      * @struct IncrRequest
+      * @brief One INCRBY, as applied by apply_increments()
+      */
+     struct IncrRequest {
+         const std::string* key = nullptr; ///< Counter key, owned by the caller
+         int64_t delta = 0; ///< Amount to add
+         int64_t result = 0; ///< New value when status is OK
+         IncrStatus status = IncrStatus::OK; ///< Outcome
+     };
+ 
+     /**
+      * @struct CombineSlot
+      * @brief Publication slot of a caller waiting for its increment
+      * 
+      * @details A caller claims a free slot, fills in its request and marks
+      * it pending. The thread holding mtx applies all pending requests and
+      * marks them done; the caller then reads its result and frees the slot.
+      * One cache line per slot, so callers do not share lines while waiting.
+      */
+     struct alignas(64) CombineSlot {
+         std::atomic<int> state{SLOT_FREE}; ///< SLOT_FREE, SLOT_CLAIMED, SLOT_PENDING or SLOT_DONE
+         IncrRequest request; ///< Written by the caller, completed by the combiner
+     };
+     enum : int { SLOT_FREE, SLOT_CLAIMED, SLOT_PENDING, SLOT_DONE };
+     static constexpr size_t COMBINE_SLOTS = 64; ///< Concurrent callers that can combine; others lock directly
+     static constexpr int COMBINE_SPINS = 64; ///< Polls of the slot and the lock before blocking
+     std::array<CombineSlot, COMBINE_SLOTS> combine_slots; ///< Pending increments of waiting callers
+     std::atomic<unsigned> combine_pending{0}; ///< Slots in SLOT_PENDING (skips the scan when 0)
+     size_t incr_batches = 0; ///< Combining passes that applied at least one increment
+     size_t incr_merged = 0; ///< Increments merged into another's write of the same key
+ 
+     /**
+      * @struct DefragState
+      * @brief Progress and counters of the active defragmenter
+      */
+     struct DefragState {
+         bool enabled = false; ///< Whether active defragmentation is configured
+         unsigned threshold_pct = 10; ///< Wasted-RSS percentage that starts a cycle
+         size_t ignore_bytes = 0; ///< Minimum wasted bytes before a cycle starts
+         unsigned cpu_pct = 10; ///< Share of each defrag interval a cycle may use
+         std::atomic<bool> in_cycle{false}; ///< A cycle is in progress (set outside mtx, read by stats())
+         size_t cursor = 0; ///< Bucket cursor of the current cycle
+         size_t settled_waste = 0; ///< Waste left after the last cycle (not recoverable by moving)
+         size_t cycles = 0; ///< Completed cycles
+         size_t relocations = 0; ///< Entries relocated so far
+     } defrag;
+ 
+     /**
+      * @struct CgroupState
+      * @brief Inputs and outcome of the cgroup memory task
+      */
+     struct CgroupState {
+         bool enabled = false; ///< cgroup_memory is on and a cgroup v2 directory was found
+         std::string dir; ///< cgroup directory read by the task
+         unsigned pct = 80; ///< Share of the limit the cgroup may reach
+         size_t ceiling = 0; ///< Configured max_memory, never exceeded
+         size_t limit = 0; ///< Lower of memory.max and memory.high (0 = unlimited)
+         size_t working_set = 0; ///< memory.current minus inactive_file at the last sample
+         double pressure = 0; ///< memory.pressure "some avg10" at the last sample, in percent
+         unsigned scale_pct = 100; ///< Pressure back-off applied to the derived limit
+         size_t adjustments = 0; ///< Changes of max_memory made by the task
+     } cgroup;
+     unsigned evict_high_pct = 90; ///< Configured high watermark, in % of max_memory
+     unsigned evict_low_pct = 80; ///< Configured low watermark, in % of max_memory
+ 
+     static constexpr std::chrono::milliseconds CGROUP_INTERVAL{1000}; ///< Period of cgroup samples
+     static constexpr size_t CGROUP_MIN_MEMORY = 16 * 1024 * 1024; ///< Floor of a cgroup-derived max_memory
+     static constexpr double PSI_HIGH = 10.0; ///< Memory stall % that makes the task back off
+     static constexpr double PSI_LOW = 1.0; ///< Memory stall % below which the back-off is undone
+     static constexpr unsigned SCALE_MIN = 50; ///< Deepest back-off, in % of the derived limit
+     static constexpr std::chrono::milliseconds DEFRAG_INTERVAL{100}; ///< Period of defrag runs
+     static constexpr std::chrono::milliseconds CLOCK_TICK{100}; ///< Period of coarse clock updates
+     static constexpr std::chrono::milliseconds PRESSURE_WINDOW{10}; ///< Back-off after contention
+     static constexpr std::chrono::microseconds LOCK_SLICE{250}; ///< Longest hold of mtx by a task
+ 
+     /**
+      * @brief Register the background tasks and start the scheduler
+      * @details Called once by each constructor after configuration is applied
+      */
+     void start_maintenance();
+ 
+     /**
+      * @brief Check whether client requests are waiting for, or recently waited for, mtx
+      * @return true If background tasks should yield
+      */
+     bool under_pressure() const;
  
  public:
+     /**
+      * @class Batch
+      * @brief Holds the engine lock across a group of operations
+      * 
+      * @details While a Batch is alive, engine calls made by the thread that
+      * created it run without locking, so the whole group executes as one
+      * critical section (MULTI/EXEC) and pays for one lock acquisition.
+      * @note Not reentrant; other threads block until the Batch is destroyed
+      */
+     class Batch {
+     public:
+         explicit Batch(StorageEngine& engine) : engine(engine), lock(engine) {
+             engine.batch_owner = std::this_thread::get_id();
+         }
+         ~Batch() { engine.batch_owner = std::thread::id(); }
+ 
+         Batch(const Batch&) = delete;
+         Batch& operator=(const Batch&) = delete;
+ 
+     private:
+         StorageEngine& engine; ///< Engine being held
+         ForegroundLock lock; ///< The engine mutex
+     };
+ 
      /**
       * @brief Construct a new Storage Engine
       * @param max_memory Maximum allowed memory in bytes (default: 1GB)
       */
      explicit StorageEngine(size_t max_memory = 1024 * 1024 * 1024);
+ 
+     /**
+      * @brief Construct a new Storage Engine from a configuration
+      * @param config Engine options (memory limit, optional indexes)
+      */
+     explicit StorageEngine(const EngineConfig& config);
      
      /**
       * @brief Destroy the Storage Engine
-      * @details Stops eviction thread and cleans up resources
+      * @details Stops the maintenance scheduler and cleans up resources
       */
      ~StorageEngine();
  
@@ -74,22 +433,259 @@
       * @param key Unique identifier
       * @param value Data to store
       * @param ttl Time-to-live in seconds (default: no expiration)
+      * @param tags Tags replacing the key's current ones (empty: keep them)
+      * @return true If the pair was stored
+      * @return false If it does not fit in max_memory and the eviction policy
+      *         cannot free enough room (always the case under noeviction)
       * 
       * @note Thread-safe through mutex locking
       */
-     void set(const std::string& key, const std::string& value,
-             std::chrono::seconds ttl = std::chrono::seconds::max());
+     bool set(const std::string& key, const std::string& value,
+             std::chrono::seconds ttl = std::chrono::seconds::max(),
+             const std::vector<std::string>& tags = {});
  
      /**
       * @brief Retrieve value for key
       * @param key Key to lookup
       * @return std::string Value or empty string if not found/expired
       * 
-      * @details Updates last_accessed timestamp for LRU tracking
+      * @details Expired keys are removed on access; updates eviction tracking
       * @note Thread-safe through mutex locking
       */
      std::string get(const std::string& key);
  
+     /**
+      * @brief Retrieve a value together with its version (GETV)
+      * @param key Key to look up
+      * @param[out] value Stored value
+      * @param[out] version Version of the stored value
+      * @return true If the key exists
+      * 
+      * @details Counts as an access, like get()
+      * @note Thread-safe through mutex locking
+      */
+     bool get_versioned(const std::string& key, std::string& value, uint64_t& version);
+ 
+     /**
+      * @brief Read a key, or take the lease to fill it on a miss (GETL)
+      * @param key Key to read
+      * @param[out] value Value on HIT; the stale value, if one is kept, otherwise
+      * @param[out] token Lease token on GRANTED
+      * @param[out] stale Whether value holds a stale value (GRANTED or WAIT)
+      * @return LeaseStatus HIT, GRANTED or WAIT
+      * 
+      * @details On a miss the first caller gets a lease token and the others
+      * get WAIT until the holder's SET lands or the lease times out. A key
+      * that expired in the last lease_grace_s seconds still offers its old
+      * value as stale.
+      * @note Thread-safe through mutex locking
+      */
+     LeaseStatus get_or_lease(const std::string& key, std::string& value, uint64_t& token, bool& stale);
+ 
+     /**
+      * @brief Store a value only if the caller holds the key's lease (SET ... LEASE)
+      * @param key Key to write
+      * @param value Data to store
+      * @param token Token returned by get_or_lease()
+      * @param ttl Time-to-live in seconds (default: no expiration)
+      * @param tags Tags replacing the key's current ones (empty: keep them)
+      * @return CasStatus OK, MISMATCH (lease not held: timed out, or cancelled
+      *         by a write or delete of the key) or OOM
+      * @note Thread-safe through mutex locking
+      */
+     CasStatus set_with_lease(const std::string& key, const std::string& value, uint64_t token,
+                              std::chrono::seconds ttl = std::chrono::seconds::max(),
+                              const std::vector<std::string>& tags = {});
+ 
+     /**
+      * @brief Store a value only if the stored version matches (SET ... IFVERSION)
+      * @param key Key to write
+      * @param value Data to store
+      * @param expected Version the caller last read; 0 means the key must not exist
+      * @param[out] version New version when the write is applied
+      * @param ttl Time-to-live in seconds (default: no expiration)
+      * @param tags Tags replacing the key's current ones (empty: keep them)
+      * @return CasStatus OK, MISMATCH or OOM
+      * 
+      * @details The version check and the in-place update share one hash probe
+      * @note Thread-safe through mutex locking
+      */
+     CasStatus set_if_version(const std::string& key, const std::string& value, uint64_t expected,
+                              uint64_t& version, std::chrono::seconds ttl = std::chrono::seconds::max(),
+                              const std::vector<std::string>& tags = {});
+ 
+     /**
+      * @brief Delete a key only if its stored version matches (DEL ... IFVERSION)
+      * @param key Key to remove
+      * @param expected Version the caller last read
+      * @return true If the key existed at that version and was deleted
+      * @note Thread-safe through mutex locking
+      */
+     bool del_if_version(const std::string& key, uint64_t expected);
+ 
+     /**
+      * @brief Atomically add to an integer value
+      * @param key Counter key (created as 0 if missing)
+      * @param delta Amount to add (negative to decrement)
+      * @param[out] result New value when the update succeeds
+      * @return IncrStatus OK, or why the counter was left unchanged
+      * 
+      * @details Works directly on the inline integer encoding, so no text is
+      * parsed or formatted. An existing TTL is kept. Concurrent calls are
+      * flat-combined: whichever caller holds the lock applies every pending
+      * increment, with one write per key. Combining only happens when several
+      * threads call this at once, i.e. for programs embedding the engine; the
+      * server calls it from its single event loop and always takes the
+      * uncontended path, where combining costs one atomic load.
+      * @note Thread-safe through mutex locking
+      */
+     IncrStatus incr_by(const std::string& key, int64_t delta, int64_t& result);
+ 
+     /**
+      * @brief Set or clear one bit of a value
+      * @param key Bitmap key (created if missing)
+      * @param offset Bit index; the value is zero-extended to cover it
+      * @param value New bit
+      * @param[out] previous Bit before the write
+      * @return false If extending the value does not fit in max_memory
+      * 
+      * @details Implements SETBIT. Edits the stored bytes in place; see
+      * update_bytes(). An existing TTL is kept.
+      * @note Thread-safe through mutex locking
+      */
+     bool setbit(const std::string& key, size_t offset, bool value, bool& previous);
+ 
+     /**
+      * @brief Read one bit of a value
+      * @param key Bitmap key
+      * @param offset Bit index
+      * @return bool The bit (false past the end or for a missing key)
+      * @note Thread-safe through mutex locking
+      */
+     bool getbit(const std::string& key, size_t offset);
+ 
+     /**
+      * @brief Count the set bits of a value
+      * @param key Bitmap key
+      * @param start First byte (or bit), negative counts from the end
+      * @param end Last byte (or bit), inclusive, negative counts from the end
+      * @param bit_units Whether start and end index bits instead of bytes
+      * @return size_t Number of set bits in the range (0 for a missing key)
+      * 
+      * @details Implements BITCOUNT; runs on the stored bytes without copying
+      * @note Thread-safe through mutex locking
+      */
+     size_t bitcount(const std::string& key, int64_t start = 0, int64_t end = -1, bool bit_units = false);
+ 
+     /**
+      * @brief Find the first bit with a given value
+      * @param key Bitmap key
+      * @param value Bit looked for
+      * @param start First byte (or bit), negative counts from the end
+      * @param end Last byte (or bit), inclusive, negative counts from the end
+      * @param end_given Whether the caller gave end; if not, a clear bit is
+      *        found just past the value, which reads as zero-padded
+      * @param bit_units Whether start and end index bits instead of bytes
+      * @return int64_t Bit index, or -1 if there is none
+      * 
+      * @details Implements BITPOS with the same rules as Redis, including a
+      * missing key reading as an empty string of zeros
+      * @note Thread-safe through mutex locking
+      */
+     int64_t bitpos(const std::string& key, bool value, int64_t start = 0, int64_t end = -1,
+                    bool end_given = false, bool bit_units = false);
+ 
+     /**
+      * @brief Combine values bit by bit into a destination key
+      * @param op AND, OR, XOR or NOT
+      * @param dest Key receiving the result (deleted if the result is empty)
+      * @param keys Source keys (NOT only reads the first); missing keys and
+      *        short values read as zeros
+      * @param[out] length Length of the result, that of the longest source
+      * @return false If the result does not fit in max_memory
+      * 
+      * @details Implements BITOP. The result replaces dest like SET, without a TTL.
+      * @note Thread-safe through mutex locking
+      */
+     bool bitop(Bitmap::Op op, const std::string& dest, const std::vector<std::string>& keys, size_t& length);
+ 
+     /**
+      * @brief Add elements to a HyperLogLog sketch
+      * @param key Sketch key (created sparse if missing)
+      * @param elements Elements to add
+      * @param[out] changed Whether a register changed or the key was created
+      * @return HllStatus OK, WRONGTYPE or OOM
+      * 
+      * @details Implements PFADD. A dense sketch is updated in place; a
+      * sparse one is rewritten, turning dense once it outgrows
+      * HyperLogLog::SPARSE_MAX_BYTES. An existing TTL is kept.
+      * @note Thread-safe through mutex locking
+      */
+     HllStatus pfadd(const std::string& key, const std::vector<std::string>& elements, bool& changed);
+ 
+     /**
+      * @brief Estimate the number of distinct elements added to sketches
+      * @param keys Sketch keys; with several, the count of their union
+      * @param[out] count Estimated cardinality (0 if no key exists)
+      * @return HllStatus OK or WRONGTYPE
+      * 
+      * @details Implements PFCOUNT. A single sketch's count is cached in its
+      * header until the next change.
+      * @note Thread-safe through mutex locking
+      */
+     HllStatus pfcount(const std::vector<std::string>& keys, uint64_t& count);
+ 
+     /**
+      * @brief Merge sketches into a destination sketch
+      * @param dest Key receiving the union (its own registers are included)
+      * @param keys Source sketch keys; missing keys are skipped
+      * @return HllStatus OK, WRONGTYPE or OOM
+      * 
+      * @details Implements PFMERGE. An existing TTL of dest is kept.
+      * @note Thread-safe through mutex locking
+      */
+     HllStatus pfmerge(const std::string& dest, const std::vector<std::string>& keys);
+ 
+     /**
+      * @brief Create an empty Bloom filter
+      * @param key Filter key
+      * @param error_rate False positive rate, in (0, 1)
+      * @param capacity Number of elements the rate holds for
+      * @return BloomStatus OK, EXISTS or OOM
+      * 
+      * @details Implements BF.RESERVE. The size must have been checked with
+      * BloomFilter::plan(). The filter has no TTL and does not grow: past
+      * capacity the false positive rate rises.
+      * @note Thread-safe through mutex locking
+      */
+     BloomStatus bf_reserve(const std::string& key, double error_rate, uint64_t capacity);
+ 
+     /**
+      * @brief Add elements to a Bloom filter
+      * @param key Filter key (created with the default rate and capacity if missing)
+      * @param elements Elements to add
+      * @param[out] added Per element, whether it was new to the filter
+      * @return BloomStatus OK, WRONGTYPE or OOM
+      * 
+      * @details Implements BF.ADD and BF.MADD. The filter is updated in
+      * place; an existing TTL is kept.
+      * @note Thread-safe through mutex locking
+      */
+     BloomStatus bf_add(const std::string& key, const std::vector<std::string>& elements, std::vector<bool>& added);
+ 
+     /**
+      * @brief Look elements up in a Bloom filter
+      * @param key Filter key
+      * @param elements Elements to look up
+      * @param[out] found Per element, whether it may have been added (all
+      *             false if the key is missing)
+      * @return BloomStatus OK or WRONGTYPE
+      * 
+      * @details Implements BF.EXISTS and BF.MEXISTS.
+      * @note Thread-safe through mutex locking
+      */
+     BloomStatus bf_exists(const std::string& key, const std::vector<std::string>& elements, std::vector<bool>& found);
+ 
      /**
       * @brief Delete a key-value pair
       * @param key Key to remove
@@ -99,18 +695,518 @@
       */
      bool del(const std::string& key);
  
+     /**
+      * @brief Delete a key-value pair, freeing the value in the background
+      * @param key Key to remove
+      * @return true If key existed and was unlinked
+      * @return false If key didn't exist
+      * 
+      * @details The entry is detached from every index in O(1) and its value
+      * handed to the lazy-free thread, so removing a very large value does not
+      * stall other clients. Its bytes count towards used memory until freed.
+      * @note Thread-safe through mutex locking
+      */
+     bool unlink(const std::string& key);
+ 
+     /**
+      * @brief Start watching a key for modifications (WATCH)
+      * @param key Key to watch (need not exist)
+      * @return uint64_t Current modification count, to compare with watch_touches()
+      * 
+      * @details Every write, delete, expiry or eviction of a watched key bumps
+      * its count. Each watch() must be paired with one unwatch().
+      * @note Thread-safe through mutex locking
+      */
+     uint64_t watch(const std::string& key);
+ 
+     /**
+      * @brief Stop watching a key
+      * @param key Key passed to watch()
+      * @note Thread-safe through mutex locking
+      */
+     void unwatch(const std::string& key);
+ 
+     /**
+      * @brief Current modification count of a watched key
+      * @param key Key passed to watch()
+      * @return uint64_t Count; differs from the value watch() returned iff the
+      *         key was modified since
+      * @note Thread-safe through mutex locking
+      */
+     uint64_t watch_touches(const std::string& key);
+ 
+     /**
+      * @brief Check whether the ordered key index is maintained
+      * @return true If prefix/range queries are available
+      */
+     bool has_ordered_index() const { return ordered_index != nullptr; }
+ 
+     /**
+      * @brief List keys starting with a prefix, in lexicographic order
+      * @param prefix Key prefix to match
+      * @param limit Maximum number of keys to return (0 = unlimited)
+      * @return std::vector<std::string> Matching keys
+      * @throws std::logic_error If the ordered index is disabled
+      * @note Thread-safe through mutex locking
+      */
+     std::vector<std::string> keys_with_prefix(const std::string& prefix, size_t limit = 0);
+ 
+     /**
+      * @brief List keys in the half-open range [start, end), in lexicographic order
+      * @param start Inclusive lower bound
+      * @param end Exclusive upper bound (empty = unbounded)
+      * @param limit Maximum number of keys to return (0 = unlimited)
+      * @return std::vector<std::string> Matching keys
+      * @throws std::logic_error If the ordered index is disabled
+      * @note Thread-safe through mutex locking
+      */
+     std::vector<std::string> keys_in_range(const std::string& start, const std::string& end,
+                                            size_t limit = 0);
+ 
+     /**
+      * @brief Delete every key starting with a prefix
+      * @param prefix Key prefix to match
+      * @return size_t Number of keys deleted
+      * @throws std::logic_error If the ordered index is disabled
+      * @note Thread-safe through mutex locking
+      */
+     size_t del_prefix(const std::string& prefix);
+ 
+     /**
+      * @brief Delete every key carrying any of the given tags (INVALIDATE)
+      * @param tag_names Tags to invalidate
+      * @return size_t Number of keys deleted
+      * 
+      * @details One lock acquisition for the whole batch. Values are freed
+      * like UNLINK, so large ones go to the lazy-free thread.
+      * @note Thread-safe through mutex locking
+      */
+     size_t invalidate(const std::vector<std::string>& tag_names);
+ 
+     /**
+      * @brief Incrementally iterate the keyspace
+      * @param cursor Cursor from the previous call (0 to start a new iteration)
+      * @param[out] keys Receives the keys visited by this call that match pattern
+      * @param pattern Glob pattern keys must match (default: all keys)
+      * @param count Approximate amount of work: entries visited per call (default: 10)
+      * @return size_t Cursor for the next call, 0 when the iteration is complete
+      * 
+      * @details Walks hash buckets in reverse-binary cursor order so the iteration
+      * stays correct across resizes, while each call does bounded work under the
+      * lock. Every key present for the whole iteration is returned at least once.
+      * Frozen keys follow the hash table, on cursors from FROZEN_CURSOR up; a
+      * FREEZE during the iteration restarts the frozen part, so keys may repeat.
+      * @note Thread-safe through mutex locking
+      */
+     size_t scan(size_t cursor, std::vector<std::string>& keys,
+                 const std::string& pattern = "*", size_t count = 10);
+ 
+     /**
+      * @brief Report engine and memory statistics
+      * @return std::vector<std::pair<std::string, std::string>> Ordered name/value pairs
+      * 
+      * @details Includes logical memory, process RSS, allocator usage and
+      * defragmenter progress
+      * @note Thread-safe through mutex locking
+      */
+     std::vector<std::pair<std::string, std::string>> stats();
+ 
+     /**
+      * @brief Move keys into the immutable frozen tier (FREEZE)
+      * @param pattern Glob pattern of the keys to freeze
+      * @return size_t Number of keys moved
+      * 
+      * @details Rebuilds the tier from its live keys plus every matching key
+      * without a TTL. Frozen keys are read without touching the hash table,
+      * are never evicted and are not counted against max_memory. Writing or
+      * deleting one moves it back into the hash table. The tier is built
+      * without holding the lock; clients only wait while records are copied
+      * and while the new tier is swapped in. A key written during the build
+      * stays in the hash table.
+      * @note Thread-safe through mutex locking
+      */
+     size_t freeze(const std::string& pattern = "*");
+ 
+     /**
+      * @brief Insert many key-value pairs at once (LOAD)
+      * @param records Keys and values to store, without TTL
+      * @return true If the batch was stored, false if it does not fit in max_memory
+      * 
+      * @details Checks memory and evicts once for the whole batch, pre-sizes
+      * the hash table, inserts under a single lock acquisition and registers
+      * the new keys with the eviction policy in one pass at the end. Existing
+      * keys are overwritten as by SET. Nothing is stored when the batch does
+      * not fit.
+      * @note Thread-safe through mutex locking
+      */
+     bool bulk_load(const std::vector<std::pair<std::string, std::string>>& records);
+ 
+     /**
+      * @brief Serialize one key (DUMP)
+      * @param key Key to serialize
+      * @param[out] payload Versioned, checksummed blob with the value and remaining TTL
+      * @return true If the key exists
+      * @note Thread-safe through mutex locking
+      */
+     bool dump(const std::string& key, std::string& payload);
+ 
+     /**
+      * @brief Serialize several keys into one blob (MDUMP)
+      * @param keys Keys to serialize; missing keys are skipped
+      * @param[out] dumped Number of keys written to the blob
+      * @return std::string Blob whose records carry their keys
+      * @note Thread-safe through mutex locking
+      */
+     std::string dump_keys(const std::vector<std::string>& keys, size_t& dumped);
+ 
+     /**
+      * @brief Install a DUMP blob under a key (RESTORE)
+      * @param key Target key
+      * @param payload Blob produced by dump()
+      * @param replace Overwrite the key if it exists
+      * @return RestoreStatus OK, BAD_PAYLOAD, BUSY_KEY or OOM
+      * @details The key gets the value and the TTL that was remaining at DUMP time
+      * @note Thread-safe through mutex locking
+      */
+     RestoreStatus restore(const std::string& key, const std::string& payload, bool replace);
+ 
+     /**
+      * @brief Install every key of an MDUMP blob (MRESTORE)
+      * @param payload Blob produced by dump_keys()
+      * @param replace Overwrite keys that exist
+      * @param[out] restored Number of keys installed
+      * @return RestoreStatus OK, BAD_PAYLOAD, BUSY_KEY or OOM
+      * @details The whole blob is validated, and without replace every key is
+      * checked, before anything is written
+      * @note Thread-safe through mutex locking
+      */
+     RestoreStatus restore_keys(const std::string& payload, bool replace, size_t& restored);
+ 
  private:
+     static constexpr size_t FROZEN_CURSOR = size_t(1) << 62; ///< First SCAN cursor of the frozen tier
+     static constexpr size_t SCAN_BUCKETS_PER_ENTRY = 10; ///< Buckets a SCAN call may walk per entry of its count
+     static constexpr unsigned FROZEN_SLOT_BITS = 40; ///< Low cursor bits holding the frozen slot
+     static constexpr size_t FROZEN_SLOT_MASK = (size_t(1) << FROZEN_SLOT_BITS) - 1; ///< Slot part of a frozen cursor
+ 
+     /**
+      * @brief SCAN cursor of a frozen slot, tagged with the tier generation
+      * @param slot Slot to resume from
+      * @details Caller must hold mtx
+      */
+     size_t frozen_cursor(size_t slot) const {
+         size_t tag = frozen_generation & ((size_t(1) << (62 - FROZEN_SLOT_BITS)) - 1);
+         return FROZEN_CURSOR | tag << FROZEN_SLOT_BITS | slot;
+     }
+ 
+     /**
+      * @brief Find a key's entry for a write, moving a frozen key into the hash table
+      * @param key Key being written
+      * @param lookup Borrowed encoding of key
+      * @return Entry* The entry, or nullptr if the key does not exist
+      * @details Caller must hold mtx
+      */
+     Entry* find_for_write(const std::string& key, const CompactString& lookup);
+ 
+     /**
+      * @brief Append a key's record to a DUMP blob
+      * @param out Blob started with DumpPayload::begin()
+      * @param keyed Whether the blob is KEYED
+      * @param key Key to serialize
+      * @return true If the key exists (expired keys do not)
+      * @details Caller must hold mtx
+      */
+     bool dump_record(std::string& out, bool keyed, const std::string& key);
+ 
+     /**
+      * @brief Replace a key's tags, or drop the key from the tag index
+      * @param key Key to update
+      * @param tags New tags, or nullptr to drop the key
+      * @details The index's memory counts towards max_memory. Caller must hold mtx
+      */
+     void retag(const std::string& key, const std::vector<std::string>* tags);
+ 
+     /**
+      * @brief Look up a value for a read command that works on its bytes
+      * @param key Key to look up
+      * @param scratch Buffer for values not stored as bytes (inline, integer)
+      * @param[out] value View of the value, valid while mtx is held and the key is unchanged
+      * @return true If the key exists; an expired key is removed
+      * @details Records the access for eviction. Caller must hold mtx
+      */
+     bool read_value(const std::string& key, std::string& scratch, std::string_view& value);
+ 
+     /**
+      * @brief Edit a value's bytes, creating or zero-extending it first
+      * @param key Key to modify
+      * @param min_size Length the value is zero-extended to
+      * @param fn Called as fn(unsigned char* data, size_t size) on the value;
+      *        returns whether it changed anything
+      * @return false If the extended value does not fit in max_memory
+      * @details Caller must hold mtx
+      */
+     template <typename Fn>
+     bool update_bytes(const std::string& key, size_t min_size, Fn&& fn);
+
+     /**
+      * @brief Put the blocks of a just-written Bloom filter on cache lines
+      * @param lookup Borrowed encoding of the filter's key
+      * @details Called where filters are created or restored, so that
+      * BF.EXISTS never has to write. Shared and non-filter values are left
+      * alone. Caller must hold mtx
+      */
+     void align_filter(const CompactString& lookup);
+ 
+     /**
+      * @brief Apply every increment published in combine_slots
+      * @details Groups the requests by key and hands each group to
+      * apply_increments(). Caller must hold mtx
+      */
+     void combine_increments();
+ 
+     /**
+      * @brief Apply increments of one key with a single write
+      * @param group Requests for the same key, applied in order
+      * @param count Number of requests
+      * @details Equivalent to running them one after the other: a request
+      * that would overflow is rejected and the next ones go on from the
+      * previous value. Caller must hold mtx
+      */
+     void apply_increments(IncrRequest* const* group, size_t count);
+ 
+     /**
+      * @brief Remove an expired key, keeping its value as stale when leases have a grace period
+      * @param key Expired key
+      * @param lazy Free the value on the lazy-free thread
+      * @return true If the key was removed
+      * @details Used by the TTL checks of reads and by the expire task. Caller must hold mtx
+      */
+     bool expire_entry(const std::string& key, bool lazy = false);
+ 
+     /**
+      * @brief Drop the lease and the stale value of a key that was written or removed
+      * @param key Key being written or removed
+      * @details Caller must hold mtx
+      */
+     void end_lease(const std::string& key);
+ 
+     /**
+      * @brief Drop stale values past their grace period and timed-out leases
+      * @param now Coarse clock
+      * @details Caller must hold mtx
+      */
+     void drop_expired_leases(uint32_t now);
+ 
+     /**
+      * @brief Bytes an outstanding lease is charged: its key in the lease map
+      * and the expiry queue, plus token and deadline
+      */
+     static size_t lease_bytes(const std::string& key) { return 2 * key.size() + sizeof(Lease); }
+ 
+     /**
+      * @brief Check whether a key exists in either tier
+      * @param key Key to look up
+      * @return true If the key is live in the hash table or the frozen tier
+      * @details Caller must hold mtx
+      */
+     bool key_exists(const std::string& key);
+ 
+     /**
+      * @brief Remove an entry and all bookkeeping that refers to it
+      * @param key Key to remove
+      * @param lazy Hand the value to the lazy-free thread instead of freeing it
+      * @return true If the key existed
+      * @details Adjusts memory usage, eviction tracking and the ordered index.
+      * Caller must hold mtx.
+      */
+     bool remove_entry(const std::string& key, bool lazy = false);
+ 
+     /**
+      * @brief Encode a value for storage, sharing it if an identical one exists
+      * @param value Value being written
+      * @return CompactString Stored form (a shared reference when deduplicated)
+      * @details A new shared value is charged to current_memory here, once;
+      * entries referencing it are charged only for their key. Caller must hold mtx.
+      */
+     CompactString intern(const std::string& value);
+ 
+     /**
+      * @brief Drop an entry's claim on its value before the value is destroyed
+      * @param value Value about to be overwritten or removed
+      * @return size_t Bytes its destruction will free (0 if still shared)
+      * @details Removes a shared value from the dedup table when this entry is
+      * its last user. Caller must hold mtx.
+      */
+     size_t release_value(const CompactString& value);
+ 
+     /**
+      * @brief Bytes charged to current_memory for one entry
+      * @param key_size Length of the key
+      * @param value Stored value
+      * @return size_t Key plus value, or just the key for shared values
+      */
+     static size_t entry_bytes(size_t key_size, const CompactString& value) {
+         return key_size + (value.is_shared() ? 0 : value.size());
+     }
+ 
+     /**
+      * @brief Write a value into a looked-up entry, or insert a new one
+      * @param key Key being written
+      * @param lookup Borrowed encoding of key used for the lookup
+      * @param entry Result of that lookup (nullptr if the key is missing)
+      * @param value Data to store
+      * @param ttl Time-to-live in seconds
+      * @param keep_ttl Keep the existing entry's expiry instead of applying ttl
+      * @param extra Bytes the caller will charge after the write, included in the memory check
+      * @return uint64_t Version of the written entry, 0 if rejected for lack of memory
+      * @details Updates an existing entry in place, so a write that needs no
+      * eviction probes the table only once. Caller must hold mtx.
+      */
+     uint64_t write_entry(const std::string& key, const CompactString& lookup, Entry* entry,
+                          const std::string& value, std::chrono::seconds ttl, bool keep_ttl = false,
+                          size_t extra = 0);
+ 
+     /**
+      * @brief Record a modification of a key for WATCH
+      * @param key Modified key
+      * @details O(1) and free when nothing is watched. Caller must hold mtx.
+      */
+     void touch(const std::string& key) {
+         if (watched_keys.empty()) return;
+         auto it = watched_keys.find(key);
+         if (it != watched_keys.end()) it->second.touches++;
+     }
+ 
+     /**
+      * @brief Wake the evict task if memory just crossed the high watermark
+      * @details Called after every write that grows memory. Caller must hold mtx.
+      */
+     void wake_evictor();
+ 
+     /**
+      * @brief Throw unless the ordered index is enabled
+      */
+     void require_ordered_index() const;
+ 
+ 
+     /**
+      * @brief Evict keys until an incoming write fits in max_memory
+      * @param key Key about to be written
+      * @param incoming Bytes the write will add (key plus new value)
+      * @return true If the write fits, false if the policy ran out of victims
+      * @details Called automatically during SET operations, before the write.
+      * The hard-limit backstop: normally the evict task keeps memory below
+      * the high watermark and this finds nothing to do.
+      */
+     bool enforce_memory_limits(const std::string& key, size_t incoming);
+ 
+     /**
+      * @brief Evict one key to bring memory down
+      * @param sync Evicted for a write that must fit (counted in evicted_keys_sync)
+      * @return true If a key was evicted, false if no victim could be taken
+      * @note Caller must hold mtx
+      */
+     bool evict_one(bool sync);
+ 
+     /**
+      * @brief Evict this engine's policy victim
+      * @param sync Evicted for a write that must fit
+      * @return true If the policy had a victim
+      * @note Caller must hold mtx
+      */
+     bool evict_own(bool sync);
+ 
+     /**
+      * @brief Report whether an entry carries a TTL and when it expires
+      * @param entry Entry to inspect
+      * @param[out] expires_at Expiry time if the entry has a TTL
+      * @return true If the entry has a TTL
+      */
+     bool entry_expiry(const Entry& entry, MemoryManager::TimePoint& expires_at) const;
+ 
+     /**
+      * @brief Read the coarse clock
+      * @return uint32_t Current second of the coarse clock (never 0)
+      * @details One relaxed atomic load; replaces a clock read per request
+      */
+     uint32_t coarse_now() const { return clock_seconds.load(std::memory_order_relaxed); }
+ 
+     /**
+      * @brief Convert a TTL into an entry expiry
+      * @param ttl Time-to-live, seconds::max() for none
+      * @return uint32_t Coarse-clock expiry second, 0 for no expiry
+      */
+     uint32_t expiry_after(std::chrono::seconds ttl) const;
+ 
+     /**
+      * @brief Check whether an entry's TTL has run out
+      * @param entry Entry to inspect
+      * @param now Current coarse-clock second
+      * @return true If the entry has a TTL and it has passed
+      */
+     static bool is_expired(const Entry& entry, uint32_t now) {
+         return entry.expires_at != 0 && now > entry.expires_at;
+     }
+ 
+     /**
+      * @brief Advance the coarse clock (clock task)
+      * @return bool Always false (the task never has a backlog)
+      */
+     bool tick_clock();
+ 
+     /**
+      * @brief Run one CPU-budgeted slice of active defragmentation
+      * @param deadline Time by which the slice must return
+      * @return true If a cycle is still in progress
+      * @details Starts a cycle when RSS exceeds allocator usage by more than the
+      * configured threshold, then relocates entries a few buckets at a time,
+      * holding the lock for at most LOCK_SLICE at a time. Releases free pages
+      * to the OS when a cycle completes.
+      */
+     bool defrag_step(MaintenanceScheduler::Clock::time_point deadline);
+ 
+     /**
+      * @brief Sweep part of the keyspace for expired entries
+      * @param deadline Time by which the sweep must return
+      * @return true If many of the sampled entries were expired (run again soon)
+      * @details Continues a bucket cursor from the previous run, so every entry
+      * is checked once per full sweep while each run stays within its budget
+      */
+     bool expire_step(MaintenanceScheduler::Clock::time_point deadline);
+ 
+     /**
+      * @brief Evict keys from above the high watermark down to the low one
+      * @param deadline Time by which the task must return
+      * @return true If memory is still above the low watermark
+      */
+     bool evict_step(MaintenanceScheduler::Clock::time_point deadline);
+ 
+     /**
+      * @brief Advance an in-progress incremental hash table resize
+      * @param deadline Time by which the task must return
+      * @return true If buckets remain to be rehashed
+      */
+     bool rehash_step(MaintenanceScheduler::Clock::time_point deadline);
+ 
+     /**
+      * @brief Refresh the sampled RSS and allocator statistics
+      * @return false Always (the task never has a backlog)
+      */
+     bool sample_memory();
+ 
      /**
-      * @brief Enforce memory limits via LRU eviction
-      * @details Called automatically during SET operations
+      * @brief Fit max_memory and the watermarks to the cgroup
+      * @return false Always; each sample is complete
+      * @details Reads the cgroup files without mtx and takes it only to
+      * apply a changed limit
       */
-     void enforce_memory_limits();
+     bool cgroup_step();
  
      /**
-      * @brief Remove expired entries based on TTL
-      * @details Background process running in eviction_thread
-      * Complexity: O(n) where n = number of entries
+      * @brief Set max_memory and derive both watermarks from it
+      * @param bytes New limit
+      * @param low_pct Low watermark in % of the limit
+      * @note Caller must hold mtx
       */
-     void evict_expired();
+     void apply_memory_limit(size_t bytes, unsigned low_pct);
  };
  
\ No newline at end of file
@@ -0,0 +1,178 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @class TagIndex
+ * @brief Two-way index between tags and the keys written with them
+ *
+ * @details Backs SET ... TAGS and INVALIDATE. Each key and each tag name is
+ *          stored once, on the heap, and both maps are keyed by views of
+ *          those strings: a tag holds the set of its keys as views of the
+ *          key names, and a key holds the list of its tags as views of the
+ *          tag names. So looking up a key to drop it (on every delete,
+ *          eviction and expiry of a tagged key) allocates nothing, and a tag
+ *          disappears with its last key.
+ */
+class TagIndex
+{
+private:
+    /**
+     * @struct TagNode
+     * @brief A tag and the keys carrying it
+     */
+    struct TagNode
+    {
+        std::unique_ptr<std::string> name;           ///< Owned tag name, viewed by the map and by keys
+        std::unordered_set<std::string_view> keys;   ///< Views of the tagged keys' names
+    };
+
+    /**
+     * @struct KeyNode
+     * @brief A tagged key and its tags
+     */
+    struct KeyNode
+    {
+        std::unique_ptr<std::string> name;  ///< Owned key name, viewed by the map and by tags
+        std::vector<std::string_view> tags; ///< Views of the tag names
+    };
+
+    std::unordered_map<std::string_view, TagNode> tags_; ///< Tag -> keys
+    std::unordered_map<std::string_view, KeyNode> keys_; ///< Key -> tags
+    size_t name_bytes_ = 0;                              ///< Bytes of stored key and tag names
+    size_t pairs_ = 0;                                   ///< Key-tag associations
+
+    static constexpr size_t NODE = 2 * sizeof(void *) + sizeof(size_t); ///< Hash node overhead
+    static constexpr size_t NAME_NODE = NODE + sizeof(std::string) + sizeof(TagNode); ///< Per key or tag, besides its name
+    static constexpr size_t PAIR = NODE + sizeof(void *) + 2 * sizeof(std::string_view); ///< Per key-tag pair
+
+public:
+    /**
+     * @brief Replace the tags of a key
+     * @param key Key written with TAGS
+     * @param tags New tags (duplicates are ignored); empty removes the key
+     */
+    void assign(std::string_view key, const std::vector<std::string> &tags)
+    {
+        forget(key);
+        if (tags.empty())
+            return;
+
+        auto name = std::make_unique<std::string>(key);
+        std::string_view key_view = *name;
+        name_bytes_ += key.size();
+        KeyNode &node = keys_.emplace(key_view, KeyNode{std::move(name), {}}).first->second;
+        node.tags.reserve(tags.size());
+        for (const auto &tag : tags)
+        {
+            auto it = tags_.find(tag);
+            if (it == tags_.end())
+            {
+                auto tag_name = std::make_unique<std::string>(tag);
+                std::string_view tag_view = *tag_name;
+                name_bytes_ += tag.size();
+                it = tags_.emplace(tag_view, TagNode{std::move(tag_name), {}}).first;
+            }
+            if (it->second.keys.insert(key_view).second)
+            {
+                node.tags.push_back(it->first);
+                pairs_++;
+            }
+        }
+    }
+
+    /**
+     * @brief Drop a key from every tag it carries
+     * @param key Key deleted, evicted or expired
+     * @return true If the key was tagged
+     */
+    bool forget(std::string_view key)
+    {
+        if (keys_.empty())
+            return false;
+        auto it = keys_.find(key);
+        if (it == keys_.end())
+            return false;
+        for (std::string_view tag : it->second.tags)
+        {
+            auto t = tags_.find(tag);
+            t->second.keys.erase(it->first);
+            if (t->second.keys.empty())
+            {
+                name_bytes_ -= t->first.size();
+                tags_.erase(t);
+            }
+        }
+        pairs_ -= it->second.tags.size();
+        name_bytes_ -= it->first.size();
+        keys_.erase(it);
+        return true;
+    }
+
+    /**
+     * @brief Keys carrying a tag
+     * @param tag Tag to look up
+     * @return std::vector<std::string> Copies of the key names, so that the
+     *         caller may delete them while iterating
+     */
+    std::vector<std::string> keys(std::string_view tag) const
+    {
+        std::vector<std::string> out;
+        auto it = tags_.find(tag);
+        if (it == tags_.end())
+            return out;
+        out.reserve(it->second.keys.size());
+        for (std::string_view key : it->second.keys)
+            out.emplace_back(key);
+        return out;
+    }
+
+    /**
+     * @brief Number of tags with at least one key
+     */
+    size_t tag_count() const { return tags_.size(); }
+
+    /**
+     * @brief Number of keys carrying at least one tag
+     */
+    size_t key_count() const { return keys_.size(); }
+
+    /**
+     * @brief Check whether no key is tagged
+     */
+    bool empty() const { return keys_.empty(); }
+
+    /**
+     * @brief Approximate bytes held by the index
+     * @details Names, one map node per key and per tag, and per key-tag pair
+     *          one set node, its bucket and one list slot. O(1)
+     */
+    size_t memory_bytes() const
+    {
+        return name_bytes_ + (tags_.size() + keys_.size()) * NAME_NODE + pairs_ * PAIR +
+               (tags_.bucket_count() + keys_.bucket_count()) * sizeof(void *);
+    }
+
+    /**
+     * @brief Bytes assign() adds to memory_bytes(), at most
+     * @param key Key about to be tagged
+     * @param tags Its new tags
+     * @details Counts the key and every tag as new and ignores the old tags
+     *          assign() drops, so memory can be checked before the write.
+     *          Bucket array growth is left out: it is amortized O(1) per node.
+     */
+    static size_t assign_bytes(std::string_view key, const std::vector<std::string> &tags)
+    {
+        if (tags.empty())
+            return 0;
+        size_t bytes = key.size() + NAME_NODE;
+        for (const auto &tag : tags)
+            bytes += tag.size() + NAME_NODE + PAIR;
+        return bytes;
+    }
+};
@@ -0,0 +1,859 @@
+/**
+ * @file engine_test.cpp
+ * @brief Behaviour tests of the storage engine (run with make test)
+ */
+
+ #include "StorageEngine.h"
+ #include <iostream>
+ #include <string>
+ #include <vector>
+ #include <set>
+ #include <random>
+ #include <algorithm>
+ #include <chrono>
+ #include <thread>
+ 
+ static int failures = 0;
+ 
+ // Report a failed expectation and keep going
+ static void check(bool ok, const std::string& what) {
+     if (!ok) {
+         std::cout << "FAIL: " << what << "\n";
+         failures++;
+     }
+ }
+ 
+ // Numeric INFO field of an engine
+ static size_t stat(StorageEngine& engine, const std::string& name) {
+     for (const auto& field : engine.stats()) {
+         if (field.first == name) return std::stoull(field.second);
+     }
+     return 0;
+ }
+ 
+ // A dense sketch stored with SET whose 6-bit registers are all 63, above
+ // HyperLogLog::MAX_RANK: PFCOUNT and PFMERGE must treat them as MAX_RANK
+ // rather than index past the rank histogram
+ static void test_hostile_hll() {
+     StorageEngine engine;
+     std::string hostile = "BHLL";
+     hostile.append(11, '\0');
+     hostile.push_back('\x80'); // Cached count stale
+     hostile.append(HyperLogLog::DENSE_BYTES, '\xff');
+     check(HyperLogLog::valid(hostile), "hostile sketch is well-formed");
+     engine.set("hostile", hostile);
+ 
+     std::vector<uint8_t> saturated(HyperLogLog::REGISTERS, HyperLogLog::MAX_RANK);
+     uint64_t expected = HyperLogLog::estimate(saturated.data());
+ 
+     uint64_t count = 0;
+     check(engine.pfcount({"hostile"}, count) == HllStatus::OK && count == expected, "PFCOUNT of hostile sketch");
+     check(engine.pfcount({"hostile", "missing"}, count) == HllStatus::OK && count == expected,
+           "PFCOUNT of hostile sketch with another key");
+     check(engine.pfmerge("merged", {"hostile"}) == HllStatus::OK, "PFMERGE of hostile sketch");
+     check(engine.pfcount({"merged"}, count) == HllStatus::OK && count == expected, "PFCOUNT of merged sketch");
+ 
+     std::vector<uint8_t> registers(HyperLogLog::REGISTERS);
+     HyperLogLog::decode(engine.get("merged"), registers.data());
+     bool in_range = true;
+     for (uint8_t r : registers) in_range &= r <= HyperLogLog::MAX_RANK;
+     check(in_range, "merged registers within MAX_RANK");
+ }
+ 
+ // Writes to a key whose TTL has passed but which the expiry task has not
+ // reaped yet must see it as missing: INCR restarts the counter, and a
+ // versioned write or delete does not match the old version
+ static void test_expired_writes() {
+     StorageEngine engine;
+     const int keys = 100;
+     for (int i = 0; i < keys; i++) {
+         engine.set("counter:" + std::to_string(i), "10", std::chrono::seconds(1));
+         engine.set("cas:" + std::to_string(i), "v", std::chrono::seconds(1));
+         engine.set("del:" + std::to_string(i), "v", std::chrono::seconds(1));
+     }
+     uint64_t cas_version = 0, del_version = 0;
+     std::string value;
+     engine.get_versioned("cas:0", value, cas_version);
+     engine.get_versioned("del:0", value, del_version);
+     std::this_thread::sleep_for(std::chrono::milliseconds(2300));
+ 
+     bool restarted = true, kept = true;
+     for (int i = 0; i < keys; i++) {
+         std::string key = "counter:" + std::to_string(i);
+         int64_t result = 0;
+         restarted &= engine.incr_by(key, 1, result) == IncrStatus::OK && result == 1;
+         kept &= engine.get(key) == "1";
+     }
+     check(restarted, "INCR on an expired key starts from 0");
+     check(kept, "counter restarted by INCR is readable");
+ 
+     uint64_t version = 0;
+     check(engine.set_if_version("cas:0", "w", cas_version, version) == CasStatus::MISMATCH,
+           "SET IFVERSION does not match an expired key's version");
+     check(engine.set_if_version("cas:1", "w", 0, version) == CasStatus::OK && engine.get("cas:1") == "w",
+           "SET IFVERSION 0 creates over an expired key");
+     check(!engine.del_if_version("del:0", del_version), "DEL IFVERSION does not delete an expired key");
+ }
+ 
+ // Under noeviction, a write that only exceeds maxmemory because of values
+ // still queued on the lazy-free thread is admitted (the backlog counts as
+ // freed once there is nothing left to evict) instead of waiting on the
+ // thread under the engine lock
+ static void test_lazy_free_backlog() {
+     EngineConfig config;
+     config.max_memory = 64 * 1024 * 1024;
+     config.eviction_policy = EvictionPolicy::NOEVICTION;
+     config.lazy_free = true;
+     StorageEngine engine(config);
+     const std::string value(1024 * 1024, 'x');
+     const int keys = 48;
+     for (int i = 0; i < keys; i++) engine.set("old:" + std::to_string(i), value);
+     for (int i = 0; i < keys; i++) engine.unlink("old:" + std::to_string(i));
+ 
+     bool stored = true;
+     for (int i = 0; i < keys; i++) stored &= engine.set("new:" + std::to_string(i), value);
+     check(stored, "writes fit while the lazy-free backlog drains");
+     check(!engine.set("over", std::string(32 * 1024 * 1024, 'y')), "noeviction still rejects what does not fit");
+ 
+     for (int i = 0; i < 100 && stat(engine, "lazyfree_pending_memory") > 0; i++) {
+         std::this_thread::sleep_for(std::chrono::milliseconds(10));
+     }
+     check(stat(engine, "used_memory") <= config.max_memory, "used_memory within maxmemory once drained");
+ }
+ 
+ // Engines sharing one memory budget (the keyspaces of a server) must keep
+ // their total within max_memory, evicting from the largest one first
+ static void test_shared_budget() {
+     EngineConfig config;
+     config.max_memory = 16 * 1024 * 1024;
+     config.eviction_policy = EvictionPolicy::NOEVICTION;
+     config.shared_memory = std::make_shared<SharedMemory>();
+     const std::string value(1024 * 1024, 'x');
+     {
+         StorageEngine first(config), second(config);
+         for (int i = 0; i < 12; i++) first.set("a:" + std::to_string(i), value);
+         bool rejected = false;
+         for (int i = 0; i < 12; i++) rejected |= !second.set("b:" + std::to_string(i), value);
+         check(rejected, "noeviction rejects writes past the shared budget");
+         check(config.shared_memory->used <= config.max_memory, "total within the shared budget");
+         check(stat(second, "used_memory_all_keyspaces") == config.shared_memory->used, "INFO reports the shared total");
+         for (int i = 0; i < 12; i++) first.del("a:" + std::to_string(i));
+         check(second.set("b:after", value), "memory freed in one keyspace is usable by another");
+     }
+     check(config.shared_memory->used == 0, "destroyed engines leave the shared total");
+     check(config.shared_memory->engines.empty(), "destroyed engines leave the shared budget");
+ 
+     // Filling a side keyspace takes memory from the one holding it, instead
+     // of evicting the keys just written
+     config.eviction_policy = EvictionPolicy::ALLKEYS_LRU;
+     {
+         StorageEngine first(config), second(config);
+         for (int i = 0; i < 12; i++) first.set("a:" + std::to_string(i), value);
+         bool stored = true;
+         for (int i = 0; i < 6; i++) stored &= second.set("b:" + std::to_string(i), value);
+         check(stored, "writes past the shared budget fit by eviction");
+         size_t kept = 0;
+         for (int i = 0; i < 6; i++) kept += second.get("b:" + std::to_string(i)).size() == value.size();
+         check(kept == 6, "the keyspace being filled keeps its fresh keys");
+         check(stat(first, "evicted_keys") > 0 && stat(second, "evicted_keys") == 0, "victims come from the larger keyspace");
+         check(config.shared_memory->used <= config.max_memory, "total within the shared budget after eviction");
+ 
+         bool filled = true;
+         for (int i = 6; i < 40; i++) filled &= second.set("b:" + std::to_string(i), value);
+         check(filled && config.shared_memory->used <= config.max_memory, "a keyspace evicts its own keys once it is the largest");
+     }
+ 
+     // Under a volatile policy the TTL keys of another keyspace are victims
+     config.eviction_policy = EvictionPolicy::VOLATILE_LRU;
+     StorageEngine first(config), second(config);
+     for (int i = 0; i < 12; i++) first.set("a:" + std::to_string(i), value, std::chrono::seconds(3600));
+     bool stored = true;
+     for (int i = 0; i < 8; i++) stored &= second.set("b:" + std::to_string(i), value);
+     check(stored, "volatile eviction takes TTL keys of another keyspace");
+     check(config.shared_memory->used <= config.max_memory, "total within the shared budget under volatile-lru");
+     check(!second.set("b:over", std::string(8 * 1024 * 1024, 'z')), "no victims left still rejects the write");
+ }
+ 
+ // A FREEZE while SCAN is inside the frozen tier rebuilds it with new slots:
+ // the iteration must still return every key, at the cost of repeats
+ static void test_scan_across_freeze() {
+     StorageEngine engine;
+     const int keys = 200;
+     for (int i = 0; i < keys; i++) engine.set("old:" + std::to_string(i), "v");
+     check(engine.freeze("old:*") == keys, "FREEZE moves every matching key");
+     for (int i = 0; i < keys; i++) engine.set("new:" + std::to_string(i), "v");
+ 
+     std::vector<std::string> seen;
+     size_t cursor = 0;
+     bool frozen_again = false;
+     do {
+         cursor = engine.scan(cursor, seen, "*", 10);
+         if (!frozen_again && seen.size() >= keys + keys / 2) {
+             check(engine.freeze("new:*") == keys, "FREEZE during SCAN moves the new keys");
+             frozen_again = true;
+         }
+     } while (cursor != 0);
+ 
+     std::sort(seen.begin(), seen.end());
+     seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+     check(frozen_again && seen.size() == 2 * keys, "SCAN returns every key across a FREEZE");
+ 
+     check(engine.get("new:7") == "v" && engine.get("old:7") == "v", "frozen keys readable");
+ }
+ 
+ // Leases of missing keys are charged to used_memory until they are used,
+ // cancelled by a write or time out
+ static void test_lease_memory() {
+     EngineConfig config;
+     config.lease_timeout_s = 1;
+     StorageEngine engine(config);
+     size_t baseline = stat(engine, "used_memory");
+     const int keys = 1000;
+     std::string value;
+     uint64_t token = 0;
+     bool stale = false;
+     for (int i = 0; i < keys; i++) engine.get_or_lease("missing:" + std::to_string(i), value, token, stale);
+     check(stat(engine, "leases") == keys, "a lease per missing key");
+     check(stat(engine, "used_memory") >= baseline + keys * std::string("missing:0").size(), "leases are charged");
+ 
+     for (int i = 0; i < keys / 2; i++) engine.del("missing:" + std::to_string(i));
+     check(stat(engine, "leases") == keys / 2, "DEL cancels leases");
+     for (int i = 0; i < 100 && stat(engine, "leases") > 0; i++) {
+         std::this_thread::sleep_for(std::chrono::milliseconds(50));
+     }
+     check(stat(engine, "leases") == 0, "timed-out leases are dropped");
+     check(stat(engine, "used_memory") == baseline, "dropped leases are no longer charged");
+ }
+ 
+ // The tag index growth of SET ... TAGS is part of the memory check, so
+ // tags cannot push used_memory past maxmemory under noeviction
+ static void test_tag_charge() {
+     EngineConfig config;
+     config.max_memory = 16 * 1024;
+     config.eviction_policy = EvictionPolicy::NOEVICTION;
+     StorageEngine engine(config);
+     std::vector<std::string> tags;
+     for (int i = 0; i < 100; i++) tags.push_back(std::string(200, 'a' + i % 26) + std::to_string(i));
+     check(!engine.set("tagged", std::string(100, 'v'), std::chrono::seconds::max(), tags),
+           "SET whose tags do not fit is rejected");
+     check(stat(engine, "used_memory") <= config.max_memory, "used_memory within maxmemory");
+     tags.resize(2);
+     check(engine.set("tagged", std::string(100, 'v'), std::chrono::seconds::max(), tags), "SET with tags that fit");
+     check(stat(engine, "tagged_keys") == 1, "tags recorded");
+ }
+ 
+ // Increments that queue behind the engine lock are flat-combined: the
+ // thread that gets the lock applies all of them. Every caller still gets
+ // a distinct result, and the counters end up exact
+ static void test_incr_combining() {
+     StorageEngine engine;
+     const int threads = 8, rounds = 2000;
+     const std::vector<std::string> keys = {"hot:0", "hot:1"};
+     std::vector<std::vector<int64_t>> results(threads);
+     std::vector<std::thread> workers;
+     {
+         // Hold the lock so the first increments of every thread have to
+         // publish their requests and wait
+         StorageEngine::Batch batch(engine);
+         for (int t = 0; t < threads; t++) {
+             workers.emplace_back([&, t] {
+                 for (int i = 0; i < rounds; i++) {
+                     int64_t result = 0;
+                     if (engine.incr_by(keys[i % 2], 1, result) == IncrStatus::OK) results[t].push_back(result);
+                 }
+             });
+         }
+         std::this_thread::sleep_for(std::chrono::milliseconds(50));
+     }
+     for (auto& worker : workers) worker.join();
+ 
+     for (size_t k = 0; k < keys.size(); k++) {
+         std::vector<int64_t> seen;
+         for (int t = 0; t < threads; t++) {
+             for (size_t i = k; i < results[t].size(); i += 2) seen.push_back(results[t][i]);
+         }
+         std::sort(seen.begin(), seen.end());
+         bool distinct = seen.size() == static_cast<size_t>(threads * rounds / 2);
+         for (size_t i = 0; distinct && i < seen.size(); i++) distinct = seen[i] == static_cast<int64_t>(i + 1);
+         check(distinct, "combined INCR results of " + keys[k] + " are 1..N, each once");
+         check(engine.get(keys[k]) == std::to_string(threads * rounds / 2), "combined INCR total of " + keys[k]);
+     }
+     check(stat(engine, "incr_merged") > 0, "increments queued behind the lock were merged");
+ 
+     // An increment that would overflow fails alone; the ones around it apply
+     int64_t result = 0;
+     engine.set("edge", std::to_string(INT64_MAX - 1));
+     check(engine.incr_by("edge", 1, result) == IncrStatus::OK && result == INT64_MAX, "INCR up to INT64_MAX");
+     check(engine.incr_by("edge", 1, result) == IncrStatus::OUT_OF_RANGE, "INCR past INT64_MAX is refused");
+     check(engine.incr_by("edge", -1, result) == IncrStatus::OK && result == INT64_MAX - 1, "INCR after an overflow");
+ }
+ 
+ // Keys of a reference set starting with a prefix
+ static std::vector<std::string> ref_prefix(const std::set<std::string>& keys, const std::string& prefix) {
+     std::vector<std::string> out;
+     for (const auto& key : keys) {
+         if (key.compare(0, prefix.size(), prefix) == 0) out.push_back(key);
+     }
+     return out;
+ }
+ 
+ // Keys of a reference set in [start, end), end empty meaning unbounded
+ static std::vector<std::string> ref_range(const std::set<std::string>& keys, const std::string& start,
+                                           const std::string& end) {
+     std::vector<std::string> out;
+     for (const auto& key : keys) {
+         if (key >= start && (end.empty() || key < end)) out.push_back(key);
+     }
+     return out;
+ }
+ 
+ // Compare PREFIX and RANGE of the engine with a reference set at prefixes
+ // and bounds taken from the keys themselves
+ static bool ordered_matches(StorageEngine& engine, const std::set<std::string>& keys) {
+     if (engine.keys_with_prefix("") != ref_prefix(keys, "")) return false;
+     size_t i = 0;
+     for (const auto& key : keys) {
+         if (i++ % 7) continue;
+         for (size_t len : {key.size() / 2, key.size()}) {
+             std::string prefix = key.substr(0, len);
+             if (engine.keys_with_prefix(prefix) != ref_prefix(keys, prefix)) return false;
+             if (engine.keys_in_range(prefix, "") != ref_range(keys, prefix, "")) return false;
+             std::string upper = prefix + "\xff";
+             if (engine.keys_in_range(prefix, upper) != ref_range(keys, prefix, upper)) return false;
+         }
+     }
+     return true;
+ }
+ 
+ // Fan-out under one node passes through every inner node layout (4, 16,
+ // 48 and 256 children) on the way up and again on the way down, and a
+ // random set of keys exercises path compression and its undoing
+ static void test_ordered_index_growth() {
+     EngineConfig config;
+     config.ordered_index = true;
+     StorageEngine engine(config);
+     std::set<std::string> keys;
+ 
+     const size_t steps[] = {1, 3, 4, 5, 15, 16, 17, 47, 48, 49, 255, 256};
+     size_t next = 0;
+     for (int b = 0; b < 256; b++) {
+         std::string key = std::string("fan:") + static_cast<char>(b);
+         engine.set(key, "v");
+         keys.insert(key);
+         if (next < std::size(steps) && keys.size() == steps[next]) {
+             check(ordered_matches(engine, keys), "ordered index after growing to " + std::to_string(keys.size()));
+             next++;
+         }
+     }
+     for (int b = 255; b >= 0; b -= 2) {
+         std::string key = std::string("fan:") + static_cast<char>(b);
+         engine.del(key);
+         keys.erase(key);
+         if (keys.size() % 16 == 0 || keys.size() < 6) {
+             check(ordered_matches(engine, keys), "ordered index after shrinking to " + std::to_string(keys.size()));
+         }
+     }
+     check(engine.del_prefix("fan:") == keys.size(), "DELPREFIX of the fan-out");
+     keys.clear();
+     check(engine.keys_with_prefix("").empty(), "fan-out deleted");
+ 
+     std::mt19937 rng(7);
+     for (int i = 0; i < 3000; i++) {
+         std::string key = "r";
+         size_t len = rng() % 12;
+         for (size_t j = 0; j < len; j++) key += "abcxyz"[rng() % 6];
+         engine.set(key, "v");
+         keys.insert(key);
+     }
+     check(ordered_matches(engine, keys), "ordered index of random keys");
+     for (const std::string prefix : {"rab", "rz", "rxyzx"}) {
+         size_t expected = ref_prefix(keys, prefix).size();
+         check(engine.del_prefix(prefix) == expected, "DELPREFIX " + prefix);
+         for (const auto& key : ref_prefix(keys, prefix)) keys.erase(key);
+         check(ordered_matches(engine, keys), "ordered index after DELPREFIX " + prefix);
+     }
+ }
+ 
+ // Keys that are prefixes of other keys end at inner nodes (their terminal
+ // slot), including the empty key at the root
+ static void test_ordered_index_prefix_keys() {
+     ArtIndex index;
+     const std::vector<std::string> keys = {"", "a", "ab", "abc", "abcd", "abd", "b", "ba"};
+     for (const auto& key : keys) index.insert(key);
+     check(!index.insert("ab"), "ART: duplicate insert");
+     check(index.size() == keys.size(), "ART: size");
+     auto collect_prefix = [&](const std::string& prefix) {
+         std::vector<std::string> out;
+         index.for_each_prefix(prefix, [&](const std::string& key) { out.push_back(key); return true; });
+         return out;
+     };
+     auto collect_range = [&](const std::string& start, const std::string& end) {
+         std::vector<std::string> out;
+         index.for_each_range(start, end, [&](const std::string& key) { out.push_back(key); return true; });
+         return out;
+     };
+     check(collect_prefix("") == keys, "ART: empty prefix lists every key in order");
+     check(collect_prefix("ab") == std::vector<std::string>({"ab", "abc", "abcd", "abd"}), "ART: prefix ab");
+     check(collect_prefix("abc") == std::vector<std::string>({"abc", "abcd"}), "ART: prefix that is a key");
+     check(collect_prefix("abcde").empty(), "ART: prefix longer than every key");
+     check(collect_range("", "ab") == std::vector<std::string>({"", "a"}), "ART: range from the empty key");
+     check(collect_range("ab", "abd") == std::vector<std::string>({"ab", "abc", "abcd"}), "ART: range over terminals");
+     check(index.contains("") && index.contains("abc") && !index.contains("abce"), "ART: contains");
+ 
+     check(index.erase("ab") && !index.contains("ab") && index.contains("abc"), "ART: erase a terminal key");
+     check(index.erase("") && collect_prefix("").front() == "a", "ART: erase the empty key");
+     check(!index.erase("ab"), "ART: erase a missing key");
+     for (const auto& key : keys) index.erase(key);
+     check(index.size() == 0 && collect_prefix("").empty() && collect_range("", "").empty(), "ART: deleted to empty");
+     index.insert("again");
+     check(collect_prefix("") == std::vector<std::string>({"again"}), "ART: usable after emptying");
+ 
+     EngineConfig config;
+     config.ordered_index = true;
+     StorageEngine engine(config);
+     for (const auto& key : {"a", "ab", "abc", "b"}) engine.set(key, "v");
+     check(engine.del_prefix("ab") == 2, "DELPREFIX of a key that prefixes another");
+     check(engine.keys_with_prefix("") == std::vector<std::string>({"a", "b"}), "DELPREFIX kept shorter keys");
+ }
+ 
+ // Empty, inverted and unbounded ranges, limits, and deleting everything
+ static void test_ordered_index_ranges() {
+     EngineConfig config;
+     config.ordered_index = true;
+     StorageEngine engine(config);
+     std::set<std::string> keys;
+     for (int i = 0; i < 100; i++) {
+         std::string key = "key:" + std::to_string(i);
+         engine.set(key, "v");
+         keys.insert(key);
+     }
+     check(engine.keys_in_range("key:5", "key:5").empty(), "empty range");
+     check(engine.keys_in_range("key:7", "key:3").empty(), "inverted range");
+     check(engine.keys_in_range("key:9", "") == ref_range(keys, "key:9", ""), "range unbounded above");
+     check(engine.keys_in_range("", "") == ref_range(keys, "", ""), "range unbounded on both sides");
+     check(engine.keys_in_range("", "key:2") == ref_range(keys, "", "key:2"), "range from the start");
+     check(engine.keys_in_range("zzz", "").empty(), "range past every key");
+     check(engine.keys_in_range("key:1", "key:2", 3) == std::vector<std::string>({"key:1", "key:10", "key:11"}),
+           "range with LIMIT");
+     check(engine.keys_with_prefix("key:9", 2) == std::vector<std::string>({"key:9", "key:90"}), "prefix with LIMIT");
+ 
+     check(engine.del_prefix("") == keys.size(), "DELPREFIX of everything");
+     check(engine.keys_in_range("", "").empty() && engine.keys_with_prefix("").empty(), "ordered index empty");
+     check(engine.get("key:1").empty(), "keys deleted from the table too");
+     engine.set("key:1", "v");
+     check(engine.keys_with_prefix("key") == std::vector<std::string>({"key:1"}), "ordered index usable after emptying");
+ }
+ 
+ // Every frozen key reads back from the perfect-hash tier, and keys that
+ // are not in it land on some slot too and must miss there
+ static void test_frozen_tier_lookup() {
+     std::vector<std::pair<std::string, std::string>> records;
+     for (int i = 0; i < 5000; i++) records.emplace_back("frozen:" + std::to_string(i), "value:" + std::to_string(i));
+     records.emplace_back("", "empty key");
+     FrozenTier tier(records);
+     check(tier.size() == records.size(), "frozen tier size");
+     bool found = true, missed = true;
+     std::string_view value;
+     for (const auto& record : records) found &= tier.find(record.first, value) && value == record.second;
+     for (int i = 0; i < 20000; i++) missed &= !tier.find("other:" + std::to_string(i), value);
+     missed &= !tier.find("frozen:5000", value) && !tier.find("frozen:1x", value);
+     check(found, "every frozen key is found with its value");
+     check(missed, "keys outside the tier miss");
+     check(!FrozenTier().find("frozen:1", value), "empty tier misses");
+ 
+     tier.erase("frozen:1");
+     check(!tier.find("frozen:1", value) && tier.find("frozen:2", value), "erase hides one key");
+ }
+ 
+ // FREEZE moves every matching key without a TTL; frozen keys read back
+ // unchanged, and unfrozen keys (present or missing) are unaffected
+ static void test_freeze_get() {
+     StorageEngine engine;
+     const int keys = 2000;
+     const std::string heap(100, 'h');
+     for (int i = 0; i < keys; i++) {
+         std::string id = std::to_string(i);
+         engine.set("ref:" + id, i % 3 == 0 ? id : i % 3 == 1 ? "short" + id : heap + id);
+     }
+     engine.set("ref:ttl", "v", std::chrono::seconds(100));
+     engine.set("other:1", "mutable");
+     size_t before = stat(engine, "used_memory");
+ 
+     check(engine.freeze("ref:*") == keys, "FREEZE skips keys with a TTL");
+     check(stat(engine, "frozen_keys") == keys && stat(engine, "keys") == keys + 2, "INFO counts frozen keys");
+     check(stat(engine, "used_memory") < before, "frozen keys no longer charged to used_memory");
+     bool intact = true;
+     for (int i = 0; i < keys; i++) {
+         std::string id = std::to_string(i);
+         intact &= engine.get("ref:" + id) == (i % 3 == 0 ? id : i % 3 == 1 ? "short" + id : heap + id);
+     }
+     check(intact, "GET of every frozen key");
+     check(engine.get("ref:ttl") == "v" && engine.get("other:1") == "mutable", "GET of unfrozen keys");
+     bool missing = true;
+     for (int i = keys; i < 4 * keys; i++) missing &= engine.get("ref:" + std::to_string(i)).empty();
+     check(missing, "GET of missing keys that hash onto frozen slots");
+     check(engine.freeze("nothing:*") == 0, "FREEZE without matches");
+ }
+ 
+ // Writing or deleting a frozen key hides it in the tier; a written key
+ // lives on in the hash table, and a second FREEZE keeps the tier's keys
+ static void test_freeze_overwrite() {
+     StorageEngine engine;
+     for (int i = 0; i < 100; i++) engine.set("k:" + std::to_string(i), "old");
+     engine.freeze();
+ 
+     check(engine.set("k:1", "new") && engine.get("k:1") == "new", "SET of a frozen key");
+     check(stat(engine, "frozen_keys") == 99 && stat(engine, "keys") == 100, "written key left the tier");
+     check(engine.del("k:2") && engine.get("k:2").empty() && !engine.del("k:2"), "DEL of a frozen key");
+     int64_t result = 0;
+     engine.set("k:3", "5");
+     engine.freeze("k:3");
+     check(engine.incr_by("k:3", 1, result) == IncrStatus::OK && result == 6, "INCR of a frozen counter");
+     check(stat(engine, "keys") == 99, "key count after overwrite and delete");
+ 
+     check(engine.freeze("k:1") == 1, "FREEZE of the overwritten key");
+     check(engine.get("k:1") == "new" && engine.get("k:50") == "old", "refrozen tier keeps earlier keys");
+     check(engine.get("k:2").empty(), "deleted key stays deleted after FREEZE");
+ }
+ 
+ // The tier is built outside the engine lock. A write that lands while it
+ // is being built must win: FREEZE may not install the value it copied
+ static void test_freeze_racing_write() {
+     StorageEngine engine;
+     const int keys = 100000;
+     for (int i = 0; i < keys; i++) engine.set("race:" + std::to_string(i), "0");
+     std::atomic<bool> done{false};
+     std::vector<int> last(keys, 0);
+     size_t writes = 0;
+     // One write per key, so no later write can paper over a stale freeze
+     std::thread writer([&] {
+         for (int i = 0; i < keys && !done.load(); i++) {
+             engine.set("race:" + std::to_string(i), "1");
+             last[i] = 1;
+             writes++;
+         }
+     });
+     std::this_thread::sleep_for(std::chrono::milliseconds(5));
+     size_t moved = engine.freeze("race:*");
+     done = true;
+     writer.join();
+ 
+     bool current = true;
+     for (int i = 0; i < keys; i++) current &= engine.get("race:" + std::to_string(i)) == std::to_string(last[i]);
+     check(writes > 0 && moved > 0, "FREEZE ran alongside writes");
+     check(current, "no key is frozen with a value older than its last write");
+     check(stat(engine, "keys") == keys, "key count after a racing FREEZE");
+ }
+ 
+ // DUMP and RESTORE carry every value encoding (integer, inline, heap and
+ // deduplicated shared buffers) and the remaining TTL
+ static void test_dump_restore_round_trip() {
+     EngineConfig config;
+     config.dedup = true;
+     StorageEngine source(config), target(config);
+     const std::vector<std::pair<std::string, std::string>> values = {
+         {"integer", "-9223372036854775808"}, {"small", "42"}, {"inline", "fifteen bytes.."},
+         {"heap", std::string(300, 'h')}, {"binary", std::string("a\0b\r\n", 5)}, {"empty", ""},
+     };
+     for (const auto& kv : values) source.set(kv.first, kv.second);
+     const std::string shared(200, 's');
+     source.set("shared:1", shared);
+     source.set("shared:2", shared);
+     check(stat(source, "dedup_saved_bytes") == shared.size(), "DUMP: value is shared");
+     source.set("ttl", "v", std::chrono::seconds(1000));
+ 
+     bool round_trip = true;
+     std::vector<std::string> names = {"shared:1", "shared:2", "ttl"};
+     for (const auto& kv : values) names.push_back(kv.first);
+     for (const auto& name : names) {
+         std::string payload;
+         if (!source.dump(name, payload) || target.restore(name, payload, false) != RestoreStatus::OK) {
+             round_trip = false;
+             continue;
+         }
+         round_trip &= target.get(name) == source.get(name);
+     }
+     check(round_trip, "DUMP/RESTORE round trip of every encoding");
+     check(stat(target, "dedup_saved_bytes") == shared.size(), "restored copies share one buffer again");
+ 
+     std::string payload;
+     DumpPayload reader;
+     DumpPayload::Record record;
+     check(target.dump("ttl", payload) && reader.open(payload) && reader.next(record) &&
+           record.ttl > std::chrono::seconds(990) && record.ttl <= std::chrono::seconds(1000),
+           "RESTORE keeps the remaining TTL");
+     check(target.dump("heap", payload) && reader.open(payload) && reader.next(record) &&
+           record.ttl == std::chrono::seconds::max(), "a key without TTL restores without one");
+     std::string missing;
+     check(!source.dump("missing", missing), "DUMP of a missing key");
+ 
+     size_t dumped = 0, restored = 0;
+     std::string blob = source.dump_keys(names, dumped);
+     StorageEngine bulk;
+     check(dumped == names.size() && bulk.restore_keys(blob, false, restored) == RestoreStatus::OK &&
+           restored == names.size(), "MDUMP/MRESTORE of every key");
+     bool same = true;
+     for (const auto& name : names) same &= bulk.get(name) == source.get(name);
+     check(same, "MRESTORE values");
+ }
+ 
+ // RESTORE refuses to overwrite without REPLACE, and refuses payloads that
+ // are truncated, corrupted or malformed under a valid checksum, changing
+ // nothing in each case
+ static void test_restore_rejects() {
+     StorageEngine engine;
+     std::string payload;
+     engine.set("src", std::string(100, 'x'));
+     engine.dump("src", payload);
+     engine.set("busy", "old");
+     check(engine.restore("busy", payload, false) == RestoreStatus::BUSY_KEY && engine.get("busy") == "old",
+           "RESTORE without REPLACE on an existing key");
+     check(engine.restore("busy", payload, true) == RestoreStatus::OK && engine.get("busy") == engine.get("src"),
+           "RESTORE REPLACE");
+ 
+     bool truncated = true, corrupted = true;
+     for (size_t len = 0; len < payload.size(); len++) {
+         truncated &= engine.restore("t", payload.substr(0, len), false) == RestoreStatus::BAD_PAYLOAD;
+     }
+     for (size_t i = 0; i < payload.size(); i++) {
+         std::string bad = payload;
+         bad[i] ^= 0x20;
+         corrupted &= engine.restore("c", bad, false) == RestoreStatus::BAD_PAYLOAD;
+     }
+     check(truncated, "truncated payloads are rejected");
+     check(corrupted, "payloads with a flipped byte are rejected");
+     check(engine.get("t").empty() && engine.get("c").empty(), "rejected payloads stored nothing");
+ 
+     // Valid checksum around a record whose length runs past the body
+     std::string forged;
+     DumpPayload::begin(forged, DumpPayload::SINGLE);
+     forged += std::string("\x00\x00\x64", 3) + "abc";
+     DumpPayload::finish(forged);
+     check(engine.restore("f", forged, false) == RestoreStatus::BAD_PAYLOAD, "record longer than the payload");
+ 
+     size_t dumped = 0, restored = 0;
+     std::string blob = engine.dump_keys({"src", "busy"}, dumped);
+     StorageEngine other;
+     other.set("busy", "kept");
+     check(other.restore_keys(blob, false, restored) == RestoreStatus::BUSY_KEY && other.get("src").empty() &&
+           other.get("busy") == "kept", "MRESTORE without REPLACE changes nothing if one key exists");
+     check(other.restore_keys(blob.substr(0, blob.size() - 1), true, restored) == RestoreStatus::BAD_PAYLOAD &&
+           other.get("src").empty(), "truncated MRESTORE changes nothing");
+     check(other.restore("x", blob, false) == RestoreStatus::BAD_PAYLOAD, "RESTORE of an MDUMP payload");
+ }
+ 
+ // Scalar reference of a bit read
+ static bool ref_bit(const std::string& bytes, size_t bit) {
+     return (static_cast<unsigned char>(bytes[bit / 8]) >> (7 - bit % 8)) & 1;
+ }
+ 
+ // The SSE2 popcount, byte search and AND/OR/XOR/NOT kernels against
+ // scalar loops, at lengths around and between multiples of the 16-byte
+ // vector width (and past the 31-vector flush of popcount)
+ static void test_bitmap_kernels() {
+     std::mt19937 rng(48);
+     std::vector<size_t> lengths;
+     for (size_t n = 0; n <= 70; n++) lengths.push_back(n);
+     for (size_t n : {495, 496, 497, 4095, 4096, 4097, 100003}) lengths.push_back(n);
+     bool popcount = true, count = true, find = true, combine = true;
+     for (size_t n : lengths) {
+         for (int density : {0, 1, 50, 99, 100}) {
+             std::string a(n, '\0'), b(n, '\0');
+             for (size_t i = 0; i < n * 8; i++) {
+                 if (static_cast<int>(rng() % 100) < density) a[i / 8] |= static_cast<char>(0x80 >> (i % 8));
+             }
+             for (auto& c : b) c = static_cast<char>(rng());
+             const auto* data = reinterpret_cast<const unsigned char*>(a.data());
+ 
+             size_t expected = 0;
+             for (size_t i = 0; i < n * 8; i++) expected += ref_bit(a, i);
+             popcount &= Bitmap::popcount(data, n) == expected;
+ 
+             for (int trial = 0; n > 0 && trial < 4; trial++) {
+                 size_t first = rng() % (n * 8), last = first + rng() % (n * 8 - first);
+                 size_t set = 0;
+                 int64_t first_one = -1, first_zero = -1;
+                 for (size_t i = first; i <= last; i++) {
+                     set += ref_bit(a, i);
+                     if (first_one < 0 && ref_bit(a, i)) first_one = static_cast<int64_t>(i);
+                     if (first_zero < 0 && !ref_bit(a, i)) first_zero = static_cast<int64_t>(i);
+                 }
+                 count &= Bitmap::count(data, first, last) == set;
+                 find &= Bitmap::find(data, first, last, true) == first_one;
+                 find &= Bitmap::find(data, first, last, false) == first_zero;
+             }
+ 
+             for (Bitmap::Op op : {Bitmap::Op::AND, Bitmap::Op::OR, Bitmap::Op::XOR, Bitmap::Op::NOT}) {
+                 std::string out = a, ref = a;
+                 Bitmap::combine(op, reinterpret_cast<unsigned char*>(&out[0]),
+                                 reinterpret_cast<const unsigned char*>(b.data()), n);
+                 for (size_t i = 0; i < n; i++) {
+                     if (op == Bitmap::Op::AND) ref[i] = static_cast<char>(a[i] & b[i]);
+                     else if (op == Bitmap::Op::OR) ref[i] = static_cast<char>(a[i] | b[i]);
+                     else if (op == Bitmap::Op::XOR) ref[i] = static_cast<char>(a[i] ^ b[i]);
+                     else ref[i] = static_cast<char>(~b[i]);
+                 }
+                 combine &= out == ref;
+             }
+         }
+     }
+     check(popcount, "SIMD popcount matches the scalar count");
+     check(count, "bit-range count matches the scalar count");
+     check(find, "bit search matches the scalar search");
+     check(combine, "AND/OR/XOR/NOT kernels match the scalar loops");
+ }
+ 
+ // BITPOS at the edges of a value and its ranges, and on values of only
+ // zeros or only ones, where the clear-bit search may run past the end
+ static void test_bitpos_edges() {
+     StorageEngine engine;
+     std::string zeros(37, '\0'), ones(37, '\xff');
+     engine.set("zeros", zeros);
+     engine.set("ones", ones);
+     std::string edges(37, '\0');
+     edges[0] = '\x80';
+     edges[36] = '\x01';
+     engine.set("edges", edges);
+ 
+     check(engine.bitpos("zeros", true) == -1, "BITPOS 1 of zeros");
+     check(engine.bitpos("zeros", false) == 0, "BITPOS 0 of zeros");
+     check(engine.bitpos("ones", true) == 0, "BITPOS 1 of ones");
+     check(engine.bitpos("ones", false) == 37 * 8, "BITPOS 0 of ones without end is past the value");
+     check(engine.bitpos("ones", false, 0, -1, true) == -1, "BITPOS 0 of ones with an end");
+     check(engine.bitpos("ones", false, 0, 0, true, true) == -1 && engine.bitpos("ones", false, 5, -1, true) == -1,
+           "BITPOS 0 of ones in a range");
+     check(engine.bitpos("missing", false) == 0 && engine.bitpos("missing", true) == -1, "BITPOS of a missing key");
+ 
+     check(engine.bitpos("edges", true) == 0, "BITPOS of the first bit");
+     check(engine.bitpos("edges", true, 1) == 36 * 8 + 7, "BITPOS of the last bit");
+     check(engine.bitpos("edges", true, -1) == 36 * 8 + 7, "BITPOS from the last byte");
+     check(engine.bitpos("edges", true, 1, 35) == -1, "BITPOS 1 in the zero middle");
+     check(engine.bitpos("edges", true, 1, 36 * 8 + 7, true, true) == 36 * 8 + 7, "BITPOS in bit units up to the last bit");
+     check(engine.bitpos("edges", true, 1, 36 * 8 + 6, true, true) == -1, "BITPOS in bit units stopping before it");
+     check(engine.bitpos("edges", false, 0, 0, true, true) == -1 && engine.bitpos("edges", false, 0, 1, true, true) == 1,
+           "BITPOS 0 next to the first bit");
+     check(engine.bitcount("edges") == 2 && engine.bitcount("edges", -1, -1) == 1 && engine.bitcount("ones", 0, -1) == 37 * 8,
+           "BITCOUNT of edges and ones");
+ 
+     size_t length = 0;
+     check(engine.bitop(Bitmap::Op::NOT, "inverted", {"edges"}, length) && length == 37, "BITOP NOT");
+     check(engine.bitcount("inverted") == 37 * 8 - 2 && engine.bitpos("inverted", false) == 0, "BITOP NOT result");
+     engine.set("short", "\xff");
+     check(engine.bitop(Bitmap::Op::AND, "and", {"ones", "short"}, length) && length == 37 && engine.bitcount("and") == 8,
+           "BITOP AND clears past a shorter source");
+     check(engine.bitop(Bitmap::Op::XOR, "xor", {"short", "ones"}, length) && engine.bitcount("xor") == 36 * 8,
+           "BITOP XOR with a longer source");
+ }
+ 
+ // A filter never forgets an added element, and its false positive rate
+ // at the reserved capacity stays near the configured one, both through
+ // the batched (BF.MADD/BF.MEXISTS) and the single-element paths
+ static void test_bloom_accuracy() {
+     StorageEngine engine;
+     const size_t capacity = 20000;
+     check(engine.bf_reserve("bf", 0.01, capacity) == BloomStatus::OK, "BF.RESERVE");
+     check(engine.bf_reserve("bf", 0.01, capacity) == BloomStatus::EXISTS, "BF.RESERVE of an existing key");
+     std::vector<std::string> batch;
+     std::vector<bool> added, found;
+     for (size_t i = 0; i < capacity; i++) {
+         batch.push_back("member:" + std::to_string(i));
+         if (batch.size() == 1000 || i % 7 == 0) {
+             check(engine.bf_add("bf", batch, added) == BloomStatus::OK, "BF.MADD");
+             batch.clear();
+         }
+     }
+     if (!batch.empty()) engine.bf_add("bf", batch, added);
+ 
+     size_t negatives = 0;
+     std::vector<std::string> members;
+     for (size_t i = 0; i < capacity; i++) members.push_back("member:" + std::to_string(i));
+     engine.bf_exists("bf", members, found);
+     for (bool f : found) negatives += !f;
+     for (size_t i = 0; i < capacity; i += 97) {
+         engine.bf_exists("bf", {members[i]}, found);
+         negatives += !found[0];
+     }
+     check(negatives == 0, "no false negatives");
+ 
+     const size_t probes = 200000;
+     std::vector<std::string> others;
+     for (size_t i = 0; i < probes; i++) others.push_back("other:" + std::to_string(i));
+     engine.bf_exists("bf", others, found);
+     size_t positives = 0;
+     for (bool f : found) positives += f;
+     double rate = static_cast<double>(positives) / probes;
+     check(rate > 0.002 && rate < 0.015, "false positive rate near 1% at capacity (got " + std::to_string(rate) + ")");
+ 
+     check(engine.bf_add("small", {"x"}, added) == BloomStatus::OK && added[0], "BF.ADD creates a default filter");
+     check(engine.bf_exists("small", {"x", "y"}, found) == BloomStatus::OK && found[0], "default filter lookup");
+     engine.set("text", "not a filter");
+     check(engine.bf_exists("text", {"x"}, found) == BloomStatus::WRONGTYPE, "BF.EXISTS of a string");
+ }
+ 
+ // BF.EXISTS does not write: a filter copied to a new buffer (whose blocks
+ // are then off cache-line boundaries) keeps its bytes and version, and a
+ // restored filter answers like the original
+ static void test_bloom_exists_read_only() {
+     StorageEngine engine;
+     engine.bf_reserve("bf", 0.01, 1000);
+     std::vector<bool> added, found;
+     std::vector<std::string> elements;
+     for (int i = 0; i < 500; i++) elements.push_back("e" + std::to_string(i));
+     engine.bf_add("bf", elements, added);
+     const std::string bytes = engine.get("bf");
+ 
+     bool unchanged = true, answers = true;
+     for (int i = 0; i < 16; i++) {
+         std::string key = "copy:" + std::to_string(i);
+         engine.set(key, bytes);
+         std::string before, after;
+         uint64_t version_before = 0, version_after = 0;
+         engine.get_versioned(key, before, version_before);
+         answers &= engine.bf_exists(key, elements, found) == BloomStatus::OK &&
+                    std::find(found.begin(), found.end(), false) == found.end();
+         engine.get_versioned(key, after, version_after);
+         unchanged &= before == after && version_before == version_after;
+     }
+     check(answers, "copied filters keep every element");
+     check(unchanged, "BF.EXISTS leaves the value and version unchanged");
+ 
+     std::string payload;
+     engine.dump("bf", payload);
+     check(engine.restore("restored", payload, false) == RestoreStatus::OK &&
+           engine.bf_exists("restored", elements, found) == BloomStatus::OK &&
+           std::find(found.begin(), found.end(), false) == found.end(), "restored filter keeps every element");
+     check(engine.bf_add("copy:0", {"new"}, added) == BloomStatus::OK && added[0] &&
+           engine.bf_exists("copy:0", elements, found) == BloomStatus::OK &&
+           std::find(found.begin(), found.end(), false) == found.end(), "BF.ADD realigns a moved filter");
+ }
+ 
+ int main() {
+     test_hostile_hll();
+     test_expired_writes();
+     test_lazy_free_backlog();
+     test_shared_budget();
+     test_scan_across_freeze();
+     test_lease_memory();
+     test_tag_charge();
+     test_incr_combining();
+     test_ordered_index_growth();
+     test_ordered_index_prefix_keys();
+     test_ordered_index_ranges();
+     test_frozen_tier_lookup();
+     test_freeze_get();
+     test_freeze_overwrite();
+     test_freeze_racing_write();
+     test_dump_restore_round_trip();
+     test_restore_rejects();
+     test_bitmap_kernels();
+     test_bitpos_edges();
+     test_bloom_accuracy();
+     test_bloom_exists_read_only();
+ 
+     if (failures) {
+         std::cout << failures << " check(s) failed\n";
+         return 1;
+     }
+     std::cout << "All engine tests passed\n";
+     return 0;
+ }
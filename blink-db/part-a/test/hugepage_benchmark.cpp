@@ -0,0 +1,56 @@
+ /**
+ * @file hugepage_benchmark.cpp
+ * @brief Random-lookup benchmark of the HashTable bucket array page backing
+ */
+
+ #include "HashTable.h"
+ #include <iostream>
+ #include <string>
+ #include <vector>
+ #include <chrono>
+ #include <random>
+ #include <iomanip>
+ 
+ // Insert num_keys keys, then time random successful lookups
+ double run(HugePageMode mode, size_t num_keys, size_t num_lookups, HugePageMode& actual) {
+     HashTable<uint64_t, uint64_t> table(num_keys * 2, mode);
+     actual = table.get_page_mode();
+     for (uint64_t k = 0; k < num_keys; k++) {
+         table.insert(k * 0x9E3779B97F4A7C15ULL, k);
+     }
+ 
+     std::mt19937_64 gen(42);
+     std::uniform_int_distribution<uint64_t> key_dist(0, num_keys - 1);
+     std::vector<uint64_t> probes(num_lookups);
+     for (auto& p : probes) p = key_dist(gen) * 0x9E3779B97F4A7C15ULL;
+ 
+     uint64_t sink = 0;
+     auto start = std::chrono::high_resolution_clock::now();
+     for (uint64_t p : probes) {
+         uint64_t v = 0;
+         table.get(p, v);
+         sink += v;
+     }
+     auto end = std::chrono::high_resolution_clock::now();
+     // Make the sum an input of the asm so the lookups cannot be dropped
+     asm volatile("" : : "r"(sink) : "memory");
+     return std::chrono::duration<double, std::nano>(end - start).count() / num_lookups;
+ }
+ 
+ int main(int argc, char* argv[]) {
+     size_t num_keys = argc > 1 ? std::stoull(argv[1]) : 10000000;
+     size_t num_lookups = 10000000;
+     const char* names[] = {"off", "thp", "hugetlb"};
+ 
+     std::cout << "======== HASH TABLE PAGE BACKING BENCHMARK ========\n";
+     std::cout << "Keys: " << num_keys << ", random lookups: " << num_lookups << "\n\n";
+     std::cout << "Mode (actual)          ns/lookup\n";
+     for (HugePageMode mode : {HugePageMode::OFF, HugePageMode::THP, HugePageMode::HUGETLB}) {
+         HugePageMode actual = mode;
+         double ns = run(mode, num_keys, num_lookups, actual);
+         std::cout << std::left << std::setw(8) << names[static_cast<int>(mode)]
+                   << "(" << std::setw(8) << names[static_cast<int>(actual)] << ")      "
+                   << std::fixed << std::setprecision(1) << ns << "\n";
+     }
+     return 0;
+ }
@@ -8,6 +8,7 @@
  */
 
  #include "client.h"
+ #include "resp.h"
  #include <sys/socket.h>
  #include <arpa/inet.h>
  #include <unistd.h>
@@ -20,6 +21,43 @@
  /** Maximum receive buffer size */
  const size_t MAX_BUFFER_SIZE = 65536; // 64KB
  
+ /**
+  * @brief Format a parsed RESP array as numbered lines
+  * 
+  * @param value Parsed array value
+  * @param indent Indentation for nested arrays
+  * @return Human-readable listing ("(empty array)" if there are no elements)
+  */
+ static std::string format_array(const RespProtocol::RespValue& value, const std::string& indent = "") {
+     const auto& elements = value.getArray();
+     if (elements.empty()) {
+         return indent + "(empty array)";
+     }
+     
+     std::string result;
+     for (size_t i = 0; i < elements.size(); i++) {
+         const auto& element = elements[i];
+         if (i > 0) result += "\n";
+         result += indent + std::to_string(i + 1) + ") ";
+         
+         switch (element.getType()) {
+             case RespProtocol::Type::INTEGER:
+                 result += std::to_string(element.getInteger());
+                 break;
+             case RespProtocol::Type::ERROR:
+                 result += "Error: " + element.getString();
+                 break;
+             case RespProtocol::Type::ARRAY:
+                 result += element.isNull() ? "NULL" : "\n" + format_array(element, indent + "   ");
+                 break;
+             default:
+                 result += element.isNull() ? "NULL" : element.getString();
+                 break;
+         }
+     }
+     return result;
+ }
+ 
  /**
   * @brief Construct a new Client object
   * 
@@ -268,9 +306,16 @@
                  return "NULL"; // Null array
              }
              
-             // This is a simplified array decoder for basic use cases
-             // In a real implementation, you would recursively decode each element
-             return "(Array with " + std::to_string(count) + " elements)";
+             try {
+                 size_t consumed = 0;
+                 auto value = RespProtocol::parse(resp_data, consumed);
+                 if (!value) {
+                     return "(Array with " + std::to_string(count) + " elements, truncated)";
+                 }
+                 return format_array(*value);
+             } catch (const std::exception& e) {
+                 return "Error: Invalid RESP array";
+             }
          }
              
          default:
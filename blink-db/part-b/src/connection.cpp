@@ -42,9 +42,11 @@
  /**
   * @brief Destroys the Connection object
   * 
-  * @details Closes the socket file descriptor if it's still open
+  * @details Releases the connection's WATCHes and closes the socket file
+  * descriptor if it's still open
   */
  Connection::~Connection() {
+     unwatch_all();
      if (fd_ >= 0) {
          close(fd_);
          fd_ = -1;
@@ -288,8 +290,7 @@
                  
                  // Execute command
                  std::vector<std::string> command_args(args.begin() + 1, args.end());
-                 std::string response = server_->execute_command(command, command_args);
-                 add_response(response);
+                 add_response(dispatch(command, command_args));
              }
              
              // Remove processed command from input buffer
@@ -304,6 +305,94 @@
      return true;
  }
  
+ /**
+  * @brief Executes one command, handling MULTI/EXEC/DISCARD/WATCH/UNWATCH/SELECT
+  * 
+  * @details Transaction state lives in the connection: queued commands are
+  * only handed to the server at EXEC, which runs them as one batch under the
+  * storage engine lock and returns a single aggregated reply. So does the
+  * selected keyspace, passed to the server with every command; SELECT is
+  * refused inside MULTI so that a transaction runs in a single keyspace, and
+  * SWAPDB and FLUSHDB abort it, since they would replace that keyspace
+  * while EXEC holds its lock.
+  * 
+  * @param command Command name in upper case
+  * @param args Command arguments (moved into the queue inside MULTI)
+  * @return RESP-formatted response
+  */
+ std::string Connection::dispatch(const std::string& command, std::vector<std::string>& args) {
+     if (command == "MULTI") {
+         if (in_multi_) return "-ERR MULTI calls can not be nested\r\n";
+         in_multi_ = true;
+         return "+OK\r\n";
+     }
+     if (command == "EXEC") {
+         if (!in_multi_) return "-ERR EXEC without MULTI\r\n";
+         std::string response = multi_failed_
+             ? "-EXECABORT Transaction discarded because of previous errors.\r\n"
+             : server_->execute_transaction(db_, queued_, watched_);
+         in_multi_ = false;
+         multi_failed_ = false;
+         queued_.clear();
+         unwatch_all();
+         return response;
+     }
+     if (command == "DISCARD") {
+         if (!in_multi_) return "-ERR DISCARD without MULTI\r\n";
+         in_multi_ = false;
+         multi_failed_ = false;
+         queued_.clear();
+         unwatch_all();
+         return "+OK\r\n";
+     }
+     if (command == "WATCH") {
+         if (in_multi_) return "-ERR WATCH inside MULTI is not allowed\r\n";
+         if (args.empty()) return "-ERR wrong number of arguments for 'watch' command\r\n";
+         for (const auto& key : args) {
+             bool already = std::any_of(watched_.begin(), watched_.end(),
+                                        [&](const auto& w) { return w.db == db_ && w.key == key; });
+             if (!already) watched_.push_back(server_->watch(db_, key));
+         }
+         return "+OK\r\n";
+     }
+     if (command == "UNWATCH") {
+         unwatch_all();
+         return "+OK\r\n";
+     }
+     if (command == "SELECT") {
+         if (in_multi_) return "-ERR SELECT inside MULTI is not allowed\r\n";
+         if (args.size() != 1) return "-ERR wrong number of arguments for 'select' command\r\n";
+         if (!server_->parse_db(args[0], db_)) return "-ERR DB index is out of range\r\n";
+         return "+OK\r\n";
+     }
+ 
+     if (in_multi_) {
+         if (!server_->has_command(command)) {
+             multi_failed_ = true;
+             return "-ERR unknown command '" + command + "'\r\n";
+         }
+         // EXEC locks only the transaction's keyspace: swapping or
+         // detaching it midway would run the rest unlocked elsewhere
+         if (command == "SWAPDB" || command == "FLUSHDB") {
+             multi_failed_ = true;
+             return "-ERR " + command + " inside MULTI is not allowed\r\n";
+         }
+         queued_.emplace_back(command, std::move(args));
+         return "+QUEUED\r\n";
+     }
+     return server_->execute_command(db_, command, args);
+ }
+ 
+ /**
+  * @brief Releases every key WATCHed by this connection
+  */
+ void Connection::unwatch_all() {
+     for (const auto& watched : watched_) {
+         server_->unwatch(watched);
+     }
+     watched_.clear();
+ }
+ 
  /**
   * @brief Updates the last activity timestamp
   * 
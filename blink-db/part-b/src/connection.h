@@ -14,10 +14,25 @@
  #include <vector>
  #include <deque>
  #include <chrono>
+ #include <cstdint>
+ #include <utility>
+ #include <memory>
  
  // Forward declarations
  class Server;
  class RespProtocol;
+ class StorageEngine;
+ 
+ /**
+  * @struct WatchedKey
+  * @brief WATCHed key, the keyspace it was watched in and its modification count
+  */
+ struct WatchedKey {
+     size_t db;                             ///< Keyspace number at WATCH time
+     std::weak_ptr<StorageEngine> engine;   ///< Keyspace that held the key (detects SWAPDB/FLUSHDB)
+     std::string key;                       ///< Watched key
+     uint64_t touches;                      ///< Modification count when WATCH was issued
+ };
  
  /**
   * @class Connection
@@ -144,6 +159,11 @@
      std::string input_buffer_;                ///< Buffer for incoming data
      std::deque<std::string> output_queue_;    ///< Queue of pending responses
      std::chrono::steady_clock::time_point last_activity_; ///< Last activity timestamp
+     bool in_multi_ = false;                   ///< Between MULTI and EXEC/DISCARD
+     bool multi_failed_ = false;               ///< A command was rejected while queueing
+     std::vector<std::pair<std::string, std::vector<std::string>>> queued_; ///< Commands queued by MULTI
+     std::vector<WatchedKey> watched_;         ///< WATCHed keys and their counts
+     size_t db_ = 0;                           ///< Keyspace chosen with SELECT
      
      /**
       * @brief Process any complete commands in input buffer
@@ -155,6 +175,27 @@
       * @return true on success, false on protocol error
       */
      bool process_commands();
+ 
+     /**
+      * @brief Execute one parsed command, handling transaction state
+      * 
+      * @details MULTI, EXEC, DISCARD, WATCH, UNWATCH and SELECT are handled
+      * here since they act on per-connection state. Between MULTI and EXEC other commands
+      * are queued (replying +QUEUED) instead of executed; unknown commands
+      * are rejected immediately and make EXEC abort.
+      * 
+      * @param command Command name in upper case
+      * @param args Command arguments
+      * @return Response string in RESP format
+      */
+     std::string dispatch(const std::string& command, std::vector<std::string>& args);
+ 
+     /**
+      * @brief Drop every WATCH of this connection
+      * 
+      * @details Called by EXEC, DISCARD, UNWATCH and on disconnect
+      */
+     void unwatch_all();
      
      /**
       * @brief Update last activity timestamp
@@ -14,9 +14,13 @@
  */
 
  #include "server.h"
+ #include "numa.h"
+ #include "MemoryStats.h"
  #include <iostream>
  #include <csignal>
  #include <cstring>
+ #include <algorithm>
+ #include <cctype>
  
  /** @brief Global server instance for signal handling */
  Server* g_server = nullptr;
@@ -37,6 +41,32 @@
      }
  }
  
+ /**
+  * @brief Parse a memory size such as "512mb", "2g" or "1048576"
+  * 
+  * @param text Size text; a k, m or g suffix (optionally followed by b) scales by 1024
+  * @param[out] bytes Parsed size in bytes
+  * @return true if the text is a positive size
+  */
+ bool parse_memory_size(const std::string& text, size_t& bytes) {
+     size_t pos = 0;
+     unsigned long long value = 0;
+     try {
+         value = std::stoull(text, &pos);
+     } catch (const std::exception& e) {
+         return false;
+     }
+     std::string unit = text.substr(pos);
+     for (auto& c : unit) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+     if (unit == "k" || unit == "kb") value <<= 10;
+     else if (unit == "m" || unit == "mb") value <<= 20;
+     else if (unit == "g" || unit == "gb") value <<= 30;
+     else if (!unit.empty() && unit != "b") return false;
+     if (value == 0) return false;
+     bytes = static_cast<size_t>(value);
+     return true;
+ }
+ 
  /**
   * @brief Print usage information
   * 
@@ -50,6 +80,29 @@
      std::cout << "Options:" << std::endl;
      std::cout << "  -p, --port PORT     Server port (default: 9001)" << std::endl;
      std::cout << "  -c, --connections N Max connections (default: 1024)" << std::endl;
+     std::cout << "  --databases N       Number of keyspaces selectable with SELECT (default: 16)" << std::endl;
+     std::cout << "  --maxmemory BYTES   Memory limit for keys and values of all keyspaces together," << std::endl;
+     std::cout << "                      accepts k/m/g suffixes (default: 1g)" << std::endl;
+     std::cout << "  --maxmemory-policy P Eviction policy: noeviction, allkeys-lru, volatile-lru," << std::endl;
+     std::cout << "                      volatile-ttl, allkeys-random, allkeys-lfu (default: allkeys-lru)" << std::endl;
+     std::cout << "  --lfu-decay-time MIN Idle minutes that take one access off an allkeys-lfu count (default: 1, 0 = never)" << std::endl;
+     std::cout << "  --maxmemory-high PCT Start background eviction above PCT% of maxmemory (default: 90)" << std::endl;
+     std::cout << "  --maxmemory-low PCT Stop background eviction at PCT% of maxmemory (default: 80)" << std::endl;
+     std::cout << "  --maxmemory-cgroup PCT Shrink maxmemory to fit the cgroup v2 memory limit: keep the" << std::endl;
+     std::cout << "                      cgroup below PCT% of it and back off under memory pressure" << std::endl;
+     std::cout << "  --lazyfree          Free evicted and expired values on a background thread" << std::endl;
+     std::cout << "  --dedup             Store identical values once, shared between keys" << std::endl;
+     std::cout << "  --dedup-min-size BYTES Shortest value that is deduplicated (default: 64)" << std::endl;
+     std::cout << "  --lease-timeout SEC Lifetime of an unfulfilled GETL lease (default: 10)" << std::endl;
+     std::cout << "  --lease-grace SEC   Serve expired values as stale to GETL for SEC seconds (default: 0)" << std::endl;
+     std::cout << "  --maintenance-budget US  Per-run time budget of expiry, eviction and rehash (default: 1000)" << std::endl;
+     std::cout << "  --load-dir DIR      Let LOAD read files from DIR (LOAD is disabled without it)" << std::endl;
+     std::cout << "  --ordered-index     Maintain an ordered key index (enables PREFIX, RANGE, DELPREFIX)" << std::endl;
+     std::cout << "  --active-defrag     Incrementally defragment memory in the background" << std::endl;
+     std::cout << "  --defrag-cpu PCT    CPU budget of the defragmenter in percent (default: 10)" << std::endl;
+     std::cout << "  --huge-pages MODE   Back the hash table with 2MB pages: off, thp, hugetlb (default: off)" << std::endl;
+     std::cout << "  --numa-node N       Bind memory to NUMA node N and pin threads to its CPUs" << std::endl;
+     std::cout << "  --cpus LIST         Pin threads to CPUs, e.g. 0-3,8 (overrides the node's CPUs)" << std::endl;
      std::cout << "  -h, --help          Show this help message" << std::endl;
  }
  
@@ -63,6 +116,19 @@
   * Server configuration can be customized through command-line options including:
   * - Port number (-p, --port)
   * - Maximum concurrent connections (-c, --connections)
+  * - Number of keyspaces (--databases)
+  * - Memory limit and eviction policy (--maxmemory, --maxmemory-policy, --lfu-decay-time)
+  * - Background eviction watermarks (--maxmemory-high, --maxmemory-low)
+  * - Sizing to the container's cgroup v2 memory limit (--maxmemory-cgroup)
+  * - Background freeing of evicted and expired values (--lazyfree)
+  * - Deduplication of identical values (--dedup, --dedup-min-size)
+  * - GETL lease lifetime and stale-value grace period (--lease-timeout, --lease-grace)
+  * - Time budget of background maintenance tasks (--maintenance-budget)
+  * - Directory of files clients may LOAD (--load-dir)
+  * - Ordered key index for prefix/range queries (--ordered-index)
+  * - Active defragmentation and its CPU budget (--active-defrag, --defrag-cpu)
+  * - Huge page backing of the hash table (--huge-pages)
+  * - NUMA memory binding and CPU pinning (--numa-node, --cpus)
   * 
   * @param argc Number of command-line arguments
   * @param argv Array of command-line argument strings
@@ -72,6 +138,11 @@
      // Default settings
      int port = 9001;
      int max_connections = 1024;
+     int databases = 16;
+     EngineConfig engine_config;
+     int numa_node = -1;
+     std::vector<int> cpus;
+     std::string load_dir;
  
      // Parse command line arguments
      for (int i = 1; i < argc; i++) {
@@ -101,6 +172,227 @@
                  std::cerr << "Connection count required" << std::endl;
                  return 1;
              }
+         } else if (arg == "--databases") {
+             if (i + 1 < argc) {
+                 try {
+                     databases = std::stoi(argv[++i]);
+                     if (databases < 1 || databases > 65536) throw std::out_of_range("databases");
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid database count (1-65536)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Database count required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--maxmemory") {
+             if (i + 1 < argc) {
+                 if (!parse_memory_size(argv[++i], engine_config.max_memory)) {
+                     std::cerr << "Invalid memory size" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Memory size required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--maxmemory-policy") {
+             if (i + 1 < argc) {
+                 if (!MemoryManager::parse_policy(argv[++i], engine_config.eviction_policy)) {
+                     std::cerr << "Invalid eviction policy" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Eviction policy required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--lfu-decay-time") {
+             if (i + 1 < argc) {
+                 try {
+                     int minutes = std::stoi(argv[++i]);
+                     if (minutes < 0) throw std::out_of_range("lfu-decay-time");
+                     engine_config.lfu_decay_minutes = static_cast<unsigned>(minutes);
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid LFU decay time (minutes, 0 or more)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "LFU decay time required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--maxmemory-high") {
+             if (i + 1 < argc) {
+                 try {
+                     int pct = std::stoi(argv[++i]);
+                     if (pct < 1 || pct > 100) throw std::out_of_range("maxmemory-high");
+                     engine_config.evict_high_pct = static_cast<unsigned>(pct);
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid high watermark percentage (1-100)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "High watermark percentage required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--maxmemory-low") {
+             if (i + 1 < argc) {
+                 try {
+                     int pct = std::stoi(argv[++i]);
+                     if (pct < 1 || pct > 100) throw std::out_of_range("maxmemory-low");
+                     engine_config.evict_low_pct = static_cast<unsigned>(pct);
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid low watermark percentage (1-100)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Low watermark percentage required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--maxmemory-cgroup") {
+             if (i + 1 < argc) {
+                 try {
+                     int pct = std::stoi(argv[++i]);
+                     if (pct < 1 || pct > 100) throw std::out_of_range("maxmemory-cgroup");
+                     engine_config.cgroup_memory = true;
+                     engine_config.cgroup_memory_pct = static_cast<unsigned>(pct);
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid cgroup memory percentage (1-100)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Cgroup memory percentage required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--lazyfree") {
+             engine_config.lazy_free = true;
+         } else if (arg == "--dedup") {
+             engine_config.dedup = true;
+         } else if (arg == "--lease-timeout") {
+             if (i + 1 < argc) {
+                 try {
+                     int seconds = std::stoi(argv[++i]);
+                     if (seconds < 1 || seconds > 86400) throw std::out_of_range("lease-timeout");
+                     engine_config.lease_timeout_s = static_cast<unsigned>(seconds);
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid lease timeout (1-86400 seconds)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Lease timeout required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--lease-grace") {
+             if (i + 1 < argc) {
+                 try {
+                     int seconds = std::stoi(argv[++i]);
+                     if (seconds < 0 || seconds > 86400) throw std::out_of_range("lease-grace");
+                     engine_config.lease_grace_s = static_cast<unsigned>(seconds);
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid lease grace period (0-86400 seconds)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Lease grace period required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--dedup-min-size") {
+             if (i + 1 < argc) {
+                 try {
+                     int bytes = std::stoi(argv[++i]);
+                     if (bytes < 16 || bytes > 1048576) throw std::out_of_range("dedup-min-size");
+                     engine_config.dedup_min_bytes = static_cast<size_t>(bytes);
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid dedup minimum size (16-1048576 bytes)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Dedup minimum size required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--maintenance-budget") {
+             if (i + 1 < argc) {
+                 try {
+                     int us = std::stoi(argv[++i]);
+                     if (us < 10 || us > 100000) throw std::out_of_range("maintenance-budget");
+                     engine_config.maintenance_budget_us = static_cast<size_t>(us);
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid maintenance budget (10-100000 microseconds)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Maintenance budget required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--load-dir") {
+             if (i + 1 < argc) {
+                 load_dir = argv[++i];
+             } else {
+                 std::cerr << "Load directory required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--ordered-index") {
+             engine_config.ordered_index = true;
+         } else if (arg == "--active-defrag") {
+             engine_config.active_defrag = true;
+         } else if (arg == "--defrag-cpu") {
+             if (i + 1 < argc) {
+                 try {
+                     int pct = std::stoi(argv[++i]);
+                     if (pct < 1 || pct > 100) throw std::out_of_range("defrag-cpu");
+                     engine_config.defrag_cpu_pct = static_cast<unsigned>(pct);
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid defrag CPU percentage (1-100)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Defrag CPU percentage required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--huge-pages") {
+             if (i + 1 < argc) {
+                 std::string mode = argv[++i];
+                 if (mode == "off") {
+                     engine_config.huge_pages = HugePageMode::OFF;
+                 } else if (mode == "thp") {
+                     engine_config.huge_pages = HugePageMode::THP;
+                 } else if (mode == "hugetlb") {
+                     engine_config.huge_pages = HugePageMode::HUGETLB;
+                 } else {
+                     std::cerr << "Invalid huge page mode (off, thp, hugetlb)" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "Huge page mode required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--numa-node") {
+             if (i + 1 < argc) {
+                 try {
+                     numa_node = std::stoi(argv[++i]);
+                 } catch (const std::exception& e) {
+                     std::cerr << "Invalid NUMA node" << std::endl;
+                     return 1;
+                 }
+                 std::vector<int> nodes = Numa::online_nodes();
+                 if (std::find(nodes.begin(), nodes.end(), numa_node) == nodes.end()) {
+                     std::cerr << "NUMA node " << numa_node << " is not online (online: "
+                               << Numa::format_list(nodes) << ")" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "NUMA node required" << std::endl;
+                 return 1;
+             }
+         } else if (arg == "--cpus") {
+             if (i + 1 < argc) {
+                 cpus = Numa::parse_list(argv[++i], Numa::cpu_count());
+                 if (cpus.empty()) {
+                     std::cerr << "Invalid CPU list (CPUs 0-" << Numa::cpu_count() - 1 << ")" << std::endl;
+                     return 1;
+                 }
+             } else {
+                 std::cerr << "CPU list required" << std::endl;
+                 return 1;
+             }
          } else if (arg == "-h" || arg == "--help") {
              print_usage(argv[0]);
              return 0;
@@ -111,6 +403,17 @@
          }
      }
  
+     // High 100 leaves eviction to SET alone; the low mark must sit below it
+     if (engine_config.evict_low_pct >= engine_config.evict_high_pct &&
+         engine_config.evict_high_pct < 100) {
+         std::cerr << "--maxmemory-low must be below --maxmemory-high" << std::endl;
+         return 1;
+     }
+ 
+     if (engine_config.cgroup_memory && MemoryStats::cgroup_dir().empty()) {
+         std::cerr << "Warning: no cgroup v2 memory controller found, --maxmemory-cgroup has no effect" << std::endl;
+     }
+ 
      // Set up signal handlers for graceful shutdown
      std::signal(SIGINT, signal_handler);   // Ctrl+C
      std::signal(SIGTERM, signal_handler);  // kill
@@ -119,10 +422,33 @@
      std::cout << "Starting server on port " << port << std::endl;
      std::cout << "Maximum connections: " << max_connections << std::endl;
      
+     // Place memory and pin threads before the server and storage engine
+     // allocate anything or start their threads, which inherit both settings
+     if (numa_node >= 0) {
+         if (!Numa::bind_memory(numa_node)) {
+             std::cerr << "Failed to bind memory to NUMA node " << numa_node << std::endl;
+             return 1;
+         }
+         if (cpus.empty()) cpus = Numa::node_cpus(numa_node);
+         std::cout << "Memory bound to NUMA node " << numa_node << std::endl;
+     }
+     if (!cpus.empty()) {
+         if (!Numa::pin_cpus(cpus)) {
+             std::cerr << "Failed to pin to CPUs " << Numa::format_list(cpus) << std::endl;
+             return 1;
+         }
+         std::cout << "Pinned to CPUs " << Numa::format_list(cpus) << std::endl;
+     }
+     
      // Create and initialize server
-     Server server(port, max_connections);
+     Server server(port, max_connections, engine_config, databases);
      g_server = &server;
      
+     if (!load_dir.empty() && !server.set_load_dir(load_dir)) {
+         std::cerr << "Load directory " << load_dir << " does not exist" << std::endl;
+         return 1;
+     }
+     
      if (!server.init()) {
          std::cerr << "Failed to initialize server" << std::endl;
          return 1;
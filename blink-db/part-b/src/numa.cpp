@@ -0,0 +1,128 @@
+/**
+ * @file numa.cpp
+ * @brief Implementation of NUMA placement and CPU pinning helpers
+ * 
+ * @details Topology is read from /sys/devices/system/node, memory policy is
+ * set with the set_mempolicy system call and affinity with
+ * sched_setaffinity.
+ */
+
+ #include "numa.h"
+ #include <fstream>
+ #include <sstream>
+ #include <algorithm>
+ #include <sched.h>
+ #include <unistd.h>
+ #include <sys/syscall.h>
+ 
+ /** @brief Kernel memory policy mode restricting allocations to a node mask */
+ static const int MPOL_BIND_MODE = 2;
+ 
+ /** @brief Root of the NUMA node topology in sysfs */
+ static const std::string NODE_SYSFS = "/sys/devices/system/node/";
+ 
+ /**
+  * @brief Read the first line of a sysfs file
+  * 
+  * @param path File path
+  * @param[out] line First line of the file
+  * @return true if the file could be read
+  */
+ static bool read_line(const std::string& path, std::string& line) {
+     std::ifstream in(path);
+     return in && std::getline(in, line);
+ }
+ 
+ /**
+  * @brief Parse a kernel CPU/node list such as "0-3,8-11"
+  */
+ std::vector<int> Numa::parse_list(const std::string& list, int limit) {
+     std::vector<int> ids;
+     std::stringstream ss(list);
+     std::string item;
+     while (std::getline(ss, item, ',')) {
+         if (item.empty() || item == "\n") continue;
+         try {
+             size_t dash = item.find('-');
+             int first = std::stoi(item.substr(0, dash));
+             int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+             if (first < 0 || last < first || last >= limit) return {};
+             for (int id = first; id <= last; id++) ids.push_back(id);
+         } catch (const std::exception&) {
+             return {};
+         }
+     }
+     std::sort(ids.begin(), ids.end());
+     ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+     return ids;
+ }
+ 
+ /**
+  * @brief Number of CPUs the system is configured with, capped at CPU_SETSIZE
+  */
+ int Numa::cpu_count() {
+     long configured = sysconf(_SC_NPROCESSORS_CONF);
+     if (configured <= 0 || configured > CPU_SETSIZE) return CPU_SETSIZE;
+     return static_cast<int>(configured);
+ }
+ 
+ /**
+  * @brief Ids of the online NUMA nodes
+  */
+ std::vector<int> Numa::online_nodes() {
+     std::string line;
+     if (!read_line(NODE_SYSFS + "online", line)) return {0};
+     std::vector<int> nodes = parse_list(line);
+     return nodes.empty() ? std::vector<int>{0} : nodes;
+ }
+ 
+ /**
+  * @brief CPUs that belong to a NUMA node
+  */
+ std::vector<int> Numa::node_cpus(int node) {
+     std::string line;
+     if (!read_line(NODE_SYSFS + "node" + std::to_string(node) + "/cpulist", line)) return {};
+     return parse_list(line);
+ }
+ 
+ /**
+  * @brief Restrict future allocations of the calling thread to one node
+  */
+ bool Numa::bind_memory(int node) {
+     const size_t bits = sizeof(unsigned long) * 8;
+     if (node < 0) return false;
+     std::vector<unsigned long> mask(node / bits + 1, 0);
+     mask[node / bits] |= 1UL << (node % bits);
+     // maxnode counts bits and the kernel ignores the last one
+     return syscall(SYS_set_mempolicy, MPOL_BIND_MODE, mask.data(), mask.size() * bits + 1) == 0;
+ }
+ 
+ /**
+  * @brief Pin the calling thread to a set of CPUs
+  */
+ bool Numa::pin_cpus(const std::vector<int>& cpus) {
+     if (cpus.empty()) return false;
+     cpu_set_t set;
+     CPU_ZERO(&set);
+     for (int cpu : cpus) {
+         if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+         CPU_SET(cpu, &set);
+     }
+     return sched_setaffinity(0, sizeof(set), &set) == 0;
+ }
+ 
+ /**
+  * @brief Format ids back into the compact kernel list form
+  */
+ std::string Numa::format_list(const std::vector<int>& ids) {
+     std::string out;
+     for (size_t i = 0; i < ids.size();) {
+         size_t j = i;
+         while (j + 1 < ids.size() && ids[j + 1] == ids[j] + 1) j++;
+         if (!out.empty()) out += ",";
+         out += std::to_string(ids[i]);
+         if (j > i) out += "-" + std::to_string(ids[j]);
+         i = j + 1;
+     }
+     return out;
+ }
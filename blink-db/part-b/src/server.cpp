@@ -11,12 +11,20 @@
  #include "connection.h"
  #include "resp.h"
  #include <sys/socket.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
  #include <netinet/in.h>
  #include <unistd.h>
  #include <fcntl.h>
  #include <iostream>
  #include <cstring>
  #include <errno.h>
+ #include <algorithm>
+ #include <charconv>
+ #include <cctype>
+ #include <cstdint>
+ #include <cstdlib>
+ #include <strings.h>
  
  /**
   * @brief Constructs a new Server instance
@@ -25,14 +33,22 @@
   * 
   * @param port Port number to listen on (default: 9001)
   * @param max_connections Maximum number of concurrent connections allowed
+  * @param engine_config Options forwarded to the storage engine of each keyspace,
+  *        whose max_memory they all share
+  * @param databases Number of keyspaces; only keyspace 0 is created up front
   */
- Server::Server(int port, int max_connections)
+ Server::Server(int port, int max_connections, const EngineConfig& engine_config, int databases)
      : port_(port),
        listen_fd_(-1),
        epoll_fd_(-1),
        max_connections_(max_connections),
-       running_(false)
+       running_(false),
+       engine_config_(engine_config),
+       databases_(databases)
  {
+     // Keyspaces share one memory budget
+     engine_config_.shared_memory = std::make_shared<SharedMemory>();
+     keyspace(0);
  }
  
  /**
@@ -123,22 +139,70 @@
          return false;
      }
  
-     // Register SET command handler
+     // Register SET command handler:
+     // SET key value [EX seconds] [IFVERSION version | LEASE token] [TAGS tag [tag ...]]
      register_command("SET", [this](const std::vector<std::string> &args) -> std::string
                       {
          if (args.size() < 2) return "-ERR wrong number of arguments for 'set' command\r\n";
          
-         // Check for TTL (EX) parameter
+         // Check for TTL (EX), compare-and-set (IFVERSION), LEASE and TAGS
+         // options; TAGS takes every remaining argument
          std::chrono::seconds ttl = std::chrono::seconds::max();
-         if (args.size() >= 4 && args[2] == "EX") {
-             try {
-                 ttl = std::chrono::seconds(std::stoi(args[3]));
-             } catch (const std::exception& e) {
-                 return "-ERR invalid expire time in 'set' command\r\n";
+         bool versioned = false;
+         uint64_t expected = 0;
+         bool leased = false;
+         uint64_t token = 0;
+         std::vector<std::string> tags;
+         for (size_t i = 2; i + 1 < args.size(); i += 2) {
+             if (args[i] == "EX") {
+                 try {
+                     ttl = std::chrono::seconds(std::stoi(args[i + 1]));
+                 } catch (const std::exception& e) {
+                     return "-ERR invalid expire time in 'set' command\r\n";
+                 }
+             } else if (args[i] == "IFVERSION") {
+                 try {
+                     expected = std::stoull(args[i + 1]);
+                 } catch (const std::exception& e) {
+                     return "-ERR invalid version in 'set' command\r\n";
+                 }
+                 versioned = true;
+             } else if (args[i] == "LEASE") {
+                 try {
+                     token = std::stoull(args[i + 1]);
+                 } catch (const std::exception& e) {
+                     return "-ERR invalid lease token in 'set' command\r\n";
+                 }
+                 leased = true;
+             } else if (args[i] == "TAGS") {
+                 tags.assign(args.begin() + i + 1, args.end());
+                 break;
              }
          }
          
-         storage_engine_.set(args[0], args[1], ttl);
+         if (versioned && leased) return "-ERR IFVERSION and LEASE options are not compatible\r\n";
+         if (leased) {
+             // Null bulk string when the lease is not held (timed out or cancelled)
+             switch (engine().set_with_lease(args[0], args[1], token, ttl, tags)) {
+                 case CasStatus::OK: return "+OK\r\n";
+                 case CasStatus::MISMATCH: return "$-1\r\n";
+                 case CasStatus::OOM: break;
+             }
+             return "-OOM command not allowed when used memory > 'maxmemory'\r\n";
+         }
+         if (versioned) {
+             // Replies with the new version, or a null bulk string on mismatch
+             uint64_t version = 0;
+             switch (engine().set_if_version(args[0], args[1], expected, version, ttl, tags)) {
+                 case CasStatus::OK: return ":" + std::to_string(version) + "\r\n";
+                 case CasStatus::MISMATCH: return "$-1\r\n";
+                 case CasStatus::OOM: break;
+             }
+             return "-OOM command not allowed when used memory > 'maxmemory'\r\n";
+         }
+         if (!engine().set(args[0], args[1], ttl, tags)) {
+             return "-OOM command not allowed when used memory > 'maxmemory'\r\n";
+         }
          return "+OK\r\n"; });
  
      // Register GET command handler
@@ -146,21 +210,536 @@
                       {
          if (args.size() != 1) return "-ERR wrong number of arguments for 'get' command\r\n";
          
-         std::string value = storage_engine_.get(args[0]);
+         std::string value = engine().get(args[0]);
          if (value.empty()) {
              return "$-1\r\n"; // NULL bulk string
          } else {
              return "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
          } });
  
-     // Register DEL command handler
+     // Register GETL command handler: [HIT|LEASE|WAIT, value or stale value or nil, lease token]
+     register_command("GETL", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 1) return "-ERR wrong number of arguments for 'getl' command\r\n";
+ 
+         std::string value;
+         uint64_t token = 0;
+         bool stale = false;
+         LeaseStatus status = engine().get_or_lease(args[0], value, token, stale);
+         static const char* const names[] = {"$3\r\nHIT\r\n", "$5\r\nLEASE\r\n", "$4\r\nWAIT\r\n"};
+         std::string reply = "*3\r\n";
+         reply += names[static_cast<int>(status)];
+         if (status == LeaseStatus::HIT || stale) {
+             reply += "$" + std::to_string(value.size()) + "\r\n" + value + "\r\n";
+         } else {
+             reply += "$-1\r\n";
+         }
+         return reply + ":" + std::to_string(token) + "\r\n"; });
+ 
+     // Register GETV command handler: value and version as a two-element array
+     register_command("GETV", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 1) return "-ERR wrong number of arguments for 'getv' command\r\n";
+ 
+         std::string value;
+         uint64_t version = 0;
+         if (!engine().get_versioned(args[0], value, version)) {
+             return "*-1\r\n"; // NULL array
+         }
+         return "*2\r\n$" + std::to_string(value.size()) + "\r\n" + value + "\r\n:" +
+                std::to_string(version) + "\r\n"; });
+ 
+     // Register DEL command handler: DEL key [IFVERSION version]
      register_command("DEL", [this](const std::vector<std::string> &args) -> std::string
                       {
-         if (args.size() != 1) return "-ERR wrong number of arguments for 'del' command\r\n";
+         if (args.size() != 1 && !(args.size() == 3 && args[1] == "IFVERSION")) {
+             return "-ERR wrong number of arguments for 'del' command\r\n";
+         }
+ 
+         if (args.size() == 3) {
+             uint64_t expected = 0;
+             try {
+                 expected = std::stoull(args[2]);
+             } catch (const std::exception& e) {
+                 return "-ERR invalid version in 'del' command\r\n";
+             }
+             bool success = engine().del_if_version(args[0], expected);
+             return ":" + std::to_string(success ? 1 : 0) + "\r\n";
+         }
          
-         bool success = storage_engine_.del(args[0]);
+         bool success = engine().del(args[0]);
          return ":" + std::to_string(success ? 1 : 0) + "\r\n"; });
  
+     // Register UNLINK command handler: UNLINK key [key ...], values freed in the background
+     register_command("UNLINK", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.empty()) return "-ERR wrong number of arguments for 'unlink' command\r\n";
+ 
+         size_t unlinked = 0;
+         for (const auto& key : args) {
+             if (engine().unlink(key)) unlinked++;
+         }
+         return ":" + std::to_string(unlinked) + "\r\n"; });
+ 
+     // Register INCR, DECR, INCRBY and DECRBY handlers: counters on integer-encoded values
+     auto counter = [this](const std::string &key, int64_t delta) -> std::string
+     {
+         int64_t result = 0;
+         switch (engine().incr_by(key, delta, result)) {
+             case IncrStatus::OK: return ":" + std::to_string(result) + "\r\n";
+             case IncrStatus::NOT_INTEGER: return "-ERR value is not an integer or out of range\r\n";
+             case IncrStatus::OUT_OF_RANGE: return "-ERR increment or decrement would overflow\r\n";
+             case IncrStatus::OOM: break;
+         }
+         return "-OOM command not allowed when used memory > 'maxmemory'\r\n";
+     };
+     register_command("INCR", [counter](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 1) return "-ERR wrong number of arguments for 'incr' command\r\n";
+         return counter(args[0], 1); });
+     register_command("DECR", [counter](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 1) return "-ERR wrong number of arguments for 'decr' command\r\n";
+         return counter(args[0], -1); });
+     register_command("INCRBY", [counter](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 2) return "-ERR wrong number of arguments for 'incrby' command\r\n";
+         int64_t delta = 0;
+         if (!CompactString::parse_canonical(args[1], delta)) {
+             return "-ERR value is not an integer or out of range\r\n";
+         }
+         return counter(args[0], delta); });
+     register_command("DECRBY", [counter](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 2) return "-ERR wrong number of arguments for 'decrby' command\r\n";
+         int64_t delta = 0;
+         if (!CompactString::parse_canonical(args[1], delta)) {
+             return "-ERR value is not an integer or out of range\r\n";
+         }
+         if (delta == INT64_MIN) return "-ERR decrement would overflow\r\n";
+         return counter(args[0], -delta); });
+ 
+     // Bitmap commands work on string values read as bit arrays; a bit
+     // offset must be below 2^32 (a 512MB value), as in Redis
+     auto parse_offset = [](const std::string &text, size_t &offset) -> bool
+     {
+         int64_t v = 0;
+         if (!CompactString::parse_canonical(text, v) || v < 0 || static_cast<uint64_t>(v) >= Bitmap::MAX_BITS) return false;
+         offset = static_cast<size_t>(v);
+         return true;
+     };
+ 
+     // Register SETBIT command handler: SETBIT key offset 0|1
+     register_command("SETBIT", [this, parse_offset](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 3) return "-ERR wrong number of arguments for 'setbit' command\r\n";
+         size_t offset = 0;
+         if (!parse_offset(args[1], offset)) return "-ERR bit offset is not an integer or out of range\r\n";
+         if (args[2] != "0" && args[2] != "1") return "-ERR bit is not an integer or out of range\r\n";
+         
+         bool previous = false;
+         if (!engine().setbit(args[0], offset, args[2] == "1", previous)) {
+             return "-OOM command not allowed when used memory > 'maxmemory'\r\n";
+         }
+         return previous ? ":1\r\n" : ":0\r\n"; });
+ 
+     // Register GETBIT command handler: GETBIT key offset
+     register_command("GETBIT", [this, parse_offset](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 2) return "-ERR wrong number of arguments for 'getbit' command\r\n";
+         size_t offset = 0;
+         if (!parse_offset(args[1], offset)) return "-ERR bit offset is not an integer or out of range\r\n";
+         return engine().getbit(args[0], offset) ? ":1\r\n" : ":0\r\n"; });
+ 
+     // Register BITCOUNT command handler: BITCOUNT key [start end [BYTE|BIT]]
+     register_command("BITCOUNT", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 1 && args.size() != 3 && args.size() != 4) {
+             return "-ERR wrong number of arguments for 'bitcount' command\r\n";
+         }
+         int64_t start = 0, end = -1;
+         bool bit_units = false;
+         if (args.size() >= 3) {
+             if (!CompactString::parse_canonical(args[1], start) || !CompactString::parse_canonical(args[2], end)) {
+                 return "-ERR value is not an integer or out of range\r\n";
+             }
+             if (args.size() == 4) {
+                 if (args[3] != "BYTE" && args[3] != "BIT") return "-ERR syntax error\r\n";
+                 bit_units = args[3] == "BIT";
+             }
+         }
+         return ":" + std::to_string(engine().bitcount(args[0], start, end, bit_units)) + "\r\n"; });
+ 
+     // Register BITPOS command handler: BITPOS key 0|1 [start [end [BYTE|BIT]]]
+     register_command("BITPOS", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() < 2 || args.size() > 5) return "-ERR wrong number of arguments for 'bitpos' command\r\n";
+         if (args[1] != "0" && args[1] != "1") return "-ERR The bit argument must be 1 or 0.\r\n";
+         int64_t start = 0, end = -1;
+         bool bit_units = false;
+         if ((args.size() >= 3 && !CompactString::parse_canonical(args[2], start)) ||
+             (args.size() >= 4 && !CompactString::parse_canonical(args[3], end))) {
+             return "-ERR value is not an integer or out of range\r\n";
+         }
+         if (args.size() == 5) {
+             if (args[4] != "BYTE" && args[4] != "BIT") return "-ERR syntax error\r\n";
+             bit_units = args[4] == "BIT";
+         }
+         int64_t pos = engine().bitpos(args[0], args[1] == "1", start, end, args.size() >= 4, bit_units);
+         return ":" + std::to_string(pos) + "\r\n"; });
+ 
+     // Register BITOP command handler: BITOP AND|OR|XOR destkey key [key ...] or BITOP NOT destkey key
+     register_command("BITOP", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() < 3) return "-ERR wrong number of arguments for 'bitop' command\r\n";
+         Bitmap::Op op;
+         if (args[0] == "AND") op = Bitmap::Op::AND;
+         else if (args[0] == "OR") op = Bitmap::Op::OR;
+         else if (args[0] == "XOR") op = Bitmap::Op::XOR;
+         else if (args[0] == "NOT") op = Bitmap::Op::NOT;
+         else return "-ERR syntax error\r\n";
+         if (op == Bitmap::Op::NOT && args.size() != 3) {
+             return "-ERR BITOP NOT must be called with a single source key.\r\n";
+         }
+         
+         size_t length = 0;
+         std::vector<std::string> sources(args.begin() + 2, args.end());
+         if (!engine().bitop(op, args[1], sources, length)) {
+             return "-OOM command not allowed when used memory > 'maxmemory'\r\n";
+         }
+         return ":" + std::to_string(length) + "\r\n"; });
+ 
+     // HyperLogLog commands: sketches are string values (see HyperLogLog.h)
+     auto hll_error = [](HllStatus status) -> std::string
+     {
+         if (status == HllStatus::WRONGTYPE) return "-WRONGTYPE Key is not a valid HyperLogLog string value.\r\n";
+         return "-OOM command not allowed when used memory > 'maxmemory'\r\n";
+     };
+ 
+     // Register PFADD command handler: PFADD key [element ...]
+     register_command("PFADD", [this, hll_error](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.empty()) return "-ERR wrong number of arguments for 'pfadd' command\r\n";
+         bool changed = false;
+         std::vector<std::string> elements(args.begin() + 1, args.end());
+         HllStatus status = engine().pfadd(args[0], elements, changed);
+         if (status != HllStatus::OK) return hll_error(status);
+         return changed ? ":1\r\n" : ":0\r\n"; });
+ 
+     // Register PFCOUNT command handler: PFCOUNT key [key ...]
+     register_command("PFCOUNT", [this, hll_error](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.empty()) return "-ERR wrong number of arguments for 'pfcount' command\r\n";
+         uint64_t count = 0;
+         HllStatus status = engine().pfcount(args, count);
+         if (status != HllStatus::OK) return hll_error(status);
+         return ":" + std::to_string(count) + "\r\n"; });
+ 
+     // Register PFMERGE command handler: PFMERGE destkey [sourcekey ...]
+     register_command("PFMERGE", [this, hll_error](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.empty()) return "-ERR wrong number of arguments for 'pfmerge' command\r\n";
+         std::vector<std::string> sources(args.begin() + 1, args.end());
+         HllStatus status = engine().pfmerge(args[0], sources);
+         if (status != HllStatus::OK) return hll_error(status);
+         return "+OK\r\n"; });
+ 
+     // Bloom filter commands: filters are string values (see BloomFilter.h)
+     auto bloom_error = [](BloomStatus status) -> std::string
+     {
+         if (status == BloomStatus::EXISTS) return "-ERR item exists\r\n";
+         if (status == BloomStatus::WRONGTYPE) return "-WRONGTYPE Operation against a key holding the wrong kind of value\r\n";
+         return "-OOM command not allowed when used memory > 'maxmemory'\r\n";
+     };
+ 
+     auto bloom_flags = [](const std::vector<bool> &flags) -> std::string
+     {
+         std::string out = "*" + std::to_string(flags.size()) + "\r\n";
+         for (bool flag : flags) out += flag ? ":1\r\n" : ":0\r\n";
+         return out;
+     };
+ 
+     // Register BF.RESERVE command handler: BF.RESERVE key error_rate capacity
+     register_command("BF.RESERVE", [this, bloom_error](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 3) return "-ERR wrong number of arguments for 'bf.reserve' command\r\n";
+         double error_rate = 0;
+         uint64_t capacity = 0;
+         try {
+             size_t used = 0;
+             error_rate = std::stod(args[1], &used);
+             if (used != args[1].size()) throw std::invalid_argument(args[1]);
+         } catch (const std::exception& e) {
+             return "-ERR bad error rate\r\n";
+         }
+         if (!(error_rate > 0 && error_rate < 1)) return "-ERR (0 < error rate range < 1)\r\n";
+         try {
+             size_t used = 0;
+             capacity = std::stoull(args[2], &used);
+             if (used != args[2].size() || args[2][0] == '-') throw std::invalid_argument(args[2]);
+         } catch (const std::exception& e) {
+             return "-ERR bad capacity\r\n";
+         }
+         if (capacity == 0) return "-ERR (capacity should be larger than 0)\r\n";
+         size_t blocks;
+         unsigned hashes;
+         if (!BloomFilter::plan(error_rate, capacity, blocks, hashes)) return "-ERR filter would exceed 512MB\r\n";
+         BloomStatus status = engine().bf_reserve(args[0], error_rate, capacity);
+         if (status != BloomStatus::OK) return bloom_error(status);
+         return "+OK\r\n"; });
+ 
+     // Register BF.ADD command handler: BF.ADD key element
+     register_command("BF.ADD", [this, bloom_error](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 2) return "-ERR wrong number of arguments for 'bf.add' command\r\n";
+         std::vector<bool> added;
+         BloomStatus status = engine().bf_add(args[0], {args[1]}, added);
+         if (status != BloomStatus::OK) return bloom_error(status);
+         return added[0] ? ":1\r\n" : ":0\r\n"; });
+ 
+     // Register BF.MADD command handler: BF.MADD key element [element ...]
+     register_command("BF.MADD", [this, bloom_error, bloom_flags](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() < 2) return "-ERR wrong number of arguments for 'bf.madd' command\r\n";
+         std::vector<bool> added;
+         std::vector<std::string> elements(args.begin() + 1, args.end());
+         BloomStatus status = engine().bf_add(args[0], elements, added);
+         if (status != BloomStatus::OK) return bloom_error(status);
+         return bloom_flags(added); });
+ 
+     // Register BF.EXISTS command handler: BF.EXISTS key element
+     register_command("BF.EXISTS", [this, bloom_error](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 2) return "-ERR wrong number of arguments for 'bf.exists' command\r\n";
+         std::vector<bool> found;
+         BloomStatus status = engine().bf_exists(args[0], {args[1]}, found);
+         if (status != BloomStatus::OK) return bloom_error(status);
+         return found[0] ? ":1\r\n" : ":0\r\n"; });
+ 
+     // Register BF.MEXISTS command handler: BF.MEXISTS key element [element ...]
+     register_command("BF.MEXISTS", [this, bloom_error, bloom_flags](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() < 2) return "-ERR wrong number of arguments for 'bf.mexists' command\r\n";
+         std::vector<bool> found;
+         std::vector<std::string> elements(args.begin() + 1, args.end());
+         BloomStatus status = engine().bf_exists(args[0], elements, found);
+         if (status != BloomStatus::OK) return bloom_error(status);
+         return bloom_flags(found); });
+ 
+     // Register PREFIX command handler: PREFIX prefix [LIMIT n]
+     register_command("PREFIX", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 1 && args.size() != 3) return "-ERR wrong number of arguments for 'prefix' command\r\n";
+         if (!engine().has_ordered_index()) return "-ERR ordered index disabled (start the server with --ordered-index)\r\n";
+         
+         size_t limit = 0;
+         if (args.size() == 3) {
+             if (args[1] != "LIMIT") return "-ERR syntax error\r\n";
+             try {
+                 limit = std::stoul(args[2]);
+             } catch (const std::exception& e) {
+                 return "-ERR invalid limit in 'prefix' command\r\n";
+             }
+         }
+         
+         return encode_key_array(engine().keys_with_prefix(args[0], limit)); });
+ 
+     // Register RANGE command handler: RANGE start end [LIMIT n] over [start, end)
+     register_command("RANGE", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 2 && args.size() != 4) return "-ERR wrong number of arguments for 'range' command\r\n";
+         if (!engine().has_ordered_index()) return "-ERR ordered index disabled (start the server with --ordered-index)\r\n";
+         
+         size_t limit = 0;
+         if (args.size() == 4) {
+             if (args[2] != "LIMIT") return "-ERR syntax error\r\n";
+             try {
+                 limit = std::stoul(args[3]);
+             } catch (const std::exception& e) {
+                 return "-ERR invalid limit in 'range' command\r\n";
+             }
+         }
+         
+         return encode_key_array(engine().keys_in_range(args[0], args[1], limit)); });
+ 
+     // Register DELPREFIX command handler
+     register_command("DELPREFIX", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 1) return "-ERR wrong number of arguments for 'delprefix' command\r\n";
+         if (!engine().has_ordered_index()) return "-ERR ordered index disabled (start the server with --ordered-index)\r\n";
+         
+         size_t deleted = engine().del_prefix(args[0]);
+         return ":" + std::to_string(deleted) + "\r\n"; });
+ 
+     // Register INVALIDATE command handler: INVALIDATE tag [tag ...]
+     register_command("INVALIDATE", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.empty()) return "-ERR wrong number of arguments for 'invalidate' command\r\n";
+         
+         size_t deleted = engine().invalidate(args);
+         return ":" + std::to_string(deleted) + "\r\n"; });
+ 
+     // Register FREEZE command handler: FREEZE [pattern]
+     register_command("FREEZE", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() > 1) return "-ERR wrong number of arguments for 'freeze' command\r\n";
+         
+         size_t frozen = engine().freeze(args.empty() ? "*" : args[0]);
+         return ":" + std::to_string(frozen) + "\r\n"; });
+ 
+     // Register LOAD command handler: LOAD path
+     register_command("LOAD", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 1) return "-ERR wrong number of arguments for 'load' command\r\n";
+         return load_file(args[0]); });
+ 
+     // Register DUMP command handler: DUMP key
+     register_command("DUMP", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 1) return "-ERR wrong number of arguments for 'dump' command\r\n";
+         
+         std::string payload;
+         if (!engine().dump(args[0], payload)) return "$-1\r\n";
+         return "$" + std::to_string(payload.size()) + "\r\n" + payload + "\r\n"; });
+ 
+     // Register RESTORE command handler: RESTORE key payload [REPLACE]
+     register_command("RESTORE", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 2 && !(args.size() == 3 && args[2] == "REPLACE")) {
+             return "-ERR wrong number of arguments for 'restore' command\r\n";
+         }
+         
+         switch (engine().restore(args[0], args[1], args.size() == 3)) {
+             case RestoreStatus::OK:
+                 return "+OK\r\n";
+             case RestoreStatus::BUSY_KEY:
+                 return "-BUSYKEY Target key name already exists.\r\n";
+             case RestoreStatus::OOM:
+                 return "-OOM command not allowed when used memory > 'maxmemory'\r\n";
+             default:
+                 return "-ERR DUMP payload version or checksum are wrong\r\n";
+         } });
+ 
+     // Register MDUMP command handler: MDUMP key [key ...]
+     register_command("MDUMP", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.empty()) return "-ERR wrong number of arguments for 'mdump' command\r\n";
+         
+         size_t dumped = 0;
+         std::string payload = engine().dump_keys(args, dumped);
+         return "$" + std::to_string(payload.size()) + "\r\n" + payload + "\r\n"; });
+ 
+     // Register MRESTORE command handler: MRESTORE payload [REPLACE]
+     register_command("MRESTORE", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 1 && !(args.size() == 2 && args[1] == "REPLACE")) {
+             return "-ERR wrong number of arguments for 'mrestore' command\r\n";
+         }
+         
+         size_t restored = 0;
+         switch (engine().restore_keys(args[0], args.size() == 2, restored)) {
+             case RestoreStatus::OK:
+                 return ":" + std::to_string(restored) + "\r\n";
+             case RestoreStatus::BUSY_KEY:
+                 return "-BUSYKEY Target key name already exists.\r\n";
+             case RestoreStatus::OOM:
+                 return "-OOM command not allowed when used memory > 'maxmemory', " +
+                        std::to_string(restored) + " keys restored\r\n";
+             default:
+                 return "-ERR DUMP payload version or checksum are wrong\r\n";
+         } });
+ 
+     // Register SCAN command handler: SCAN cursor [MATCH pattern] [COUNT n]
+     register_command("SCAN", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.empty()) return "-ERR wrong number of arguments for 'scan' command\r\n";
+         
+         auto is_number = [](const std::string& text) {
+             return !text.empty() && std::all_of(text.begin(), text.end(),
+                                                 [](unsigned char c) { return std::isdigit(c) != 0; });
+         };
+         size_t cursor = 0;
+         if (!is_number(args[0])) return "-ERR invalid cursor\r\n";
+         try {
+             cursor = std::stoull(args[0]);
+         } catch (const std::exception& e) {
+             return "-ERR invalid cursor\r\n";
+         }
+         
+         std::string pattern = "*";
+         size_t count = 10;
+         for (size_t i = 1; i < args.size(); i += 2) {
+             if (i + 1 >= args.size()) return "-ERR syntax error\r\n";
+             if (args[i] == "MATCH") {
+                 pattern = args[i + 1];
+             } else if (args[i] == "COUNT") {
+                 // stoul would wrap a negative count around to a huge one
+                 if (!is_number(args[i + 1])) return "-ERR value is not an integer or out of range\r\n";
+                 try {
+                     count = std::stoul(args[i + 1]);
+                 } catch (const std::exception& e) {
+                     return "-ERR value is not an integer or out of range\r\n";
+                 }
+                 if (count == 0) return "-ERR syntax error\r\n";
+             } else {
+                 return "-ERR syntax error\r\n";
+             }
+         }
+         
+         std::vector<std::string> keys;
+         size_t next = engine().scan(cursor, keys, pattern, count);
+         
+         std::vector<RespProtocol::RespValue> reply;
+         reply.push_back(RespProtocol::RespValue::createBulkString(std::to_string(next)));
+         std::vector<RespProtocol::RespValue> key_values;
+         key_values.reserve(keys.size());
+         for (const auto& key : keys) {
+             key_values.push_back(RespProtocol::RespValue::createBulkString(key));
+         }
+         reply.push_back(RespProtocol::RespValue::createArray(key_values));
+         return RespProtocol::encode(RespProtocol::RespValue::createArray(reply)); });
+ 
+     // Register SWAPDB command handler: SWAPDB index1 index2
+     register_command("SWAPDB", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() != 2) return "-ERR wrong number of arguments for 'swapdb' command\r\n";
+         
+         size_t first = 0, second = 0;
+         if (!parse_db(args[0], first)) return "-ERR invalid first DB index\r\n";
+         if (!parse_db(args[1], second)) return "-ERR invalid second DB index\r\n";
+         // Commands run on the event loop thread, so exchanging the two
+         // owners is atomic for every client
+         databases_[first].swap(databases_[second]);
+         return "+OK\r\n"; });
+ 
+     // Register FLUSHDB command handler: FLUSHDB [ASYNC|SYNC]
+     register_command("FLUSHDB", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (args.size() > 1 || (args.size() == 1 && args[0] != "ASYNC" && args[0] != "SYNC")) {
+             return "-ERR wrong number of arguments for 'flushdb' command\r\n";
+         }
+         
+         // The keyspace is detached and recreated empty on its next use. A
+         // transaction running in it keeps its own reference until EXEC ends.
+         std::shared_ptr<StorageEngine> detached = std::move(databases_[current_db_]);
+         if (detached && args.size() == 1 && args[0] == "ASYNC") {
+             keyspace_free_.free_later(std::move(detached), 0);
+         }
+         return "+OK\r\n"; });
+ 
+     // Register INFO command handler
+     register_command("INFO", [this](const std::vector<std::string> &args) -> std::string
+                      {
+         if (!args.empty()) return "-ERR wrong number of arguments for 'info' command\r\n";
+         
+         std::string text = "db:" + std::to_string(current_db_) + "\r\n";
+         text += "databases:" + std::to_string(databases_.size()) + "\r\n";
+         text += "flushing_databases:" + std::to_string(keyspace_free_.pending_objects()) + "\r\n";
+         for (const auto& stat : engine().stats()) {
+             text += stat.first + ":" + stat.second + "\r\n";
+         }
+         return "$" + std::to_string(text.size()) + "\r\n" + text + "\r\n"; });
+ 
      std::cout << "Server initialized on port " << port_ << std::endl;
      return true;
  }
@@ -445,17 +1024,35 @@
      close(fd);
  }
  
+ /**
+  * @brief Encodes a list of keys as a RESP array of bulk strings
+  * 
+  * @param keys Keys to encode
+  * @return RESP-formatted array
+  */
+ std::string Server::encode_key_array(const std::vector<std::string> &keys)
+ {
+     std::vector<RespProtocol::RespValue> values;
+     values.reserve(keys.size());
+     for (const auto &key : keys)
+     {
+         values.push_back(RespProtocol::RespValue::createBulkString(key));
+     }
+     return RespProtocol::encode(RespProtocol::RespValue::createArray(values));
+ }
+ 
  /**
   * @brief Executes a command and returns the response
   * 
   * @details Looks up the appropriate handler for the command and executes it,
   * returning the RESP-formatted response or an error message.
   * 
+  * @param db Keyspace the command runs in
   * @param command Command name (e.g., "SET", "GET", "DEL")
   * @param args Vector of command arguments
   * @return RESP-formatted response string
   */
- std::string Server::execute_command(const std::string &command, const std::vector<std::string> &args)
+ std::string Server::execute_command(size_t db, const std::string &command, const std::vector<std::string> &args)
  {
      auto it = command_handlers_.find(command);
      if (it == command_handlers_.end())
@@ -463,6 +1060,7 @@
          return "-ERR unknown command '" + command + "'\r\n";
      }
  
+     current_db_ = db;
      try
      {
          return it->second(args);
@@ -472,4 +1070,250 @@
          return "-ERR internal error: " + std::string(e.what()) + "\r\n";
      }
  }
- 
\ No newline at end of file
+ 
+ 
+ /**
+  * @brief Checks whether a command has a registered handler
+  * 
+  * @param command Command name in upper case
+  * @return true if the command is known
+  */
+ bool Server::has_command(const std::string &command) const
+ {
+     return command_handlers_.count(command) > 0;
+ }
+ 
+ /**
+  * @brief Executes a MULTI/EXEC block as one storage engine critical section
+  * 
+  * @details The engine lock is taken once and held across the watch check and
+  * every queued command, so no other client or background task (expiry,
+  * eviction) can interleave. A command that fails at run time returns its
+  * error in its slot of the reply; the others still run.
+  * 
+  * A watched key counts as modified when its keyspace was swapped away or
+  * flushed since WATCH.
+  * 
+  * @param db Keyspace selected by the connection
+  * @param commands Commands queued since MULTI
+  * @param watched Keys WATCHed by the connection with their counts
+  * @return RESP array of replies, or "*-1" if a watched key was modified
+  */
+ std::string Server::execute_transaction(size_t db, const std::vector<QueuedCommand> &commands,
+                                         const std::vector<WatchedKey> &watched)
+ {
+     // SWAPDB and FLUSHDB are refused inside MULTI, so no queued command
+     // replaces this keyspace while the batch holds its lock
+     StorageEngine::Batch batch(*keyspace(db));
+     for (const auto &w : watched)
+     {
+         std::shared_ptr<StorageEngine> watched_engine = w.engine.lock();
+         if (!watched_engine || databases_[w.db] != watched_engine ||
+             watched_engine->watch_touches(w.key) != w.touches)
+         {
+             return "*-1\r\n";
+         }
+     }
+ 
+     std::string reply = "*" + std::to_string(commands.size()) + "\r\n";
+     for (const auto &[command, args] : commands)
+     {
+         reply += execute_command(db, command, args);
+     }
+     return reply;
+ }
+ 
+ /**
+  * @brief Starts watching a key in a keyspace
+  * 
+  * @param db Keyspace selected by the connection
+  * @param key Key to watch
+  * @return WatchedKey Keyspace, key and modification count
+  */
+ WatchedKey Server::watch(size_t db, const std::string &key)
+ {
+     std::shared_ptr<StorageEngine> engine = keyspace(db);
+     uint64_t touches = engine->watch(key);
+     return WatchedKey{db, engine, key, touches};
+ }
+ 
+ /**
+  * @brief Stops watching a key on behalf of a connection
+  * 
+  * @param watched Record returned by watch()
+  */
+ void Server::unwatch(const WatchedKey &watched)
+ {
+     if (auto engine = watched.engine.lock()) engine->unwatch(watched.key);
+ }
+ 
+ /**
+  * @brief Parses a keyspace number
+  * 
+  * @param text Decimal keyspace number
+  * @param[out] db Parsed number
+  * @return true If text is a valid keyspace number
+  */
+ bool Server::parse_db(const std::string &text, size_t &db) const
+ {
+     size_t value = 0;
+     auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+     if (ec != std::errc() || end != text.data() + text.size() || value >= databases_.size())
+     {
+         return false;
+     }
+     db = value;
+     return true;
+ }
+ 
+ /**
+  * @brief Returns a keyspace, creating its storage engine on first use
+  * 
+  * @details Keyspaces that are never selected cost one null pointer, so
+  * unused databases start no engine or maintenance thread.
+  * 
+  * @param db Keyspace number
+  * @return std::shared_ptr<StorageEngine>& Slot holding the keyspace
+  */
+ std::shared_ptr<StorageEngine> &Server::keyspace(size_t db)
+ {
+     std::shared_ptr<StorageEngine> &slot = databases_[db];
+     if (!slot)
+     {
+         slot = std::make_shared<StorageEngine>(engine_config_);
+     }
+     return slot;
+ }
+ 
+ /**
+  * @brief Sets the directory LOAD may read from
+  * 
+  * @details Stores the canonical path with a trailing slash, so that
+  * load_file() can check that a resolved file path starts with it.
+  * 
+  * @param dir Directory on the server host
+  * @return true If dir is an existing directory
+  */
+ bool Server::set_load_dir(const std::string &dir)
+ {
+     char *resolved = realpath(dir.c_str(), nullptr);
+     if (!resolved) return false;
+     std::string canonical(resolved);
+     free(resolved);
+     struct stat st;
+     if (stat(canonical.c_str(), &st) < 0 || !S_ISDIR(st.st_mode)) return false;
+     if (canonical.back() != '/') canonical += '/';
+     load_dir_ = canonical;
+     return true;
+ }
+ 
+ /**
+  * @brief Bulk-loads SET commands from a local file
+  * 
+  * @details The file holds RESP arrays "SET key value", the format used for
+  * mass insertion into Redis-compatible servers. Keys and values are copied
+  * straight out of the read-only mapping into each batch, so there is no
+  * per-command buffer, dispatch or reply. Loading stops at the first
+  * malformed command or at a batch that does not fit in memory; batches
+  * loaded before that stay loaded.
+  * 
+  * Clients choose the path, so LOAD is off unless the server was started
+  * with --load-dir, and then only reaches files inside that directory:
+  * absolute paths and ".." components are refused, and the resolved path
+  * (following any symlink) must still lie below load_dir_.
+  * 
+  * @param path Path of the file relative to load_dir_
+  * @return RESP integer with the number of keys loaded, or an error
+  */
+ std::string Server::load_file(const std::string &path)
+ {
+     if (load_dir_.empty()) return "-ERR LOAD is disabled, start the server with --load-dir\r\n";
+     if (path.empty() || path[0] == '/') return "-ERR LOAD path must be relative to the load directory\r\n";
+     for (size_t start = 0; start <= path.size();) {
+         size_t slash = path.find('/', start);
+         if (slash == std::string::npos) slash = path.size();
+         if (path.compare(start, slash - start, "..") == 0) {
+             return "-ERR LOAD path must not contain '..'\r\n";
+         }
+         start = slash + 1;
+     }
+     char *resolved = realpath((load_dir_ + path).c_str(), nullptr);
+     if (!resolved) return "-ERR cannot open '" + path + "': " + strerror(errno) + "\r\n";
+     std::string target(resolved);
+     free(resolved);
+     if (target.compare(0, load_dir_.size(), load_dir_) != 0) {
+         return "-ERR LOAD path is outside the load directory\r\n";
+     }
+ 
+     int fd = open(target.c_str(), O_RDONLY | O_NOFOLLOW);
+     if (fd < 0) return "-ERR cannot open '" + path + "': " + strerror(errno) + "\r\n";
+     struct stat st;
+     if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+         close(fd);
+         return "-ERR '" + path + "' is not a regular file\r\n";
+     }
+     size_t size = static_cast<size_t>(st.st_size);
+     if (size == 0) {
+         close(fd);
+         return ":0\r\n";
+     }
+     void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+     close(fd);
+     if (mapping == MAP_FAILED) return "-ERR cannot map '" + path + "': " + strerror(errno) + "\r\n";
+     madvise(mapping, size, MADV_SEQUENTIAL);
+ 
+     const char *p = static_cast<const char *>(mapping);
+     const char *end = p + size;
+ 
+     // "<type><integer>\r\n"
+     auto read_header = [&](char type, long long &n) -> bool {
+         if (p >= end || *p != type) return false;
+         const char *eol = static_cast<const char *>(memchr(p, '\r', end - p));
+         if (!eol || eol + 1 >= end || eol[1] != '\n') return false;
+         auto res = std::from_chars(p + 1, eol, n);
+         if (res.ec != std::errc() || res.ptr != eol) return false;
+         p = eol + 2;
+         return true;
+     };
+     auto read_bulk = [&](std::string_view &out) -> bool {
+         long long n;
+         // Compare against the remaining bytes; n + 2 could overflow
+         if (!read_header('$', n) || n < 0 || end - p < 2 || n > end - p - 2) return false;
+         if (p[n] != '\r' || p[n + 1] != '\n') return false;
+         out = std::string_view(p, static_cast<size_t>(n));
+         p += n + 2;
+         return true;
+     };
+ 
+     std::vector<std::pair<std::string, std::string>> batch;
+     batch.reserve(LOAD_BATCH);
+     size_t loaded = 0;
+     std::string error;
+     auto flush = [&]() {
+         if (!engine().bulk_load(batch)) {
+             error = "-OOM command not allowed when used memory > 'maxmemory'";
+             return;
+         }
+         loaded += batch.size();
+         batch.clear();
+     };
+ 
+     while (p < end && error.empty()) {
+         long long argc;
+         std::string_view command, key, value;
+         if (!read_header('*', argc) || argc != 3 || !read_bulk(command) ||
+             command.size() != 3 || strncasecmp(command.data(), "SET", 3) != 0 ||
+             !read_bulk(key) || !read_bulk(value)) {
+             error = "-ERR malformed command " + std::to_string(loaded + batch.size() + 1) +
+                     " in '" + path + "' (expected SET key value)";
+             break;
+         }
+         batch.emplace_back(key, value);
+         if (batch.size() == LOAD_BATCH) flush();
+     }
+     if (error.empty() && !batch.empty()) flush();
+     munmap(mapping, size);
+ 
+     if (!error.empty()) return error + ", " + std::to_string(loaded) + " keys loaded\r\n";
+     return ":" + std::to_string(loaded) + "\r\n";
+ }
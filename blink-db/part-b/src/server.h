@@ -16,12 +16,17 @@
  #include <functional>
  #include <sys/epoll.h>
  #include <atomic>
+ #include <memory>
  #include <vector>
+ #include <utility>
+ #include <cstdint>
  #include "StorageEngine.h"
+ #include "LazyFree.h"
  
  // Forward declaration
  class Connection;
  class RespProtocol;
+ struct WatchedKey;
  
  /**
   * @class Server
@@ -49,6 +54,9 @@
       */
      using CommandHandler = std::function<std::string(const std::vector<std::string>&)>;
  
+     /** @brief Command name and arguments queued by MULTI */
+     using QueuedCommand = std::pair<std::string, std::vector<std::string>>;
+ 
      /**
       * @brief Construct a TCP server
       * 
@@ -57,8 +65,11 @@
       * 
       * @param port Port to listen on (default: 9001)
       * @param max_connections Maximum number of concurrent connections (default: 1024)
+      * @param engine_config Storage engine options (memory limit, optional indexes)
+      * @param databases Number of keyspaces selectable with SELECT (default: 16)
       */
-     Server(int port = 9001, int max_connections = 1024);
+     Server(int port = 9001, int max_connections = 1024,
+            const EngineConfig& engine_config = EngineConfig(), int databases = 16);
      
      /**
       * @brief Destroy the server and release resources
@@ -116,11 +127,80 @@
       * returning the RESP-formatted response. If the command is not recognized or
       * an error occurs, returns an appropriate error response.
       * 
+      * @param db Keyspace selected by the client
       * @param command Command name (e.g., "SET", "GET", "DEL")
       * @param args Vector of command arguments
       * @return Response string in RESP format
       */
-     std::string execute_command(const std::string& command, const std::vector<std::string>& args);
+     std::string execute_command(size_t db, const std::string& command, const std::vector<std::string>& args);
+ 
+     /**
+      * @brief Check whether a command has a registered handler
+      * 
+      * @param command Command name in upper case
+      * @return true if execute_command() would dispatch it
+      */
+     bool has_command(const std::string& command) const;
+ 
+     /**
+      * @brief Execute a MULTI/EXEC block atomically
+      * 
+      * @details Holds the storage engine lock for the whole block (one
+      * acquisition instead of one per command), first checking that none of
+      * the watched keys was modified since WATCH, then running the queued
+      * commands in order.
+      * 
+      * @param db Keyspace selected by the client
+      * @param commands Commands queued since MULTI
+      * @param watched Keys WATCHed by the connection with their counts
+      * @return RESP array of the command replies, or a null array if a
+      *         watched key changed (or its keyspace was swapped or flushed)
+      *         and nothing was executed
+      */
+     std::string execute_transaction(size_t db, const std::vector<QueuedCommand>& commands,
+                                     const std::vector<WatchedKey>& watched);
+ 
+     /**
+      * @brief Start watching a key on behalf of a connection (WATCH)
+      * 
+      * @param db Keyspace selected by the client
+      * @param key Key to watch
+      * @return WatchedKey Record to pass back to execute_transaction()
+      */
+     WatchedKey watch(size_t db, const std::string& key);
+ 
+     /**
+      * @brief Stop watching a key on behalf of a connection
+      * 
+      * @param watched Record returned by watch()
+      */
+     void unwatch(const WatchedKey& watched);
+ 
+     /**
+      * @brief Number of keyspaces clients can SELECT
+      */
+     size_t database_count() const { return databases_.size(); }
+ 
+     /**
+      * @brief Parse a keyspace number argument
+      * 
+      * @param text Decimal keyspace number
+      * @param[out] db Parsed number, only written on success
+      * @return true If text is a number below database_count()
+      */
+     bool parse_db(const std::string& text, size_t& db) const;
+ 
+     /**
+      * @brief Allow LOAD to read files from a directory
+      * 
+      * @details LOAD is refused until this is called. Afterwards it only
+      * accepts relative paths without ".." that resolve, symlinks included,
+      * to a file inside the directory.
+      * 
+      * @param dir Directory on the server host
+      * @return false If dir does not name an existing directory
+      */
+     bool set_load_dir(const std::string& dir);
  
  private:
      int port_;                             ///< Server port number to listen on
@@ -129,7 +209,11 @@
      int max_connections_;                  ///< Maximum number of concurrent connections allowed
      std::atomic<bool> running_;            ///< Flag to control the server loop execution
      
-     StorageEngine storage_engine_;         ///< Storage engine from Part A for data operations
+     EngineConfig engine_config_;           ///< Options of every keyspace's storage engine
+     std::vector<std::shared_ptr<StorageEngine>> databases_; ///< Keyspaces (storage engines from Part A), created on first use
+     size_t current_db_ = 0;                ///< Keyspace of the command being executed
+     LazyFree keyspace_free_;               ///< Destroys keyspaces detached by FLUSHDB ASYNC
+     std::string load_dir_;                 ///< Canonical directory LOAD reads from, ending in '/'; empty disables LOAD
      std::unordered_map<std::string, CommandHandler> command_handlers_; ///< Map of command names to handler functions
      std::unordered_map<int, Connection*> connections_; ///< Map of file descriptors to Connection objects
  
@@ -176,5 +260,41 @@
       * @param fd File descriptor of the connection to close
       */
      void close_connection(int fd);
+ 
+     /**
+      * @brief Encode a list of keys as a RESP array reply
+      * 
+      * @param keys Keys to encode as bulk strings
+      * @return RESP-formatted array
+      */
+     static std::string encode_key_array(const std::vector<std::string>& keys);
+ 
+     /**
+      * @brief Get a keyspace, creating its storage engine on first use
+      * 
+      * @param db Keyspace number, below database_count()
+      * @return std::shared_ptr<StorageEngine>& Slot holding the keyspace
+      */
+     std::shared_ptr<StorageEngine>& keyspace(size_t db);
+ 
+     /**
+      * @brief Storage engine of the keyspace the current command runs in
+      */
+     StorageEngine& engine() { return *keyspace(current_db_); }
+ 
+     /**
+      * @brief Bulk-load a local file of SET commands (LOAD)
+      * 
+      * @details Maps the file and parses RESP arrays of the form SET key value
+      * directly from the mapping, handing them to StorageEngine::bulk_load()
+      * in batches of LOAD_BATCH records. Only files inside load_dir_ are read.
+      * 
+      * @param path Path of the file relative to load_dir_
+      * @return RESP reply: the number of keys loaded, or an error that also
+      * reports how many keys were loaded before it
+      */
+     std::string load_file(const std::string& path);
+ 
+     static constexpr size_t LOAD_BATCH = 65536; ///< Records per StorageEngine::bulk_load() call
  };
  
\ No newline at end of file
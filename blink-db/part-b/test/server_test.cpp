@@ -0,0 +1,210 @@
+/**
+ * @file server_test.cpp
+ * @brief Behaviour tests of server command handling (run with make test)
+ */
+
+ #include "server.h"
+ #include "connection.h"
+ #include <sys/socket.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+ #include <cstdlib>
+ #include <fstream>
+ #include <iostream>
+ #include <string>
+ #include <vector>
+ 
+ static int failures = 0;
+ 
+ // Report a failed expectation and keep going
+ static void check(bool ok, const std::string& what) {
+     if (!ok) {
+         std::cout << "FAIL: " << what << "\n";
+         failures++;
+     }
+ }
+ 
+ // Client end of a connection served in-process over a socket pair
+ class TestClient {
+ public:
+     explicit TestClient(Server& server) {
+         socketpair(AF_UNIX, SOCK_STREAM, 0, fds_);
+         connection_ = std::make_unique<Connection>(fds_[0], &server);
+     }
+     ~TestClient() {
+         connection_.reset();
+         close(fds_[1]);
+     }
+ 
+     // Send one command and return the raw RESP reply
+     std::string call(const std::vector<std::string>& args) {
+         std::string request = "*" + std::to_string(args.size()) + "\r\n";
+         for (const auto& arg : args) request += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+         if (write(fds_[1], request.data(), request.size()) != static_cast<ssize_t>(request.size())) return "";
+         connection_->handle_read();
+         connection_->handle_write();
+         char buffer[4096];
+         ssize_t n = recv(fds_[1], buffer, sizeof(buffer), MSG_DONTWAIT);
+         return n > 0 ? std::string(buffer, n) : "";
+     }
+ 
+ private:
+     int fds_[2];
+     std::unique_ptr<Connection> connection_;
+ };
+ 
+ // A queued SWAPDB or FLUSHDB would replace the keyspace whose lock EXEC
+ // holds, so both are refused inside MULTI and the transaction is aborted
+ static void test_keyspace_commands_in_multi(Server& server) {
+     TestClient client(server);
+     for (const std::string command : {"SWAPDB", "FLUSHDB"}) {
+         std::vector<std::string> queued = {command};
+         if (command == "SWAPDB") queued = {"SWAPDB", "0", "1"};
+         check(client.call({"MULTI"}) == "+OK\r\n", command + ": MULTI");
+         check(client.call({"SET", "k", "v"}) == "+QUEUED\r\n", command + ": SET queued");
+         check(client.call(queued) == "-ERR " + command + " inside MULTI is not allowed\r\n",
+               command + " refused inside MULTI");
+         check(client.call({"EXEC"}).rfind("-EXECABORT", 0) == 0, command + ": EXEC aborts");
+         check(client.call({"GET", "k"}) == "$-1\r\n", command + ": nothing ran");
+     }
+     check(client.call({"SET", "k", "v"}) == "+OK\r\n", "SET outside MULTI");
+     check(client.call({"SWAPDB", "0", "1"}) == "+OK\r\n", "SWAPDB outside MULTI");
+     check(client.call({"GET", "k"}) == "$-1\r\n", "SWAPDB swapped the keyspace");
+ }
+ 
+ // COUNT is bounded before SCAN sizes its bucket budget from it, and a
+ // negative COUNT is an error rather than a huge unsigned one
+ static void test_scan_count(Server& server) {
+     TestClient client(server);
+     check(client.call({"SELECT", "2"}) == "+OK\r\n", "SCAN: SELECT");
+     for (int i = 0; i < 20; i++) client.call({"SET", "scan:" + std::to_string(i), "v"});
+     // Ten times this count wraps around to 4 buckets
+     std::string reply = client.call({"SCAN", "0", "COUNT", "1844674407370955162"});
+     bool complete = reply.rfind("*2\r\n$1\r\n0\r\n", 0) == 0;
+     for (int i = 0; i < 20; i++) complete &= reply.find("scan:" + std::to_string(i) + "\r\n") != std::string::npos;
+     check(complete, "SCAN with a huge COUNT returns every key in one call");
+     check(client.call({"SCAN", "0", "COUNT", "-1"}) == "-ERR value is not an integer or out of range\r\n",
+           "SCAN rejects a negative COUNT");
+     check(client.call({"SCAN", "-1"}) == "-ERR invalid cursor\r\n", "SCAN rejects a negative cursor");
+ }
+ 
+ // LOAD is off until a load directory is set, then only reads files inside
+ // it: absolute paths, ".." and symlinks pointing out of it are refused
+ static void test_load_dir(Server& server) {
+     TestClient client(server);
+     char root[] = "/tmp/blink_load_XXXXXX";
+     if (!mkdtemp(root)) {
+         check(false, "LOAD: mkdtemp");
+         return;
+     }
+     const std::string dir = std::string(root) + "/allowed";
+     const std::string outside = std::string(root) + "/secret.resp";
+     const std::string command = "*3\r\n$3\r\nSET\r\n$6\r\nloaded\r\n$3\r\nyes\r\n";
+     mkdir(dir.c_str(), 0700);
+     std::ofstream(dir + "/keys.resp") << command;
+     std::ofstream(outside) << command;
+     symlink(outside.c_str(), (dir + "/link.resp").c_str());
+ 
+     check(client.call({"LOAD", outside}).rfind("-ERR LOAD is disabled", 0) == 0, "LOAD disabled by default");
+     check(!server.set_load_dir(dir + "/missing"), "LOAD: missing directory rejected");
+     check(server.set_load_dir(dir), "LOAD: set load directory");
+     check(client.call({"LOAD", outside}).rfind("-ERR", 0) == 0, "LOAD refuses an absolute path");
+     check(client.call({"LOAD", "../secret.resp"}).rfind("-ERR", 0) == 0, "LOAD refuses '..'");
+     check(client.call({"LOAD", "link.resp"}) == "-ERR LOAD path is outside the load directory\r\n",
+           "LOAD refuses a symlink out of the directory");
+     check(client.call({"GET", "loaded"}) == "$-1\r\n", "LOAD: nothing outside was read");
+     check(client.call({"LOAD", "keys.resp"}) == ":1\r\n", "LOAD reads a file inside the directory");
+     check(client.call({"GET", "loaded"}) == "$3\r\nyes\r\n", "LOAD: key loaded");
+ 
+     unlink((dir + "/link.resp").c_str());
+     unlink((dir + "/keys.resp").c_str());
+     unlink(outside.c_str());
+     rmdir(dir.c_str());
+     rmdir(root);
+ }
+ 
+ // Bulk lengths past the end of a LOAD file, including one so large that
+ // adding the CRLF to it overflows, are malformed rather than read past
+ // the mapping
+ static void test_load_malformed(Server& server) {
+     TestClient client(server);
+     char dir[] = "/tmp/blink_load_XXXXXX";
+     if (!mkdtemp(dir) || !server.set_load_dir(dir)) {
+         check(false, "LOAD malformed: load directory");
+         return;
+     }
+     const std::vector<std::pair<std::string, std::string>> files = {
+         {"huge.resp", "*3\r\n$3\r\nSET\r\n$9223372036854775807\r\nk\r\n$1\r\nv\r\n"},
+         {"truncated.resp", "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$100\r\nshort\r\n"},
+         {"nocrlf.resp", "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$1\r\n"},
+     };
+     for (const auto& file : files) {
+         const std::string path = std::string(dir) + "/" + file.first;
+         std::ofstream(path) << file.second;
+         check(client.call({"LOAD", file.first}).rfind("-ERR malformed command 1", 0) == 0,
+               "LOAD rejects " + file.first);
+         unlink(path.c_str());
+     }
+     check(client.call({"GET", "k"}) == "$-1\r\n", "LOAD malformed: nothing loaded");
+     rmdir(dir);
+ }
+ 
+ // BITOP NOT inverts exactly one source
+ static void test_bitop_not(Server& server) {
+     TestClient client(server);
+     client.call({"SET", "bits", "\x0f"});
+     check(client.call({"BITOP", "NOT", "inverted", "bits"}) == ":1\r\n", "BITOP NOT");
+     check(client.call({"GET", "inverted"}) == "$1\r\n\xf0\r\n", "BITOP NOT result");
+     check(client.call({"BITOP", "NOT", "inverted", "bits", "bits"}).rfind("-ERR BITOP NOT", 0) == 0,
+           "BITOP NOT with two sources");
+ }
+ 
+ // Keyspaces share maxmemory: filling one that holds little evicts from the
+ // one holding the most, not the keys just written
+ static void test_shared_maxmemory() {
+     EngineConfig config;
+     config.max_memory = 1024 * 1024;
+     config.eviction_policy = EvictionPolicy::ALLKEYS_LRU;
+     Server server(0, 16, config);
+     if (!server.init()) {
+         check(false, "maxmemory: server init");
+         return;
+     }
+     TestClient client(server);
+     const std::string value(16 * 1024, 'x');
+     // DEL answers :1 for a key that was still there
+     auto count_deleted = [&](const std::string& prefix, int keys) {
+         int deleted = 0;
+         for (int i = 0; i < keys; i++) deleted += client.call({"DEL", prefix + std::to_string(i)}) == ":1\r\n";
+         return deleted;
+     };
+     for (int i = 0; i < 48; i++) client.call({"SET", "held:" + std::to_string(i), value});
+     check(client.call({"SELECT", "1"}) == "+OK\r\n", "maxmemory: SELECT");
+     bool stored = true;
+     for (int i = 0; i < 24; i++) stored &= client.call({"SET", "filled:" + std::to_string(i), value}) == "+OK\r\n";
+     check(stored, "maxmemory: SET in the side keyspace");
+     check(count_deleted("filled:", 24) == 24, "maxmemory: the side keyspace keeps every key written");
+     check(client.call({"SELECT", "0"}) == "+OK\r\n", "maxmemory: SELECT back");
+     check(count_deleted("held:", 48) < 48, "maxmemory: keys evicted from the keyspace holding the memory");
+ }
+ 
+ int main() {
+     Server server(0, 16);
+     if (!server.init()) {
+         std::cout << "FAIL: server init\n";
+         return 1;
+     }
+     test_keyspace_commands_in_multi(server);
+     test_scan_count(server);
+     test_load_dir(server);
+     test_load_malformed(server);
+     test_bitop_not(server);
+     test_shared_maxmemory();
+ 
+     if (failures) {
+         std::cout << failures << " check(s) failed\n";
+         return 1;
+     }
+     std::cout << "All server tests passed\n";
+     return 0;
+ }